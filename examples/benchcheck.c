@@ -0,0 +1,299 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+/*
+ * Benchmark regression check.
+ *
+ * Compares two JSON reports of examples/benchmark, a stored baseline
+ * and a fresh run, workload by workload. A workload regressed when
+ * its median ns/op grew by more than the threshold and a one-sided
+ * Mann-Whitney U test over the repetition samples rejects, at the
+ * given significance level, that the fresh run is not slower. The
+ * rank test makes no assumption on the shape of the timing noise and
+ * a single outlier cannot carry it; the threshold keeps significant
+ * but negligible shifts from failing the check. A baseline workload
+ * the fresh run lacks fails as well, so dropping or renaming one
+ * cannot slip past; refresh the baseline along with such a change.
+ *
+ * The reports are read line by line in the layout the benchmark
+ * writes, one result per line, rather than by a general JSON parser.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+
+#define CHECK_THRESHOLD 10.0
+#define CHECK_ALPHA     0.01
+#define CHECK_SAMPLES   256
+#define CHECK_NAME      16
+
+struct check_workload {
+    char root[CHECK_NAME];
+    char dist[CHECK_NAME];
+    char op[CHECK_NAME];
+    double median;
+    unsigned int count;
+    double samples[CHECK_SAMPLES];
+};
+
+struct check_report {
+    unsigned long nodes;
+    unsigned int count;
+    struct check_workload *workloads;
+};
+
+struct check_rank {
+    double value;
+    bool current;
+};
+
+/**
+ * parse_samples - read the samples array of a result line.
+ * @workload: workload to fill.
+ * @line: result line of the report.
+ */
+static int parse_samples(struct check_workload *workload, const char *line)
+{
+    const char *walk = strstr(line, "\"samples\": [");
+    char *end;
+
+    if (!walk)
+        return -EINVAL;
+
+    walk += strlen("\"samples\": [");
+    for (workload->count = 0; *walk != ']'; walk = end) {
+        if (workload->count == CHECK_SAMPLES)
+            return -EINVAL;
+        workload->samples[workload->count++] = strtod(walk, &end);
+        if (end == walk)
+            return -EINVAL;
+        if (*end == ',')
+            end++;
+    }
+
+    return workload->count ? 0 : -EINVAL;
+}
+
+/**
+ * load_report - read a JSON report of examples/benchmark.
+ * @path: file to read.
+ * @report: report to fill, its workloads malloc'ed.
+ */
+static int load_report(const char *path, struct check_report *report)
+{
+    struct check_workload *workload, *array;
+    size_t size = 0;
+    char *line = NULL;
+    FILE *file;
+    int retval = 0;
+
+    file = fopen(path, "r");
+    if (!file)
+        return -errno;
+
+    memset(report, 0, sizeof(*report));
+    while (getline(&line, &size, file) > 0) {
+        if (sscanf(line, " \"nodes\": %lu", &report->nodes) == 1)
+            continue;
+        if (!strstr(line, "\"root\": "))
+            continue;
+
+        array = realloc(report->workloads, sizeof(*array) * (report->count + 1));
+        if (!array) {
+            retval = -ENOMEM;
+            break;
+        }
+
+        report->workloads = array;
+        workload = &array[report->count];
+        if (sscanf(line, " {\"root\": \"%15[^\"]\", \"distribution\": \"%15[^\"]\", "
+                   "\"op\": \"%15[^\"]\", \"mean\": %*f, \"median\": %lf",
+                   workload->root, workload->dist, workload->op, &workload->median) != 4 ||
+            (retval = parse_samples(workload, line))) {
+            retval = -EINVAL;
+            break;
+        }
+        report->count++;
+    }
+
+    if (!retval && (ferror(file) || !report->count))
+        retval = -EINVAL;
+
+    if (retval) {
+        free(report->workloads);
+        report->workloads = NULL;
+    }
+
+    free(line);
+    fclose(file);
+    return retval;
+}
+
+static struct check_workload *find_workload(const struct check_report *report,
+                                            const struct check_workload *key)
+{
+    unsigned int index;
+
+    for (index = 0; index < report->count; ++index) {
+        struct check_workload *walk = &report->workloads[index];
+        if (!strcmp(walk->root, key->root) && !strcmp(walk->dist, key->dist) &&
+            !strcmp(walk->op, key->op))
+            return walk;
+    }
+
+    return NULL;
+}
+
+static int rank_cmp(const void *a, const void *b)
+{
+    double va = ((const struct check_rank *)a)->value;
+    double vb = ((const struct check_rank *)b)->value;
+    return (va > vb) - (va < vb);
+}
+
+/**
+ * mann_whitney - one-sided Mann-Whitney U test.
+ * @base: samples of the baseline.
+ * @current: samples of the fresh run.
+ *
+ * Returns the p-value for the fresh samples being drawn from the
+ * same distribution as the baseline against them tending larger,
+ * from the normal approximation with tie and continuity correction.
+ */
+static double mann_whitney(const struct check_workload *base, const struct check_workload *current)
+{
+    unsigned int total = base->count + current->count, index, tie;
+    double sum = 0, ties = 0, rank, mean, var, z;
+    struct check_rank ranks[CHECK_SAMPLES * 2];
+
+    for (index = 0; index < base->count; ++index)
+        ranks[index] = (struct check_rank){base->samples[index], false};
+    for (index = 0; index < current->count; ++index)
+        ranks[base->count + index] = (struct check_rank){current->samples[index], true};
+
+    qsort(ranks, total, sizeof(*ranks), rank_cmp);
+
+    /* equal values share the average of their ranks */
+    for (index = 0; index < total; index = tie) {
+        tie = index + 1;
+        while (tie < total && ranks[tie].value == ranks[index].value)
+            tie++;
+        rank = (index + tie + 1) / 2.0;
+        ties += pow(tie - index, 3) - (tie - index);
+        for (; index < tie; ++index)
+            sum += ranks[index].current ? rank : 0;
+    }
+
+    mean = (double)base->count * current->count / 2;
+    var = (double)base->count * current->count / 12 *
+          (total + 1 - ties / ((double)total * (total - 1)));
+    if (var <= 0)
+        return 1;
+
+    z = (sum - (double)current->count * (current->count + 1) / 2 - mean - 0.5) / sqrt(var);
+    return erfc(z / sqrt(2)) / 2;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options] baseline.json current.json\n", name);
+    printf("\t-t percent      median slowdown that fails (default %.0lf)\n", CHECK_THRESHOLD);
+    printf("\t-a alpha        significance level (default %.2lf)\n", CHECK_ALPHA);
+    printf("Exits with 1 when a baseline workload regressed or is missing.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct check_report base, current;
+    struct check_workload *old, *new;
+    double threshold = CHECK_THRESHOLD, alpha = CHECK_ALPHA, change, slower, faster;
+    unsigned int index, regressed = 0, missing = 0;
+    char name[CHECK_NAME * 3];
+    const char *verdict;
+    int opt, retval;
+
+    while ((opt = getopt(argc, argv, "t:a:h")) != -1) {
+        switch (opt) {
+            case 't':
+                threshold = strtod(optarg, NULL);
+                break;
+
+            case 'a':
+                alpha = strtod(optarg, NULL);
+                break;
+
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+
+    if (argc - optind != 2 || threshold < 0 || alpha <= 0 || alpha >= 1) {
+        usage(argv[0]);
+        return -EINVAL;
+    }
+
+    if ((retval = load_report(argv[optind], &base))) {
+        printf("Cannot read baseline %s: %d\n", argv[optind], retval);
+        return retval;
+    }
+
+    if ((retval = load_report(argv[optind + 1], &current))) {
+        printf("Cannot read report %s: %d\n", argv[optind + 1], retval);
+        free(base.workloads);
+        return retval;
+    }
+
+    if (base.nodes != current.nodes) {
+        printf("Baseline has %lu nodes, report %lu: refresh the baseline.\n",
+               base.nodes, current.nodes);
+        retval = -EINVAL;
+        goto free;
+    }
+
+    printf("%-32s %10s %10s %8s %8s  %s\n", "workload", "baseline", "current",
+           "change", "p", "verdict");
+
+    for (index = 0; index < base.count; ++index) {
+        old = &base.workloads[index];
+        new = find_workload(&current, old);
+        if (!new) {
+            printf("%s/%s/%s: MISSING from the report\n", old->root, old->dist, old->op);
+            missing++;
+            continue;
+        }
+
+        change = (new->median - old->median) / old->median * 100;
+        slower = mann_whitney(old, new);
+        faster = mann_whitney(new, old);
+
+        if (change > threshold && slower < alpha) {
+            verdict = "REGRESSED";
+            regressed++;
+        } else if (change < -threshold && faster < alpha)
+            verdict = "faster";
+        else
+            verdict = "ok";
+
+        snprintf(name, sizeof(name), "%s/%s/%s", old->root, old->dist, old->op);
+        printf("%-32s %10.3lf %10.3lf %+7.1lf%% %8.4lf  %s\n",
+               name, old->median, new->median,
+               change, change < 0 ? faster : slower, verdict);
+    }
+
+    printf("%u of %u workloads regressed by more than %.1lf%% (alpha %.2lf), %u missing.\n",
+           regressed, base.count, threshold, alpha, missing);
+    retval = regressed || missing ? 1 : 0;
+
+free:
+    free(base.workloads);
+    free(current.workloads);
+    return retval;
+}
@@ -3,157 +3,1351 @@
  * Copyright(c) 2021-2022 John Sanpe <sanpeqf@gmail.com>
  */
 
+/*
+ * Workload driven benchmark.
+ *
+ * Every combination of the selected roots and key distributions runs
+ * the operation list in order, warmup times untimed and then once per
+ * repetition, each repetition starting from an empty tree. A phase
+ * that needs a populated tree fills it untimed first. Results are
+ * ns/op averaged over the repetitions with a 95% confidence interval.
+ *
+ * A trace recorded through src/trace.h replaces the key distributions
+ * and operation list with a single replay phase, which runs the
+ * recorded operations in order on an empty tree.
+ *
+ * The Makefile enables the debug link checks for every example; they
+ * live in the inline helpers, so dropping them here times the paths
+ * a release build runs.
+ */
+
+#undef DEBUG_RBTREE
+
 #include "rbtree.h"
+#include "trace.h"
+#include "hist.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <errno.h>
 #include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
 #include <unistd.h>
-#include <sys/times.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
-#define RB_DEBUG    0
-#define RB_CACHED   1
 #define TEST_LEN    1000000
+#define TEST_WARMUP 1
+#define TEST_REPEAT 3
+#define ZIPF_THETA  0.99
+#define CLUSTER_LEN 64
+
+/* cascade length classes 0, 1, 2-3, 4-7 and 8+ steps; from the 4-7 class on it is long */
+#define CASCADE_CLASSES 5
+#define CASCADE_LONG    3
+
+enum bench_root {
+    BENCH_PLAIN,
+    BENCH_CACHED,
+    BENCH_AUGMENTED,
+    BENCH_NR_ROOTS,
+};
+
+enum bench_dist {
+    BENCH_UNIFORM,
+    BENCH_SEQUENTIAL,
+    BENCH_ZIPF,
+    BENCH_CLUSTERED,
+    BENCH_TRACE,
+    BENCH_NR_DISTS,
+};
+
+enum bench_op {
+    BENCH_INSERT,
+    BENCH_FIND,
+    BENCH_ITERATE,
+    BENCH_DELETE,
+    BENCH_POP,
+    BENCH_REPLAY,
+    BENCH_NR_OPS,
+};
+
+enum bench_counter {
+    BENCH_INSTRUCTIONS,
+    BENCH_BRANCH_MISSES,
+    BENCH_L1D_MISSES,
+    BENCH_LLC_MISSES,
+    BENCH_DTLB_MISSES,
+    BENCH_NR_COUNTERS,
+};
+
+enum bench_format {
+    BENCH_TEXT,
+    BENCH_JSON,
+    BENCH_CSV,
+};
 
 struct bench_node {
     struct rb_node rb;
-    unsigned int num;
-    unsigned long data;
+    unsigned long key;
+    unsigned long max;
+};
+
+/* one histogram over all operations, one per cascade length and traced op */
+struct bench_latency {
+    struct hist all;
+    struct hist cascades[CASCADE_CLASSES];
+    struct hist traced[RB_TRACE_NR_OPS];
+};
+
+struct bench_ctx {
+    struct bench_latency *latency;
+    double *counters;
+    double *stats;
+    const struct rb_trace_record *trace;
+    bool pacing;
+    unsigned long overhead;
+    enum bench_root root;
+    struct rb_root_cached cached;
+    struct bench_node *nodes;
+    unsigned int *targets;
+    unsigned long length;
+    unsigned long found;
+    bool loaded;
+};
+
+struct bench_result {
+    enum bench_root root;
+    enum bench_dist dist;
+    enum bench_op op;
+    struct bench_latency *latency;
+    double *counters;
+    double *stats;
+    double *samples;
+    unsigned int count;
+    double mean;
+    double median;
+    double stddev;
+    double ci95;
+    double min;
+    double max;
+};
+
+static const char *const root_names[] = {
+    [BENCH_PLAIN] = "plain",
+    [BENCH_CACHED] = "cached",
+    [BENCH_AUGMENTED] = "augmented",
+};
+
+static const char *const dist_names[] = {
+    [BENCH_UNIFORM] = "uniform",
+    [BENCH_SEQUENTIAL] = "sequential",
+    [BENCH_ZIPF] = "zipf",
+    [BENCH_CLUSTERED] = "clustered",
+    [BENCH_TRACE] = "trace",
+};
+
+static const char *const op_names[] = {
+    [BENCH_INSERT] = "insert",
+    [BENCH_FIND] = "find",
+    [BENCH_ITERATE] = "iterate",
+    [BENCH_DELETE] = "delete",
+    [BENCH_POP] = "pop",
+    [BENCH_REPLAY] = "replay",
+};
+
+static const char *const traced_names[] = {
+    [RB_TRACE_INSERT] = "insert",
+    [RB_TRACE_FIND] = "find",
+    [RB_TRACE_DELETE] = "delete",
+};
+
+static const char *const counter_names[] = {
+    [BENCH_INSTRUCTIONS] = "instructions",
+    [BENCH_BRANCH_MISSES] = "branch-misses",
+    [BENCH_L1D_MISSES] = "L1d-misses",
+    [BENCH_LLC_MISSES] = "LLC-misses",
+    [BENCH_DTLB_MISSES] = "dTLB-misses",
+};
+
+static const char *const stat_names[] = {
+    "rotations", "recolors", "descents", "levels", "compares", "climbs",
 };
 
+#define BENCH_NR_STATS (sizeof(stat_names) / sizeof(*stat_names))
+
+#define CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+    unsigned int type;
+    unsigned long config;
+} counter_events[] = {
+    [BENCH_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [BENCH_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    [BENCH_L1D_MISSES] = {PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    [BENCH_LLC_MISSES] = {PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_LL)},
+    [BENCH_DTLB_MISSES] = {PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+/* -1 for a counter the kernel or the machine does not provide */
+static int counter_fds[BENCH_NR_COUNTERS] = {-1, -1, -1, -1, -1};
+
 #define rb_to_bench(node) \
-    rb_entry_safe(node, struct bench_node, rb)
+    rb_entry(node, struct bench_node, rb)
 
-#if RB_DEBUG
-static void node_dump(struct bench_node *node)
+/* the augmented root sees every rotation through its callbacks */
+static unsigned long bench_rotations;
+static unsigned long bench_propagates;
+
+/* keep the subtree maximum key; only rotations pass @exit false */
+static bool bench_compute(struct bench_node *node, bool exit)
 {
-    printf("\t%04d: ", node->num);
-    printf("parent %-4d ", node->rb.parent ? rb_to_bench(node->rb.parent)->num : 0);
-    printf("left %-4d ", node->rb.left ? rb_to_bench(node->rb.left)->num : 0);
-    printf("right %-4d ", node->rb.right ? rb_to_bench(node->rb.right)->num : 0);
-    printf("data 0x%16lx ", node->data);
-    printf("color'%s' ", node->rb.color ? "black" : "red");
-    printf("\n");
+    unsigned long max = node->key;
+    struct bench_node *child;
+
+    if (!exit)
+        bench_rotations++;
+    else
+        bench_propagates++;
+
+    if (node->rb.left) {
+        child = rb_to_bench(node->rb.left);
+        if (child->max > max)
+            max = child->max;
+    }
+
+    if (node->rb.right) {
+        child = rb_to_bench(node->rb.right);
+        if (child->max > max)
+            max = child->max;
+    }
+
+    if (exit && node->max == max)
+        return true;
+
+    node->max = max;
+    return false;
+}
+
+RB_DECLARE_CALLBACKS(static, bench_callbacks, struct bench_node, rb, max, bench_compute);
+
+static long bench_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_bench(a)->key < rb_to_bench(b)->key ? -1 : 1;
+}
+
+static long bench_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_bench(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double next_unit(unsigned long *seed)
+{
+    return (next_rand(seed) >> 11) * 0x1p-53;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* cost of the clock itself, taken off every per-operation sample */
+static unsigned long time_overhead(void)
+{
+    unsigned long count, start, delta, min = ULONG_MAX;
+
+    for (count = 0; count < 10000; ++count) {
+        start = time_ns();
+        delta = time_ns() - start;
+        if (delta < min)
+            min = delta;
+    }
+
+    return min;
+}
+
+/**
+ * counters_open - open the hardware counters for this thread.
+ *
+ * Returns the number of counters available. Containers and guests
+ * often have none, or a perf_event_paranoid that refuses them; the
+ * benchmark then reports n/a and carries on.
+ */
+static unsigned int counters_open(void)
+{
+    struct perf_event_attr attr;
+    unsigned int index, count = 0;
+    int error = 0;
+
+    for (index = 0; index < BENCH_NR_COUNTERS; ++index) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter_events[index].type;
+        attr.config = counter_events[index].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        counter_fds[index] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counter_fds[index] >= 0)
+            count++;
+        else
+            error = errno;
+    }
+
+    if (count < BENCH_NR_COUNTERS)
+        fprintf(stderr, "%u of %u perf counters unavailable: %s\n",
+                BENCH_NR_COUNTERS - count, BENCH_NR_COUNTERS, strerror(error));
+
+    return count;
+}
+
+static void counters_close(void)
+{
+    unsigned int index;
+
+    for (index = 0; index < BENCH_NR_COUNTERS; ++index) {
+        if (counter_fds[index] >= 0)
+            close(counter_fds[index]);
+    }
 }
-#else
-# define node_dump(node) ((void)(node))
-#endif
 
-#if RB_CACHED
-static RB_ROOT_CACHED(bench_root);
-# define bc_insert                      rb_cached_insert
-# define bc_delete                      rb_cached_delete
-# define bc_for_each_entry              rb_cached_for_each_entry
-# define bc_post_for_each_entry         rb_cached_post_for_each_entry
-# define bc_post_for_each_entry_safe    rb_cached_post_for_each_entry_safe
-# define bc_deepth(cached)              test_deepth((cached)->root.node)
-#else
-static RB_ROOT(bench_root);
-# define bc_insert                      rb_insert
-# define bc_delete                      rb_delete
-# define bc_for_each_entry              rb_for_each_entry
-# define bc_post_for_each_entry         rb_post_for_each_entry
-# define bc_post_for_each_entry_safe    rb_post_for_each_entry_safe
-# define bc_deepth(root)                test_deepth((root)->node)
-#endif
+/* read every counter, scaled up when the kernel had to multiplex */
+static void counters_read(double *values)
+{
+    unsigned long buff[3];
+    unsigned int index;
+
+    for (index = 0; index < BENCH_NR_COUNTERS; ++index) {
+        values[index] = 0;
+        if (counter_fds[index] < 0 ||
+            read(counter_fds[index], buff, sizeof(buff)) != sizeof(buff) || !buff[2])
+            continue;
+        values[index] = (double)buff[0] * buff[1] / buff[2];
+    }
+}
+
+/* library operation counts, all zero unless built with RB_STATS */
+static void stats_read(double *values)
+{
+    struct rb_stats stats;
+
+    rb_stats_read(&stats);
+    values[0] = stats.rotations;
+    values[1] = stats.recolors;
+    values[2] = stats.descents;
+    values[3] = stats.levels;
+    values[4] = stats.compares;
+    values[5] = stats.climbs;
+}
+
+/*
+ * Zipfian ranks in [0, length) after Gray et al., "Quickly Generating
+ * Billion-Record Synthetic Databases": one O(length) zeta sum, then
+ * O(1) per sample.
+ */
+struct zipf {
+    unsigned long length;
+    double alpha, zetan, eta, half;
+};
 
-static void time_dump(int ticks, clock_t start, clock_t stop, struct tms *start_tms, struct tms *stop_tms)
+static void zipf_init(struct zipf *zipf, unsigned long length, double theta)
 {
-    printf("\treal time: %lf\n", (stop - start) / (double)ticks);
-    printf("\tuser time: %lf\n", (stop_tms->tms_utime - start_tms->tms_utime) / (double)ticks);
-    printf("\tkern time: %lf\n", (stop_tms->tms_stime - start_tms->tms_stime) / (double)ticks);
+    double zeta2 = 1 + pow(0.5, theta);
+    unsigned long count;
+
+    zipf->zetan = 0;
+    for (count = 1; count <= length; ++count)
+        zipf->zetan += 1 / pow(count, theta);
+
+    zipf->length = length;
+    zipf->alpha = 1 / (1 - theta);
+    zipf->eta = (1 - pow(2.0 / length, 1 - theta)) / (1 - zeta2 / zipf->zetan);
+    zipf->half = zeta2;
 }
 
-static unsigned int test_deepth(struct rb_node *node)
+static unsigned long zipf_next(struct zipf *zipf, unsigned long *seed)
 {
-    unsigned int left_deepth, right_deepth;
+    double unit = next_unit(seed), uz = unit * zipf->zetan;
+    unsigned long rank;
 
-    if (!node)
+    if (uz < 1)
         return 0;
+    if (uz < zipf->half)
+        return 1;
+
+    rank = zipf->length * pow(zipf->eta * unit - zipf->eta + 1, zipf->alpha);
+    return rank < zipf->length ? rank : zipf->length - 1;
+}
+
+/* spread ranks over the key space so hot keys are not neighbours */
+static unsigned long scramble(unsigned long value)
+{
+    value *= 0x9e3779b97f4a7c15UL;
+    return value ^ (value >> 29);
+}
+
+static void generate(struct bench_ctx *ctx, enum bench_dist dist, unsigned long seed)
+{
+    unsigned long count, length = ctx->length, clusters, inserts, *bases;
+    struct zipf zipf;
+
+    switch (dist) {
+        case BENCH_UNIFORM:
+            for (count = 0; count < length; ++count) {
+                ctx->nodes[count].key = next_rand(&seed);
+                ctx->targets[count] = next_rand(&seed) % length;
+            }
+            break;
+
+        case BENCH_SEQUENTIAL:
+            for (count = 0; count < length; ++count) {
+                ctx->nodes[count].key = count;
+                ctx->targets[count] = count;
+            }
+            break;
+
+        case BENCH_ZIPF:
+            /* duplicate hot keys on insert, hot nodes on find */
+            zipf_init(&zipf, length, ZIPF_THETA);
+            for (count = 0; count < length; ++count) {
+                ctx->nodes[count].key = scramble(zipf_next(&zipf, &seed));
+                ctx->targets[count] = scramble(zipf_next(&zipf, &seed)) % length;
+            }
+            break;
+
+        case BENCH_CLUSTERED:
+            /* runs of adjacent keys growing from random bases */
+            clusters = length / CLUSTER_LEN + 1;
+            bases = malloc(sizeof(*bases) * clusters);
+            if (!bases)
+                abort();
+            for (count = 0; count < clusters; ++count)
+                bases[count] = next_rand(&seed) & ~0xffffffffUL;
+            for (count = 0; count < length; ++count) {
+                ctx->nodes[count].key = bases[next_rand(&seed) % clusters]++;
+                ctx->targets[count] = next_rand(&seed) % length;
+            }
+            free(bases);
+            break;
+
+        case BENCH_TRACE:
+            /* the nodes are inserted in the order the trace inserts keys */
+            for (count = inserts = 0; count < length; ++count) {
+                if (ctx->trace[count].op == RB_TRACE_INSERT)
+                    ctx->nodes[inserts++].key = ctx->trace[count].key;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void tree_insert(struct bench_ctx *ctx, struct bench_node *node)
+{
+    switch (ctx->root) {
+        case BENCH_PLAIN:
+            rb_insert(&ctx->cached.root, &node->rb, bench_cmp);
+            break;
+
+        case BENCH_CACHED:
+            rb_cached_insert(&ctx->cached, &node->rb, bench_cmp);
+            break;
+
+        case BENCH_AUGMENTED:
+            node->max = node->key;
+            rb_insert_augmented(&ctx->cached.root, &node->rb, bench_cmp, &bench_callbacks);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void tree_delete(struct bench_ctx *ctx, struct bench_node *node)
+{
+    switch (ctx->root) {
+        case BENCH_PLAIN:
+            rb_delete(&ctx->cached.root, &node->rb);
+            break;
+
+        case BENCH_CACHED:
+            rb_cached_delete(&ctx->cached, &node->rb);
+            break;
+
+        case BENCH_AUGMENTED:
+            rb_delete_augmented(&ctx->cached.root, &node->rb, &bench_callbacks);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static struct rb_node *tree_first(struct bench_ctx *ctx)
+{
+    if (ctx->root == BENCH_CACHED)
+        return rb_cached_first(&ctx->cached);
+
+    return rb_first(&ctx->cached.root);
+}
+
+static void tree_fill(struct bench_ctx *ctx)
+{
+    unsigned long count;
+
+    for (count = 0; count < ctx->length; ++count)
+        tree_insert(ctx, &ctx->nodes[count]);
+
+    ctx->loaded = true;
+}
+
+static void tree_empty(struct bench_ctx *ctx)
+{
+    unsigned long count;
+
+    for (count = 0; count < ctx->length; ++count)
+        tree_delete(ctx, &ctx->nodes[count]);
+
+    ctx->loaded = false;
+}
+
+/* the nodes a replay leaves behind are not known in advance */
+static void tree_drain(struct bench_ctx *ctx)
+{
+    struct rb_node *node;
+
+    while ((node = tree_first(ctx)))
+        tree_delete(ctx, rb_to_bench(node));
+}
+
+/**
+ * cascade_now - rebalancing steps so far.
+ * @library: whether the library counts with RB_STATS.
+ *
+ * A step is a rotation, a recolor climbing one level up, or one node
+ * whose augmented value was recomputed on the way up. Erase does at
+ * most three rotations, its long cascades are the climbs. Without
+ * RB_STATS only the augmented root sees any of it, through its
+ * callbacks: rotations and propagation, but not bare recolors.
+ */
+static unsigned long cascade_now(bool library)
+{
+    struct rb_stats stats;
+
+    if (!library)
+        return bench_rotations + bench_propagates;
+
+    rb_stats_read(&stats);
+    return stats.rotations + stats.recolors + bench_propagates;
+}
+
+static unsigned int cascade_class(unsigned long steps)
+{
+    unsigned int index = 0;
+
+    while (steps && index < CASCADE_CLASSES - 1) {
+        steps >>= 1;
+        index++;
+    }
+
+    return index;
+}
+
+/* file one timed operation by latency and by the length of its cascade */
+static void latency_record(struct bench_ctx *ctx, unsigned long start, unsigned long stop,
+                           unsigned long steps, struct hist *extra)
+{
+    struct bench_latency *latency = ctx->latency;
+    unsigned long delta;
+
+    delta = stop - start > ctx->overhead ? stop - start - ctx->overhead : 0;
+    hist_record(&latency->all, delta);
+    hist_record(&latency->cascades[cascade_class(steps)], delta);
+    if (extra)
+        hist_record(extra, delta);
+}
+
+/**
+ * phase_latency - run one phase timing every operation.
+ * @ctx: benchmark context, with the latency histograms to fill.
+ * @op: operation of the phase.
+ *
+ * Each sample is filed by latency and by the length of the
+ * rebalancing cascade it ran, see cascade_now(). Returns ns/op over the whole phase, which includes
+ * the clock reads.
+ */
+static double phase_latency(struct bench_ctx *ctx, enum bench_op op)
+{
+    unsigned long count, length = ctx->length, start, stop, steps;
+    struct rb_stats stats;
+    struct rb_node *node;
+    double begin = time_now();
+    bool library = rb_stats_read(&stats);
+
+    for (count = 0; count < length; ++count) {
+        steps = cascade_now(library);
+        start = time_ns();
+        switch (op) {
+            case BENCH_INSERT:
+                tree_insert(ctx, &ctx->nodes[count]);
+                break;
+
+            case BENCH_FIND:
+                ctx->found += !!rb_find(&ctx->cached.root,
+                    (void *)ctx->nodes[ctx->targets[count]].key, bench_find);
+                break;
+
+            case BENCH_DELETE:
+                tree_delete(ctx, &ctx->nodes[count]);
+                break;
+
+            case BENCH_POP:
+                node = tree_first(ctx);
+                tree_delete(ctx, rb_to_bench(node));
+                break;
+
+            default:
+                break;
+        }
+        stop = time_ns();
+        latency_record(ctx, start, stop, cascade_now(library) - steps, NULL);
+    }
+
+    if (op != BENCH_FIND)
+        ctx->loaded = op == BENCH_INSERT;
+
+    return (time_now() - begin) * 1e9 / length;
+}
+
+/**
+ * phase_replay - run the recorded operations of a trace.
+ * @ctx: benchmark context holding the trace.
+ *
+ * Finds and deletes look their key up; a delete of a key the trace
+ * never inserted does nothing. With pacing every operation waits for
+ * its recorded offset from the start of the phase. Operations are
+ * timed one by one when pacing or recording latency, and ns/op then
+ * leaves out the waits; otherwise the phase is timed as a whole.
+ * Whatever the trace leaves in the tree stays for phase_run().
+ */
+static double phase_replay(struct bench_ctx *ctx)
+{
+    unsigned long count, length = ctx->length, inserts = 0;
+    unsigned long begin, start = 0, stop = 0, busy = 0, clock = 0, steps = 0;
+    const struct rb_trace_record *record;
+    bool timed = ctx->pacing || ctx->latency, library;
+    struct rb_stats stats;
+    struct rb_node *node;
+
+    library = rb_stats_read(&stats);
+    begin = time_ns();
+
+    for (count = 0; count < length; ++count) {
+        record = &ctx->trace[count];
+        if (ctx->pacing) {
+            clock += record->delta;
+            while (time_ns() - begin < clock)
+                ;
+        }
+
+        if (timed) {
+            if (ctx->latency)
+                steps = cascade_now(library);
+            start = time_ns();
+        }
+
+        switch (record->op) {
+            case RB_TRACE_INSERT:
+                tree_insert(ctx, &ctx->nodes[inserts++]);
+                break;
+
+            case RB_TRACE_FIND:
+                rb_find(&ctx->cached.root, (void *)(unsigned long)record->key, bench_find);
+                break;
+
+            case RB_TRACE_DELETE:
+                node = rb_find(&ctx->cached.root, (void *)(unsigned long)record->key, bench_find);
+                if (node)
+                    tree_delete(ctx, rb_to_bench(node));
+                break;
+
+            default:
+                break;
+        }
+
+        if (timed) {
+            stop = time_ns();
+            busy += stop - start;
+            if (ctx->latency)
+                latency_record(ctx, start, stop, cascade_now(library) - steps,
+                               &ctx->latency->traced[record->op]);
+        }
+    }
+
+    if (!timed)
+        busy = time_ns() - begin;
+
+    return (double)busy / length;
+}
+
+/**
+ * phase_loop - run one phase as a plain loop.
+ * @ctx: benchmark context.
+ * @op: operation of the phase.
+ *
+ * Returns ns/op.
+ */
+static double phase_loop(struct bench_ctx *ctx, enum bench_op op)
+{
+    unsigned long count, length = ctx->length;
+    struct rb_node *node;
+    double start, stop;
+
+    start = time_now();
+    switch (op) {
+        case BENCH_INSERT:
+            for (count = 0; count < length; ++count)
+                tree_insert(ctx, &ctx->nodes[count]);
+            ctx->loaded = true;
+            break;
+
+        case BENCH_FIND:
+            for (count = 0; count < length; ++count)
+                ctx->found += !!rb_find(&ctx->cached.root,
+                    (void *)ctx->nodes[ctx->targets[count]].key, bench_find);
+            break;
+
+        case BENCH_ITERATE:
+            for (node = tree_first(ctx); node; node = rb_next(node))
+                ctx->found++;
+            break;
+
+        case BENCH_DELETE:
+            for (count = 0; count < length; ++count)
+                tree_delete(ctx, &ctx->nodes[count]);
+            ctx->loaded = false;
+            break;
+
+        case BENCH_POP:
+            while ((node = tree_first(ctx)))
+                tree_delete(ctx, rb_to_bench(node));
+            ctx->loaded = false;
+            break;
+
+        default:
+            break;
+    }
+    stop = time_now();
+
+    return (stop - start) * 1e9 / length;
+}
+
+/**
+ * phase_run - run one timed phase.
+ * @ctx: benchmark context.
+ * @op: operation of the phase.
+ *
+ * Returns ns/op, the tree being filled or emptied untimed first
+ * when the phase needs it, and emptied untimed after a replay.
+ * Counter and library statistics deltas of the timed part are added
+ * to @ctx->counters and @ctx->stats when they are collected.
+ */
+static double phase_run(struct bench_ctx *ctx, enum bench_op op)
+{
+    double start[BENCH_NR_COUNTERS], stop[BENCH_NR_COUNTERS], retval;
+    double before[BENCH_NR_STATS], after[BENCH_NR_STATS];
+    unsigned int index;
+
+    if ((op == BENCH_INSERT || op == BENCH_REPLAY) && ctx->loaded)
+        tree_empty(ctx);
+    else if (op != BENCH_INSERT && op != BENCH_REPLAY && !ctx->loaded)
+        tree_fill(ctx);
+
+    if (ctx->stats)
+        stats_read(before);
+    if (ctx->counters)
+        counters_read(start);
+
+    if (op == BENCH_REPLAY)
+        retval = phase_replay(ctx);
+    else if (ctx->latency && op != BENCH_ITERATE)
+        retval = phase_latency(ctx, op);
+    else
+        retval = phase_loop(ctx, op);
+
+    if (ctx->counters) {
+        counters_read(stop);
+        for (index = 0; index < BENCH_NR_COUNTERS; ++index)
+            ctx->counters[index] += stop[index] - start[index];
+    }
+
+    if (ctx->stats) {
+        stats_read(after);
+        for (index = 0; index < BENCH_NR_STATS; ++index)
+            ctx->stats[index] += after[index] - before[index];
+    }
+
+    if (op == BENCH_REPLAY)
+        tree_drain(ctx);
+
+    return retval;
+}
+
+static int sample_cmp(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* two-sided 95% Student t quantiles for 1 to 30 degrees of freedom */
+static const double student_t95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static void summarize(struct bench_result *result)
+{
+    double sum = 0, var = 0, t95, *samples = result->samples;
+    unsigned int index, count = result->count;
+
+    qsort(samples, count, sizeof(*samples), sample_cmp);
+    for (index = 0; index < count; ++index)
+        sum += samples[index];
+
+    result->mean = sum / count;
+    result->min = samples[0];
+    result->max = samples[count - 1];
+    result->median = count % 2 ? samples[count / 2] :
+                     (samples[count / 2 - 1] + samples[count / 2]) / 2;
+
+    for (index = 0; index < count; ++index)
+        var += (samples[index] - result->mean) * (samples[index] - result->mean);
+
+    if (count < 2) {
+        result->stddev = result->ci95 = 0;
+        return;
+    }
+
+    t95 = count - 1 <= 30 ? student_t95[count - 2] : 1.960;
+    result->stddev = sqrt(var / (count - 1));
+    result->ci95 = t95 * result->stddev / sqrt(count);
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options]\n", name);
+    printf("\t-n nodes        tree size (default %u)\n", TEST_LEN);
+    printf("\t-d dists        uniform,sequential,zipf,clustered (default uniform)\n");
+    printf("\t-o ops          insert,find,iterate,delete,pop (default insert,find,iterate,delete)\n");
+    printf("\t-r roots        plain,cached,augmented (default cached)\n");
+    printf("\t-w runs         untimed warmup runs (default %u)\n", TEST_WARMUP);
+    printf("\t-R runs         timed repetitions (default %u)\n", TEST_REPEAT);
+    printf("\t-s seed         key generator seed\n");
+    printf("\t-f format       text, json or csv (default text)\n");
+    printf("\t-l              record per-operation latency histograms\n");
+    printf("\t-p              collect hardware counters per operation\n");
+    printf("\t-t trace        replay a trace recorded through trace.h instead\n");
+    printf("\t-P              replay at the recorded pacing\n");
+}
+
+static void output_shape(const struct rb_root *root)
+{
+    struct rb_report report;
+    unsigned int index;
+
+    if (rb_analyze(root, &report))
+        return;
+
+    printf("\tdepth: min %u avg %.2lf max %u, black height %u, %.1lf%% red, %.2lf compares/find\n",
+           report.min_depth, report.avg_depth, report.max_depth, report.black_height,
+           100 * report.red_ratio, report.avg_compares);
+    printf("\tlevels:");
+    for (index = 0; index < RB_REPORT_DEPTH && report.depths[index]; ++index)
+        printf(" %lu", report.depths[index]);
+    printf("\n\tspread: %lu cache lines, %lu pages, %.2lf nodes/line\n",
+           report.lines, report.pages, (double)report.nodes / report.lines);
+}
+
+static void output_stats(const struct bench_result *result)
+{
+    unsigned int index;
+
+    printf("\t%s stats:", op_names[result->op]);
+    for (index = 0; index < BENCH_NR_STATS; ++index)
+        printf(" %.2lf %s", result->stats[index], stat_names[index]);
+    printf(" per op\n");
+}
+
+/**
+ * parse_list - parse a comma separated list of names.
+ * @arg: list to parse.
+ * @names: table of valid names.
+ * @count: size of @names.
+ * @list: output array of indexes, in the order given.
+ *
+ * Returns the number of entries, or -EINVAL on an unknown name.
+ */
+static int parse_list(char *arg, const char *const *names, unsigned int count, unsigned int *list)
+{
+    unsigned int index, number = 0;
+    char *walk;
+
+    for (walk = strtok(arg, ","); walk; walk = strtok(NULL, ",")) {
+        for (index = 0; index < count; ++index) {
+            if (!strcmp(walk, names[index]))
+                break;
+        }
+        if (index == count || number == BENCH_NR_OPS * 2) {
+            fprintf(stderr, "unknown or too many entries: %s\n", walk);
+            return -EINVAL;
+        }
+        list[number++] = index;
+    }
+
+    return number;
+}
+
+static const char *const cascade_names[CASCADE_CLASSES] = {"0", "1", "2-3", "4-7", "8+"};
+static const double percentiles[] = {50, 90, 99, 99.9};
+static const char *const percentile_names[] = {"p50", "p90", "p99", "p999"};
+
+static void output_latency(const struct bench_result *result)
+{
+    const struct bench_latency *latency = result->latency;
+    unsigned long tail, cascade, p99 = hist_percentile(&latency->all, 99);
+    unsigned int index;
+
+    printf("\t%s latency:", op_names[result->op]);
+    for (index = 0; index < 4; ++index)
+        printf(" %s %lu", percentile_names[index], hist_percentile(&latency->all, percentiles[index]));
+    printf(" max %lu ns\n", latency->all.max);
+
+    for (index = 0; result->op == BENCH_REPLAY && index < RB_TRACE_NR_OPS; ++index) {
+        if (!latency->traced[index].total)
+            continue;
+        printf("\treplay %s: %.1lf%% of ops, p50 %lu p99 %lu max %lu ns\n", traced_names[index],
+               100.0 * latency->traced[index].total / latency->all.total,
+               hist_percentile(&latency->traced[index], 50),
+               hist_percentile(&latency->traced[index], 99), latency->traced[index].max);
+    }
+
+    /* cascades are only seen with RB_STATS or on the augmented root */
+    if (latency->cascades[0].total == latency->all.total)
+        return;
+
+    tail = hist_above(&latency->all, p99);
+    for (index = 0, cascade = 0; index < CASCADE_CLASSES; ++index) {
+        if (index >= CASCADE_LONG)
+            cascade += hist_above(&latency->cascades[index], p99);
+        if (!latency->cascades[index].total)
+            continue;
+        printf("\t%s %s cascade steps: %.1lf%% of ops, p50 %lu p99 %lu ns, %.1lf%% of tail past p99\n",
+               op_names[result->op], cascade_names[index],
+               100.0 * latency->cascades[index].total / latency->all.total,
+               hist_percentile(&latency->cascades[index], 50),
+               hist_percentile(&latency->cascades[index], 99),
+               tail ? 100.0 * hist_above(&latency->cascades[index], p99) / tail : 0);
+    }
+
+    /* a tail operation with a short cascade was waiting on the descent or memory */
+    if (tail)
+        printf("\t%s tail past p99: %.1lf%% long cascades (%lu+ steps), %.1lf%% short cascades, descent and cache misses\n",
+               op_names[result->op], 100.0 * cascade / tail, 1UL << (CASCADE_LONG - 1),
+               100.0 * (tail - cascade) / tail);
+}
+
+static void output_counters(const struct bench_result *result)
+{
+    unsigned int index;
+
+    printf("\t%s counters:", op_names[result->op]);
+    for (index = 0; index < BENCH_NR_COUNTERS; ++index) {
+        if (counter_fds[index] >= 0)
+            printf(" %.2lf %s", result->counters[index], counter_names[index]);
+        else
+            printf(" n/a %s", counter_names[index]);
+    }
+    printf(" per op\n");
+}
+
+static void output_text(const struct bench_result *result, unsigned int count)
+{
+    unsigned int index;
+
+    for (index = 0; index < count; ++index, ++result) {
+        printf("\t%s: %lf ns/op +- %lf (median %lf, min %lf, max %lf)\n", op_names[result->op],
+               result->mean, result->ci95, result->median, result->min, result->max);
+        if (result->latency)
+            output_latency(result);
+        if (result->counters)
+            output_counters(result);
+        if (result->stats)
+            output_stats(result);
+    }
+}
+
+static void output_json_latency(const struct bench_result *result)
+{
+    const struct bench_latency *latency = result->latency;
+    unsigned long p99 = hist_percentile(&latency->all, 99);
+    unsigned int index;
+
+    printf(", \"latency\": {");
+    for (index = 0; index < 4; ++index)
+        printf("\"%s\": %lu, ", percentile_names[index], hist_percentile(&latency->all, percentiles[index]));
+    printf("\"max\": %lu", latency->all.max);
+
+    if (latency->cascades[0].total != latency->all.total) {
+        printf(", \"cascades\": [");
+        for (index = 0; index < CASCADE_CLASSES; ++index) {
+            printf("%s{\"steps\": \"%s\", \"ops\": %lu, \"p50\": %lu, \"p99\": %lu, \"tail\": %lu}",
+                   index ? ", " : "", cascade_names[index], latency->cascades[index].total,
+                   hist_percentile(&latency->cascades[index], 50),
+                   hist_percentile(&latency->cascades[index], 99),
+                   hist_above(&latency->cascades[index], p99));
+        }
+        printf("]");
+    }
+
+    if (result->op == BENCH_REPLAY) {
+        printf(", \"ops\": {");
+        for (index = 0; index < RB_TRACE_NR_OPS; ++index) {
+            printf("%s\"%s\": {\"ops\": %lu, \"p50\": %lu, \"p99\": %lu, \"max\": %lu}",
+                   index ? ", " : "", traced_names[index], latency->traced[index].total,
+                   hist_percentile(&latency->traced[index], 50),
+                   hist_percentile(&latency->traced[index], 99), latency->traced[index].max);
+        }
+        printf("}");
+    }
+    printf("}");
+}
+
+static void output_json(const struct bench_result *result, unsigned int count, unsigned long length,
+                        unsigned int warmup, unsigned int repeat)
+{
 
-    left_deepth = test_deepth(node->left);
-    right_deepth = test_deepth(node->right);
-    return left_deepth > right_deepth ? (left_deepth + 1) : (right_deepth + 1);
+    unsigned int index, sample;
+
+    printf("{\n  \"nodes\": %lu,\n  \"warmup\": %u,\n  \"repetitions\": %u,\n  \"results\": [\n",
+           length, warmup, repeat);
+    for (index = 0; index < count; ++index, ++result) {
+        printf("    {\"root\": \"%s\", \"distribution\": \"%s\", \"op\": \"%s\", "
+               "\"mean\": %.3lf, \"median\": %.3lf, \"stddev\": %.3lf, \"ci95\": %.3lf, "
+               "\"min\": %.3lf, \"max\": %.3lf, \"samples\": [", root_names[result->root],
+               dist_names[result->dist], op_names[result->op], result->mean, result->median,
+               result->stddev, result->ci95, result->min, result->max);
+        for (sample = 0; sample < result->count; ++sample)
+            printf("%s%.3lf", sample ? ", " : "", result->samples[sample]);
+        printf("]");
+        if (result->latency)
+            output_json_latency(result);
+        if (result->counters) {
+            printf(", \"counters\": {");
+            for (sample = 0; sample < BENCH_NR_COUNTERS; ++sample) {
+                printf("%s\"%s\": ", sample ? ", " : "", counter_names[sample]);
+                if (counter_fds[sample] >= 0)
+                    printf("%.3lf", result->counters[sample]);
+                else
+                    printf("null");
+            }
+            printf("}");
+        }
+        if (result->stats) {
+            printf(", \"stats\": {");
+            for (sample = 0; sample < BENCH_NR_STATS; ++sample)
+                printf("%s\"%s\": %.3lf", sample ? ", " : "", stat_names[sample], result->stats[sample]);
+            printf("}");
+        }
+        printf("}%s\n", index + 1 < count ? "," : "");
+    }
+    printf("  ]\n}\n");
 }
 
-static long demo_cmp(const struct rb_node *a, const struct rb_node *b)
+static void output_csv(const struct bench_result *result, unsigned int count, unsigned long length)
 {
-    struct bench_node *demo_a = rb_to_bench(a);
-    struct bench_node *demo_b = rb_to_bench(b);
-    return demo_a->data - demo_b->data;
+    unsigned int index, percent;
+
+    printf("root,distribution,op,nodes,mean,median,stddev,ci95,min,max,p50,p90,p99,p999,pmax");
+    for (percent = 0; percent < BENCH_NR_COUNTERS; ++percent)
+        printf(",%s", counter_names[percent]);
+    for (percent = 0; percent < BENCH_NR_STATS; ++percent)
+        printf(",%s", stat_names[percent]);
+    printf("\n");
+    for (index = 0; index < count; ++index, ++result) {
+        printf("%s,%s,%s,%lu,%.3lf,%.3lf,%.3lf,%.3lf,%.3lf,%.3lf", root_names[result->root],
+               dist_names[result->dist], op_names[result->op], length, result->mean,
+               result->median, result->stddev, result->ci95, result->min, result->max);
+        for (percent = 0; percent < 4; ++percent) {
+            if (result->latency)
+                printf(",%lu", hist_percentile(&result->latency->all, percentiles[percent]));
+            else
+                printf(",");
+        }
+        if (result->latency)
+            printf(",%lu", result->latency->all.max);
+        else
+            printf(",");
+        for (percent = 0; percent < BENCH_NR_COUNTERS; ++percent) {
+            if (result->counters && counter_fds[percent] >= 0)
+                printf(",%.3lf", result->counters[percent]);
+            else
+                printf(",");
+        }
+        for (percent = 0; percent < BENCH_NR_STATS; ++percent) {
+            if (result->stats)
+                printf(",%.3lf", result->stats[percent]);
+            else
+                printf(",");
+        }
+        printf("\n");
+    }
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
-    struct bench_node *node, *tmp;
-    struct tms start_tms, stop_tms;
-    clock_t start, stop;
-    unsigned int count, ticks;
+    unsigned int roots[BENCH_NR_OPS * 2] = {BENCH_CACHED}, nr_roots = 1;
+    unsigned int dists[BENCH_NR_OPS * 2] = {BENCH_UNIFORM}, nr_dists = 1;
+    unsigned int ops[BENCH_NR_OPS * 2] = {BENCH_INSERT, BENCH_FIND, BENCH_ITERATE, BENCH_DELETE}, nr_ops = 4;
+    unsigned int warmup = TEST_WARMUP, repeat = TEST_REPEAT, nr_results = 0;
+    unsigned int root, dist, op, run;
+    unsigned long seed = 0x9e3779b97f4a7c15UL, expect;
+    enum bench_format format = BENCH_TEXT;
+    struct bench_latency *latencies = NULL;
+    struct bench_result *results;
+    double *counters = NULL, *stats = NULL;
+    bool latency = false, perf = false, library;
+    struct rb_stats probe;
+    struct rb_trace_record *trace = NULL;
+    const char *trace_path = NULL;
+    struct bench_ctx ctx = {};
+    double *samples;
+    int opt, retval;
+
+    ctx.length = TEST_LEN;
+    while ((opt = getopt(argc, argv, "n:d:o:r:w:R:s:f:lpt:Ph")) != -1) {
+        switch (opt) {
+            case 'n':
+                ctx.length = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'd':
+                if ((retval = parse_list(optarg, dist_names, BENCH_TRACE, dists)) < 0)
+                    return retval;
+                nr_dists = retval;
+                break;
+
+            case 'o':
+                if ((retval = parse_list(optarg, op_names, BENCH_REPLAY, ops)) < 0)
+                    return retval;
+                nr_ops = retval;
+                break;
+
+            case 'r':
+                if ((retval = parse_list(optarg, root_names, BENCH_NR_ROOTS, roots)) < 0)
+                    return retval;
+                nr_roots = retval;
+                break;
+
+            case 'w':
+                warmup = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'R':
+                repeat = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                seed = strtoul(optarg, NULL, 0) | 1;
+                break;
+
+            case 'f':
+                if (!strcmp(optarg, "json"))
+                    format = BENCH_JSON;
+                else if (!strcmp(optarg, "csv"))
+                    format = BENCH_CSV;
+                else if (!strcmp(optarg, "text"))
+                    format = BENCH_TEXT;
+                else {
+                    usage(argv[0]);
+                    return -EINVAL;
+                }
+                break;
+
+            case 'l':
+                latency = true;
+                break;
+
+            case 'p':
+                perf = true;
+                break;
+
+            case 't':
+                trace_path = optarg;
+                break;
+
+            case 'P':
+                ctx.pacing = true;
+                break;
 
-    node = malloc(sizeof(*node) * TEST_LEN);
-    if (!node) {
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+
+    if (trace_path) {
+        if ((retval = rb_trace_load(trace_path, &trace, &ctx.length))) {
+            fprintf(stderr, "cannot load trace %s: %s\n", trace_path, strerror(-retval));
+            return retval;
+        }
+        ctx.trace = trace;
+        dists[0] = BENCH_TRACE;
+        ops[0] = BENCH_REPLAY;
+        nr_dists = nr_ops = 1;
+    }
+
+    if (!ctx.length || ctx.length > UINT_MAX || !repeat || !nr_roots || !nr_dists || !nr_ops) {
+        usage(argv[0]);
+        return -EINVAL;
+    }
+
+    ctx.nodes = malloc(sizeof(*ctx.nodes) * ctx.length);
+    ctx.targets = malloc(sizeof(*ctx.targets) * ctx.length);
+    results = malloc(sizeof(*results) * nr_roots * nr_dists * nr_ops);
+    samples = malloc(sizeof(*samples) * repeat * nr_roots * nr_dists * nr_ops);
+    if (latency)
+        latencies = calloc(nr_roots * nr_dists * nr_ops, sizeof(*latencies));
+    if (perf)
+        counters = calloc(nr_roots * nr_dists * nr_ops * BENCH_NR_COUNTERS, sizeof(*counters));
+    if ((library = rb_stats_read(&probe)))
+        stats = calloc(nr_roots * nr_dists * nr_ops * BENCH_NR_STATS, sizeof(*stats));
+    if (!ctx.nodes || !ctx.targets || !results || !samples ||
+        (latency && !latencies) || (perf && !counters) || (library && !stats)) {
         printf("Insufficient Memory!\n");
         return -ENOMEM;
     }
 
-    printf("Generate %u Node:\n", TEST_LEN);
-    for (count = 0; count < TEST_LEN; ++count) {
-        node[count].data = ((unsigned long)rand() << 32) | rand();
-#if RB_DEBUG
-        node[count].num = count + 1;
-        printf("\t%08d: 0x%016lx\n", node->num, node->data);
-#endif
-    }
-
-    printf("Insert Nodes:\n");
-    ticks = sysconf(_SC_CLK_TCK);
-    start = times(&start_tms);
-    for (count = 0; count < TEST_LEN; ++count)
-        bc_insert(&bench_root, &node[count].rb, demo_cmp);
-    stop = times(&stop_tms);
-    time_dump(ticks, start, stop, &start_tms, &stop_tms);
-
-    count = bc_deepth(&bench_root);
-    printf("\trb deepth: %u\n", count);
-
-    /* Start detection middle order iteration. */
-    start = times(&start_tms);
-    count = 0;
-    printf("Middle Iteration:\n");
-    bc_for_each_entry(node, &bench_root, rb) {
-        node_dump(node);
-        count++;
-    }
-    stop = times(&stop_tms);
-    printf("\ttotal num: %u\n", count);
-    time_dump(ticks, start, stop, &start_tms, &stop_tms);
-
-    /* Start detection postorder order iteration. */
-    start = times(&start_tms);
-    count = 0;
-    printf("Postorder Iteration:\n");
-    bc_post_for_each_entry(node, &bench_root, rb) {
-        node_dump(node);
-        count++;
-    }
-    stop = times(&stop_tms);
-    printf("\ttotal num: %u\n", count);
-    time_dump(ticks, start, stop, &start_tms, &stop_tms);
-
-    /* Start detection postorder order safe iteration. */
-    start = times(&start_tms);
-    count = 0;
-    printf("Postorder Safe Iteration:\n");
-    bc_post_for_each_entry_safe(node, tmp, &bench_root, rb) {
-        node_dump(node);
-        count++;
-    }
-    stop = times(&stop_tms);
-    printf("\ttotal num: %u\n", count);
-    time_dump(ticks, start, stop, &start_tms, &stop_tms);
-
-    printf("Done.\n");
-    free(node);
+    /* fault the arrays in before anything is timed */
+    memset(ctx.nodes, 0xff, sizeof(*ctx.nodes) * ctx.length);
+    memset(ctx.targets, 0, sizeof(*ctx.targets) * ctx.length);
+    ctx.overhead = time_overhead();
+    if (perf)
+        counters_open();
+
+    for (dist = 0; dist < nr_dists; ++dist) {
+        generate(&ctx, dists[dist], seed);
+
+        for (root = 0; root < nr_roots; ++root) {
+            ctx.root = roots[root];
+            ctx.cached = RB_CACHED_INIT;
+            ctx.loaded = false;
+            ctx.found = expect = 0;
+
+            if (format == BENCH_TEXT && trace) {
+                printf("%s root, trace %s (%lu ops, %u runs%s):\n", root_names[ctx.root],
+                       trace_path, ctx.length, repeat, ctx.pacing ? ", paced" : "");
+            } else if (format == BENCH_TEXT) {
+                tree_fill(&ctx);
+                printf("%s root, %s keys (%lu nodes, %u runs):\n", root_names[ctx.root],
+                       dist_names[dists[dist]], ctx.length, repeat);
+                output_shape(&ctx.cached.root);
+                tree_empty(&ctx);
+            }
+
+            for (run = 0; run < warmup + repeat; ++run) {
+                for (op = 0; op < nr_ops; ++op) {
+                    ctx.latency = latency && run >= warmup ? &latencies[nr_results + op] : NULL;
+                    ctx.counters = perf && run >= warmup ?
+                                   &counters[(nr_results + op) * BENCH_NR_COUNTERS] : NULL;
+                    ctx.stats = stats && run >= warmup ?
+                                &stats[(nr_results + op) * BENCH_NR_STATS] : NULL;
+                    if (run < warmup)
+                        phase_run(&ctx, ops[op]);
+                    else
+                        samples[(nr_results + op) * repeat + run - warmup] = phase_run(&ctx, ops[op]);
+                    if (ops[op] == BENCH_FIND || ops[op] == BENCH_ITERATE)
+                        expect += ctx.length;
+                }
+
+                if (ctx.loaded)
+                    tree_empty(&ctx);
+            }
+
+            /* every lookup targets a present key */
+            if (ctx.found != expect) {
+                printf("Mismatch!\n");
+                return -EFAULT;
+            }
+
+            for (op = 0; op < nr_ops; ++op) {
+                results[nr_results].root = roots[root];
+                results[nr_results].dist = dists[dist];
+                results[nr_results].op = ops[op];
+                results[nr_results].samples = samples + nr_results * repeat;
+                results[nr_results].count = repeat;
+                results[nr_results].latency = latency && ops[op] != BENCH_ITERATE ?
+                                              &latencies[nr_results] : NULL;
+                results[nr_results].counters = perf ? &counters[nr_results * BENCH_NR_COUNTERS] : NULL;
+                for (run = 0; perf && run < BENCH_NR_COUNTERS; ++run)
+                    results[nr_results].counters[run] /= (double)ctx.length * repeat;
+                results[nr_results].stats = stats ? &stats[nr_results * BENCH_NR_STATS] : NULL;
+                for (run = 0; stats && run < BENCH_NR_STATS; ++run)
+                    results[nr_results].stats[run] /= (double)ctx.length * repeat;
+                summarize(&results[nr_results++]);
+            }
+
+            if (format == BENCH_TEXT)
+                output_text(results + nr_results - nr_ops, nr_ops);
+        }
+    }
+
+    switch (format) {
+        case BENCH_TEXT:
+            printf("Done.\n");
+            break;
+
+        case BENCH_JSON:
+            output_json(results, nr_results, ctx.length, warmup, repeat);
+            break;
+
+        case BENCH_CSV:
+            output_csv(results, nr_results, ctx.length);
+            break;
+    }
+
+    free(ctx.nodes);
+    free(ctx.targets);
+    free(results);
+    free(samples);
+    free(latencies);
+    free(counters);
+    free(stats);
+    free(trace);
+    counters_close();
 
     return 0;
 }
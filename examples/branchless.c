@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define TEST_LEN    1000000
+#define LOOKUP_OPS  2000000
+
+struct bench_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+#define rb_to_bench(node) \
+    rb_entry(node, struct bench_node, rb)
+
+static long bench_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_bench(a)->key < rb_to_bench(b)->key ? -1 : 1;
+}
+
+static long bench_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_bench(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+/* descent picking the link with a conditional, as before child[] */
+static __attribute__((noinline)) struct rb_node *
+find_branchy(const struct rb_root *root, unsigned long key)
+{
+    struct rb_node *node = root->node;
+    unsigned long walk;
+
+    while (node) {
+        walk = rb_to_bench(node)->key;
+        if (key < walk)
+            node = node->left;
+        else if (key > walk)
+            node = node->right;
+        else
+            return node;
+    }
+
+    return NULL;
+}
+
+/* descent loading the link through the direction index */
+static __attribute__((noinline)) struct rb_node *
+find_indexed(const struct rb_root *root, unsigned long key)
+{
+    struct rb_node *node = root->node;
+    unsigned long walk;
+
+    while (node) {
+        walk = rb_to_bench(node)->key;
+        if (unlikely(key == walk))
+            return node;
+        node = node->child[key > walk];
+    }
+
+    return NULL;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* hardware counters are often missing in guests, report n/a then */
+static int misses_open(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long misses_read(int fd)
+{
+    unsigned long long value = 0;
+
+    if (fd >= 0 && read(fd, &value, sizeof(value)) != sizeof(value))
+        value = 0;
+
+    return value;
+}
+
+static void report(const char *name, double start, double stop,
+                   int fd, unsigned long long misses, unsigned long length)
+{
+    printf("\t%s: %lf ns/op", name, (stop - start) * 1e9 / length);
+    if (fd >= 0)
+        printf(", %.3lf misses/op\n", (double)(misses_read(fd) - misses) / length);
+    else
+        printf(", misses n/a\n");
+}
+
+#define measure(name, fd, length, body) do {                \
+    unsigned long long misses = misses_read(fd);            \
+    double start = time_now();                              \
+    body;                                                   \
+    report(name, start, time_now(), fd, misses, length);    \
+} while (0)
+
+int main(int argc, char *argv[])
+{
+    unsigned long count, length = TEST_LEN, seed = 0x9e3779b97f4a7c15UL, found = 0;
+    struct bench_node *nodes;
+    int fd;
+    RB_ROOT(root);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    nodes = malloc(sizeof(*nodes) * length);
+    if (!nodes || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        nodes[count].key = next_rand(&seed);
+
+    fd = misses_open();
+    printf("Direction Indexed Descent (%lu nodes):\n", length);
+
+    measure("insert", fd, length,
+        for (count = 0; count < length; ++count)
+            rb_insert(&root, &nodes[count].rb, bench_cmp));
+
+    measure("find branchy", fd, LOOKUP_OPS,
+        for (count = 0; count < LOOKUP_OPS; ++count)
+            found += !!find_branchy(&root, nodes[next_rand(&seed) % length].key));
+
+    measure("find indexed", fd, LOOKUP_OPS,
+        for (count = 0; count < LOOKUP_OPS; ++count)
+            found -= !!find_indexed(&root, nodes[next_rand(&seed) % length].key));
+
+    measure("rb_find", fd, LOOKUP_OPS,
+        for (count = 0; count < LOOKUP_OPS; ++count)
+            found += !rb_find(&root, (void *)nodes[next_rand(&seed) % length].key, bench_find));
+
+    measure("delete", fd, length,
+        for (count = 0; count < length; ++count)
+            rb_delete(&root, &nodes[count].rb));
+
+    if (fd >= 0)
+        close(fd);
+    free(nodes);
+
+    if (found || root.node) {
+        printf("Mismatch!\n");
+        return -EFAULT;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "btree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_MIN    1000000
+#define TEST_MAX    10000000
+#define LOOKUP_OPS  2000000
+
+struct std_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+struct fat_node {
+    struct bt_node bt;
+};
+
+#define rb_to_std(node) \
+    rb_entry(node, struct std_node, rb)
+
+static long std_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_std(a)->key < rb_to_std(b)->key ? -1 : 1;
+}
+
+static long std_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_std(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, double stop, unsigned long length)
+{
+    printf("\t%s: %lf ns/op\n", name, (stop - start) * 1e9 / length);
+}
+
+static int run(unsigned long length)
+{
+    unsigned long count, seed = 0x9e3779b97f4a7c15UL, sum = 0;
+    struct std_node *snodes, *snode;
+    struct fat_node *fnodes, *fnode;
+    struct bt_iter iter;
+    double start, stop;
+    RB_ROOT(sroot);
+    BT_ROOT(froot);
+
+    snodes = malloc(sizeof(*snodes) * length);
+    fnodes = malloc(sizeof(*fnodes) * length);
+    if (!snodes || !fnodes) {
+        free(snodes);
+        free(fnodes);
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        snodes[count].key = fnodes[count].bt.key = next_rand(&seed);
+
+    printf("Red-Black Tree (%lu keys):\n", length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_insert(&sroot, &snodes[count].rb, std_cmp);
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        sum += !!rb_find(&sroot, (void *)snodes[next_rand(&seed) % length].key, std_find);
+    stop = time_now();
+    report("lookup", start, stop, LOOKUP_OPS);
+
+    start = time_now();
+    rb_for_each_entry(snode, &sroot, rb)
+        sum += snode->key & 1;
+    stop = time_now();
+    report("iterate", start, stop, length);
+
+    printf("B+Tree (%u keys/page, %lu keys):\n", BT_ORDER, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        if (bt_insert(&froot, &fnodes[count].bt)) {
+            bt_destroy(&froot);
+            free(snodes);
+            free(fnodes);
+            return -ENOMEM;
+        }
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        sum -= !!bt_find(&froot, fnodes[next_rand(&seed) % length].bt.key);
+    stop = time_now();
+    report("lookup", start, stop, LOOKUP_OPS);
+
+    start = time_now();
+    bt_for_each_entry(fnode, &iter, &froot, bt)
+        sum -= fnode->bt.key & 1;
+    stop = time_now();
+    report("iterate", start, stop, length);
+
+    bt_destroy(&froot);
+    free(snodes);
+    free(fnodes);
+
+    /* both sides saw the same hits and the same keys */
+    return sum ? -EFAULT : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long length, limit = TEST_MAX;
+    int retval;
+
+    if (argc > 1)
+        limit = strtoul(argv[1], NULL, 0);
+
+    for (length = TEST_MIN; length <= limit; length *= 10) {
+        if ((retval = run(length))) {
+            printf("Abort.\n");
+            return retval;
+        }
+    }
+
+    printf("Done.\n");
+    return 0;
+}
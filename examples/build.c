@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_LEN    10000000
+#define MAX_THREADS 64
+
+struct build_node {
+    struct rb_node rb;
+    unsigned long data;
+};
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    struct build_node *node, *snapshot;
+    struct rb_node **nodes;
+    unsigned long count, length = TEST_LEN;
+    unsigned int threads, cpus;
+    double start, stop, base;
+    RB_ROOT(build_root);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    node = malloc(sizeof(*node) * length);
+    snapshot = malloc(sizeof(*snapshot) * length);
+    nodes = malloc(sizeof(*nodes) * length);
+    if (!node || !snapshot || !nodes) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        nodes[count] = &node[count].rb;
+
+    printf("Sequential Build %lu Node:\n", length);
+    memset(node, 0, sizeof(*node) * length);
+    start = time_now();
+    rb_build(&build_root, nodes, length);
+    stop = time_now();
+    base = stop - start;
+    printf("\treal time: %lf\n", base);
+    memcpy(snapshot, node, sizeof(*node) * length);
+
+    for (threads = 1; threads <= MAX_THREADS; threads <<= 1) {
+        memset(node, 0, sizeof(*node) * length);
+        build_root = RB_INIT;
+
+        printf("Parallel Build %u Threads (%u cpus):\n", threads, cpus);
+        start = time_now();
+        rb_parallel_build(&build_root, nodes, length, threads);
+        stop = time_now();
+        printf("\treal time: %lf\n", stop - start);
+        printf("\tspeed up: %lf\n", base / (stop - start));
+
+        if (memcmp(snapshot, node, sizeof(*node) * length) ||
+            (length && build_root.node != nodes[length / 2])) {
+            printf("Abort: tree differs from sequential build.\n");
+            return -EFAULT;
+        }
+    }
+
+    printf("Done.\n");
+    free(nodes);
+    free(snapshot);
+    free(node);
+
+    return 0;
+}
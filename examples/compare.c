@@ -0,0 +1,546 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+/*
+ * Comparative benchmark against alternative ordered containers.
+ *
+ * For every size from TEST_MIN up to the limit, each container gets
+ * the same distinct random keys: all are inserted in one order, each
+ * is looked up and then erased in a shuffled order, and an ordered
+ * scan runs in between. Small sizes repeat the whole round until
+ * ROUND_KEYS keys went through, so every figure is an average over
+ * enough operations. The footprint is what malloc handed out for the
+ * filled container, nodes or arrays included, divided by the keys.
+ *
+ * Erase takes the key everywhere: the intrusive trees look the node
+ * up first instead of unlinking the one they already hold.
+ *
+ * The lookups count their hits and every scan returns an in-order
+ * checksum, the run is aborted when any container disagrees.
+ */
+
+#undef DEBUG_RBTREE
+
+#include "rbtree.h"
+#include "btree.h"
+#include "skiplist.h"
+#include "compare.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <malloc.h>
+
+#define TEST_MIN    1000
+#define TEST_MAX    10000000
+#define ROUND_KEYS  1000000
+
+struct rb_key {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+/* towers are sized per node, so the links come last */
+struct sl_key {
+    unsigned long key;
+    struct sl_node sl;
+};
+
+#define rb_to_key(node) \
+    rb_entry(node, struct rb_key, rb)
+
+#define sl_to_key(node) \
+    sl_entry(node, struct sl_key, sl)
+
+static const unsigned long *keys;
+static unsigned long length;
+
+static struct rb_key *rb_keys;
+static struct bt_node *bt_keys;
+static char *sl_keys, *sl_cursor;
+
+static RB_ROOT(plain_root);
+static RB_ROOT_CACHED(cached_root);
+static BT_ROOT(bt_root);
+static SL_ROOT(sl_root);
+
+static long rb_key_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_key(a)->key < rb_to_key(b)->key ? -1 : 1;
+}
+
+static long rb_key_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_key(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static long sl_key_cmp(const struct sl_node *a, const struct sl_node *b)
+{
+    unsigned long ka = sl_to_key(a)->key, kb = sl_to_key(b)->key;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static long sl_key_find(const struct sl_node *node, const void *key)
+{
+    unsigned long kn = sl_to_key(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static int rb_setup(const unsigned long *array, unsigned long count)
+{
+    unsigned long index;
+
+    rb_keys = malloc(sizeof(*rb_keys) * count);
+    if (!rb_keys)
+        return -ENOMEM;
+
+    for (index = 0; index < count; ++index)
+        rb_keys[index].key = array[index];
+
+    return 0;
+}
+
+static void rb_release(void)
+{
+    plain_root = RB_INIT;
+    cached_root = RB_CACHED_INIT;
+    free(rb_keys);
+}
+
+static int rb_plain_insert(unsigned long index)
+{
+    rb_insert(&plain_root, &rb_keys[index].rb, rb_key_cmp);
+    return 0;
+}
+
+static bool rb_plain_find(unsigned long key)
+{
+    return !!rb_find(&plain_root, (void *)key, rb_key_find);
+}
+
+/* erase by key like the other containers, not by the known node */
+static void rb_plain_erase(unsigned long index)
+{
+    struct rb_node *node;
+
+    node = rb_find(&plain_root, (void *)keys[index], rb_key_find);
+    if (node)
+        rb_delete(&plain_root, node);
+}
+
+static unsigned long rb_plain_scan(void)
+{
+    unsigned long sum = 0;
+    struct rb_key *pos;
+
+    rb_for_each_entry(pos, &plain_root, rb)
+        sum = compare_sum(sum, pos->key);
+
+    return sum;
+}
+
+static int rb_cached_key_insert(unsigned long index)
+{
+    rb_cached_insert(&cached_root, &rb_keys[index].rb, rb_key_cmp);
+    return 0;
+}
+
+static bool rb_cached_key_find(unsigned long key)
+{
+    return !!rb_cached_find(&cached_root, (void *)key, rb_key_find);
+}
+
+static void rb_cached_key_erase(unsigned long index)
+{
+    struct rb_node *node;
+
+    node = rb_cached_find(&cached_root, (void *)keys[index], rb_key_find);
+    if (node)
+        rb_cached_delete(&cached_root, node);
+}
+
+static unsigned long rb_cached_key_scan(void)
+{
+    unsigned long sum = 0;
+    struct rb_key *pos;
+
+    rb_cached_for_each_entry(pos, &cached_root, rb)
+        sum = compare_sum(sum, pos->key);
+
+    return sum;
+}
+
+static int bt_key_setup(const unsigned long *array, unsigned long count)
+{
+    unsigned long index;
+
+    bt_keys = malloc(sizeof(*bt_keys) * count);
+    if (!bt_keys)
+        return -ENOMEM;
+
+    for (index = 0; index < count; ++index)
+        bt_keys[index].key = array[index];
+
+    return 0;
+}
+
+static int bt_key_insert(unsigned long index)
+{
+    return bt_insert(&bt_root, &bt_keys[index]);
+}
+
+static bool bt_key_find(unsigned long key)
+{
+    return !!bt_find(&bt_root, key);
+}
+
+static void bt_key_erase(unsigned long index)
+{
+    bt_delete(&bt_root, &bt_keys[index]);
+}
+
+static unsigned long bt_key_scan(void)
+{
+    unsigned long sum = 0;
+    struct bt_node *pos;
+    struct bt_iter iter;
+
+    bt_for_each(pos, &iter, &bt_root)
+        sum = compare_sum(sum, pos->key);
+
+    return sum;
+}
+
+static void bt_key_release(void)
+{
+    bt_destroy(&bt_root);
+    free(bt_keys);
+}
+
+static size_t sl_key_size(unsigned int level)
+{
+    return sizeof(struct sl_key) + SL_NODE_SIZE(level) - sizeof(struct sl_node);
+}
+
+/* one block carved into nodes with exact towers, in insertion order */
+static int sl_key_setup(const unsigned long *array, unsigned long count)
+{
+    unsigned char *levels;
+    struct sl_key *node;
+    unsigned long index;
+    size_t size = 0;
+    char *walk;
+
+    levels = malloc(count);
+    if (!levels)
+        return -ENOMEM;
+
+    for (index = 0; index < count; ++index) {
+        levels[index] = sl_random_level(SL_MAX_LEVEL);
+        size += sl_key_size(levels[index]);
+    }
+
+    sl_keys = malloc(size);
+    if (!sl_keys) {
+        free(levels);
+        return -ENOMEM;
+    }
+
+    walk = sl_keys;
+    for (index = 0; index < count; ++index) {
+        node = (struct sl_key *)walk;
+        node->key = array[index];
+        sl_node_init(&node->sl, levels[index]);
+        walk += sl_key_size(levels[index]);
+    }
+
+    free(levels);
+    return 0;
+}
+
+/* insert walks the keys in order, so the nodes follow each other */
+static int sl_key_insert(unsigned long index)
+{
+    struct sl_key *node;
+
+    if (!index)
+        sl_cursor = sl_keys;
+
+    node = (struct sl_key *)sl_cursor;
+    sl_cursor += sl_key_size(node->sl.level);
+
+    /* the keys are distinct, a refusal is a broken list */
+    return sl_insert(&sl_root, &node->sl, sl_key_cmp) ? 0 : -EFAULT;
+}
+
+static bool sl_key_find_one(unsigned long key)
+{
+    return !!sl_find(&sl_root, (void *)key, sl_key_find);
+}
+
+static void sl_key_erase(unsigned long index)
+{
+    struct sl_node *node;
+
+    node = sl_find(&sl_root, (void *)keys[index], sl_key_find);
+    if (node)
+        sl_delete(&sl_root, node, sl_key_cmp);
+}
+
+static unsigned long sl_key_scan(void)
+{
+    unsigned long sum = 0;
+    struct sl_node *pos;
+
+    for (pos = sl_first(&sl_root); pos; pos = sl_next(pos))
+        sum = compare_sum(sum, sl_to_key(pos)->key);
+
+    return sum;
+}
+
+static void sl_key_release(void)
+{
+    sl_root = SL_INIT;
+    free(sl_keys);
+}
+
+static const struct compare_ops rb_root_ops = {
+    .name = "rb_root",
+    .limit = ~0UL,
+    .setup = rb_setup,
+    .insert = rb_plain_insert,
+    .find = rb_plain_find,
+    .erase = rb_plain_erase,
+    .scan = rb_plain_scan,
+    .release = rb_release,
+};
+
+static const struct compare_ops rb_cached_ops = {
+    .name = "rb_root_cached",
+    .limit = ~0UL,
+    .setup = rb_setup,
+    .insert = rb_cached_key_insert,
+    .find = rb_cached_key_find,
+    .erase = rb_cached_key_erase,
+    .scan = rb_cached_key_scan,
+    .release = rb_release,
+};
+
+static const struct compare_ops bt_ops = {
+    .name = "btree",
+    .limit = ~0UL,
+    .setup = bt_key_setup,
+    .insert = bt_key_insert,
+    .find = bt_key_find,
+    .erase = bt_key_erase,
+    .scan = bt_key_scan,
+    .release = bt_key_release,
+};
+
+static const struct compare_ops sl_ops = {
+    .name = "skiplist",
+    .limit = ~0UL,
+    .setup = sl_key_setup,
+    .insert = sl_key_insert,
+    .find = sl_key_find_one,
+    .erase = sl_key_erase,
+    .scan = sl_key_scan,
+    .release = sl_key_release,
+};
+
+static const struct compare_ops *containers[] = {
+    &rb_root_ops, &rb_cached_ops, &std_map_ops, &std_set_ops,
+    &sorted_vector_ops, &bt_ops, &sl_ops,
+};
+
+#define NR_CONTAINERS \
+    (sizeof(containers) / sizeof(*containers))
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+/* a bijection, so distinct indexes give distinct keys */
+static unsigned long mix_key(unsigned long index)
+{
+    index ^= index >> 30;
+    index *= 0xbf58476d1ce4e5b9UL;
+    index ^= index >> 27;
+    index *= 0x94d049bb133111ebUL;
+    return index ^ (index >> 31);
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t heap_used(void)
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static void report(double seconds, unsigned long ops)
+{
+    if (ops)
+        printf(" %10.1lf", seconds * 1e9 / ops);
+    else
+        printf(" %10s", "-");
+}
+
+/**
+ * measure - run the rounds of one container at one size.
+ * @ops: container to measure.
+ * @order: shuffled indexes for lookups and erases.
+ * @rounds: number of build and teardown rounds.
+ * @checksum: in-order checksum, taken from the first container.
+ */
+static int measure(const struct compare_ops *ops, const unsigned long *order,
+                   unsigned long rounds, unsigned long *checksum)
+{
+    double insert = 0, find = 0, erase = 0, scan = 0, start;
+    unsigned long round, count, hits = 0, sum;
+    bool single = length <= ops->limit;
+    size_t heap = heap_used(), footprint = 0;
+    int retval;
+
+    if ((retval = ops->setup(keys, length)))
+        return retval;
+
+    for (round = 0; round < rounds; ++round) {
+        start = time_now();
+        if (single) {
+            for (count = 0; count < length; ++count) {
+                if ((retval = ops->insert(count)))
+                    goto release;
+            }
+        } else if ((retval = ops->build()))
+            goto release;
+        insert += time_now() - start;
+
+        if (!round)
+            footprint = heap_used() - heap;
+
+        start = time_now();
+        for (count = 0; count < length; ++count)
+            hits += ops->find(keys[order[count]]);
+        find += time_now() - start;
+
+        start = time_now();
+        sum = ops->scan();
+        scan += time_now() - start;
+
+        start = time_now();
+        if (single) {
+            for (count = 0; count < length; ++count)
+                ops->erase(order[count]);
+        } else
+            ops->clear();
+        erase += time_now() - start;
+
+        if (!round && !*checksum)
+            *checksum = sum;
+
+        if (sum != *checksum || ops->scan()) {
+            printf("%s: scan mismatch\n", ops->name);
+            retval = -EFAULT;
+            goto release;
+        }
+    }
+
+    if (hits != length * rounds) {
+        printf("%s: %lu of %lu lookups missed\n", ops->name,
+               length * rounds - hits, length * rounds);
+        retval = -EFAULT;
+        goto release;
+    }
+
+    printf("  %-16s", ops->name);
+    report(insert, single ? length * rounds : 0);
+    report(find, length * rounds);
+    report(erase, single ? length * rounds : 0);
+    report(scan, length * rounds);
+    printf(" %12.1lf\n", (double)footprint / length);
+
+release:
+    ops->release();
+    return retval;
+}
+
+static int run(unsigned long *order)
+{
+    unsigned long count, rounds, swap, value, seed = 0x9e3779b97f4a7c15UL, checksum = 0;
+    unsigned long *array;
+    int retval = 0;
+
+    array = malloc(sizeof(*array) * length);
+    if (!array)
+        return -ENOMEM;
+
+    for (count = 0; count < length; ++count) {
+        array[count] = mix_key(count + 1);
+        order[count] = count;
+    }
+
+    for (count = length - 1; count; --count) {
+        swap = next_rand(&seed) % (count + 1);
+        value = order[count];
+        order[count] = order[swap];
+        order[swap] = value;
+    }
+
+    keys = array;
+    rounds = length < ROUND_KEYS ? ROUND_KEYS / length : 1;
+
+    printf("%lu keys (%lu rounds), ns/op:\n", length, rounds);
+    printf("  %-16s %10s %10s %10s %10s %12s\n", "container",
+           "insert", "find", "erase", "scan", "bytes/key");
+
+    for (count = 0; count < NR_CONTAINERS; ++count) {
+        if ((retval = measure(containers[count], order, rounds, &checksum)))
+            break;
+    }
+
+    free(array);
+    return retval;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long limit = TEST_MAX;
+    unsigned long *order;
+    int retval = 0;
+
+    if (argc > 1)
+        limit = strtoul(argv[1], NULL, 0);
+
+    order = malloc(sizeof(*order) * (limit < TEST_MIN ? TEST_MIN : limit));
+    if (!order) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (length = TEST_MIN; length <= limit; length *= 10) {
+        if ((retval = run(order))) {
+            printf("Abort.\n");
+            break;
+        }
+    }
+
+    free(order);
+    if (!retval)
+        printf("Done.\n");
+
+    return retval;
+}
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _COMPARE_H_
+#define _COMPARE_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One ordered container under test. setup() hands over the keys
+ * once, insert and erase then take an index into that array, so
+ * every container sees the same keys in the same order. Containers
+ * with a @limit only insert and erase one by one up to that size and
+ * are bulk loaded through build() and clear() beyond it.
+ */
+struct compare_ops {
+    const char *name;
+    unsigned long limit;
+    int (*setup)(const unsigned long *keys, unsigned long length);
+    int (*insert)(unsigned long index);
+    bool (*find)(unsigned long key);
+    void (*erase)(unsigned long index);
+    unsigned long (*scan)(void);
+    int (*build)(void);
+    void (*clear)(void);
+    void (*release)(void);
+};
+
+/* in-order checksum every scan() returns */
+#define compare_sum(sum, key) \
+    ((sum) * 31 + (key))
+
+extern const struct compare_ops std_map_ops;
+extern const struct compare_ops std_set_ops;
+extern const struct compare_ops sorted_vector_ops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _COMPARE_H_ */
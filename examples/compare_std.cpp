@@ -0,0 +1,201 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+/*
+ * The libstdc++ side of examples/compare: std::map, std::set and a
+ * sorted std::vector searched with std::lower_bound. Allocation
+ * failures are turned into -ENOMEM at the C boundary.
+ */
+
+#include "compare.h"
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <cerrno>
+
+#define SORTED_LIMIT    100000
+
+static const unsigned long *keys;
+static unsigned long length;
+
+static std::map<unsigned long, unsigned long> map;
+static std::set<unsigned long> set;
+static std::vector<unsigned long> vector;
+
+static int std_setup(const unsigned long *array, unsigned long count)
+{
+    keys = array;
+    length = count;
+    return 0;
+}
+
+static int map_insert(unsigned long index)
+{
+    try {
+        map.emplace(keys[index], index);
+    } catch (const std::bad_alloc &) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+static bool map_find(unsigned long key)
+{
+    return map.find(key) != map.end();
+}
+
+static void map_erase(unsigned long index)
+{
+    map.erase(keys[index]);
+}
+
+static unsigned long map_scan(void)
+{
+    unsigned long sum = 0;
+
+    for (const auto &entry : map)
+        sum = compare_sum(sum, entry.first);
+
+    return sum;
+}
+
+static void map_release(void)
+{
+    map.clear();
+}
+
+static int set_insert(unsigned long index)
+{
+    try {
+        set.insert(keys[index]);
+    } catch (const std::bad_alloc &) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+static bool set_find(unsigned long key)
+{
+    return set.find(key) != set.end();
+}
+
+static void set_erase(unsigned long index)
+{
+    set.erase(keys[index]);
+}
+
+static unsigned long set_scan(void)
+{
+    unsigned long sum = 0;
+
+    for (unsigned long key : set)
+        sum = compare_sum(sum, key);
+
+    return sum;
+}
+
+static void set_release(void)
+{
+    set.clear();
+}
+
+static int vector_insert(unsigned long index)
+{
+    unsigned long key = keys[index];
+
+    try {
+        vector.insert(std::lower_bound(vector.begin(), vector.end(), key), key);
+    } catch (const std::bad_alloc &) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+static bool vector_find(unsigned long key)
+{
+    return std::binary_search(vector.begin(), vector.end(), key);
+}
+
+static void vector_erase(unsigned long index)
+{
+    auto pos = std::lower_bound(vector.begin(), vector.end(), keys[index]);
+
+    if (pos != vector.end() && *pos == keys[index])
+        vector.erase(pos);
+}
+
+static unsigned long vector_scan(void)
+{
+    unsigned long sum = 0;
+
+    for (unsigned long key : vector)
+        sum = compare_sum(sum, key);
+
+    return sum;
+}
+
+static int vector_build(void)
+{
+    try {
+        vector.assign(keys, keys + length);
+    } catch (const std::bad_alloc &) {
+        return -ENOMEM;
+    }
+
+    std::sort(vector.begin(), vector.end());
+    return 0;
+}
+
+static void vector_clear(void)
+{
+    vector.clear();
+}
+
+static void vector_release(void)
+{
+    std::vector<unsigned long>().swap(vector);
+}
+
+const struct compare_ops std_map_ops = {
+    .name = "std::map",
+    .limit = ~0UL,
+    .setup = std_setup,
+    .insert = map_insert,
+    .find = map_find,
+    .erase = map_erase,
+    .scan = map_scan,
+    .build = nullptr,
+    .clear = nullptr,
+    .release = map_release,
+};
+
+const struct compare_ops std_set_ops = {
+    .name = "std::set",
+    .limit = ~0UL,
+    .setup = std_setup,
+    .insert = set_insert,
+    .find = set_find,
+    .erase = set_erase,
+    .scan = set_scan,
+    .build = nullptr,
+    .clear = nullptr,
+    .release = set_release,
+};
+
+/* inserting and erasing in the middle moves half the array each time */
+const struct compare_ops sorted_vector_ops = {
+    .name = "sorted vector",
+    .limit = SORTED_LIMIT,
+    .setup = std_setup,
+    .insert = vector_insert,
+    .find = vector_find,
+    .erase = vector_erase,
+    .scan = vector_scan,
+    .build = vector_build,
+    .clear = vector_clear,
+    .release = vector_release,
+};
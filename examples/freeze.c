@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "frozen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_MIN    1000
+#define TEST_MAX    10000000
+#define QUERY_OPS   1000000
+
+struct freeze_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+#define rb_to_freeze(node) \
+    rb_entry(node, struct freeze_node, rb)
+
+static long freeze_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_freeze(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long freeze_key(const struct rb_node *node)
+{
+    return rb_to_freeze(node)->key;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run(unsigned long length)
+{
+    unsigned long count, index, seed = 0x9e3779b97f4a7c15UL, found = 0;
+    struct freeze_node *nodes;
+    struct rb_node **sorted;
+    struct rb_frozen frozen;
+    unsigned long *perm, swap;
+    double start, stop;
+    RB_ROOT(root);
+
+    nodes = malloc(sizeof(*nodes) * length);
+    sorted = malloc(sizeof(*sorted) * length);
+    perm = malloc(sizeof(*perm) * length);
+    if (!nodes || !sorted || !perm) {
+        free(nodes);
+        free(sorted);
+        free(perm);
+        return -ENOMEM;
+    }
+
+    /* place consecutive keys in random slots to defeat address order */
+    for (count = 0; count < length; ++count)
+        perm[count] = count;
+    for (count = length; count > 1; --count) {
+        index = next_rand(&seed) % count;
+        swap = perm[index];
+        perm[index] = perm[count - 1];
+        perm[count - 1] = swap;
+    }
+    for (count = 0; count < length; ++count) {
+        nodes[perm[count]].key = count * 4;
+        sorted[count] = &nodes[perm[count]].rb;
+    }
+
+    rb_build(&root, sorted, length);
+    if (rb_freeze(&frozen, &root, freeze_key)) {
+        free(nodes);
+        free(sorted);
+        free(perm);
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < QUERY_OPS; ++count)
+        perm[count % length] = next_rand(&seed) % (length * 4);
+
+    printf("%10lu keys:", length);
+
+    start = time_now();
+    for (count = 0; count < QUERY_OPS; ++count)
+        found += !!rb_find(&root, (void *)(perm[count % length] & ~3UL), freeze_find);
+    stop = time_now();
+    printf("  rb_find %8.2lf", (stop - start) * 1e9 / QUERY_OPS);
+
+    start = time_now();
+    for (count = 0; count < QUERY_OPS; ++count)
+        found -= !!rb_frozen_find(&frozen, perm[count % length] & ~3UL);
+    stop = time_now();
+    printf("  frozen_find %8.2lf", (stop - start) * 1e9 / QUERY_OPS);
+
+    start = time_now();
+    for (count = 0; count < QUERY_OPS; ++count)
+        found += rb_to_freeze(rb_frozen_lower_bound(&frozen, perm[count % length] & ~3UL))->key & 1;
+    stop = time_now();
+    printf("  lower_bound %8.2lf ns/op\n", (stop - start) * 1e9 / QUERY_OPS);
+
+    rb_frozen_destroy(&frozen);
+    free(nodes);
+    free(sorted);
+    free(perm);
+
+    /* both searches hit the same keys, and every key is even */
+    return found ? -EFAULT : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long length, limit = TEST_MAX;
+    int retval;
+
+    if (argc > 1)
+        limit = strtoul(argv[1], NULL, 0);
+
+    printf("Frozen Eytzinger Search (prefetch %u levels):\n", RB_FROZEN_PREFETCH);
+    for (length = TEST_MIN; length <= limit; length *= 10) {
+        if ((retval = run(length))) {
+            printf("Abort.\n");
+            return retval;
+        }
+    }
+
+    printf("Done.\n");
+    return 0;
+}
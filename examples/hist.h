@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _HIST_H_
+#define _HIST_H_
+
+#include <math.h>
+
+/*
+ * Log-linear latency histogram shared by the benchmarks: values below
+ * HIST_SUB get a bucket each, every octave above is split into
+ * HIST_SUB linear steps, so a bucket is at most 1/HIST_SUB wide
+ * relative to its values. Define HIST_SUB_BITS before the include to
+ * trade precision for size.
+ */
+#ifndef HIST_SUB_BITS
+# define HIST_SUB_BITS  5
+#endif
+
+#define HIST_SUB        (1U << HIST_SUB_BITS)
+#define HIST_BUCKETS    ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+struct hist {
+    unsigned long count[HIST_BUCKETS];
+    unsigned long total;
+    unsigned long max;
+};
+
+static inline unsigned int hist_index(unsigned long value)
+{
+    unsigned int shift;
+
+    if (value < HIST_SUB)
+        return value;
+
+    shift = (63 - __builtin_clzl(value)) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (value >> shift) - HIST_SUB;
+}
+
+/* highest value falling into a bucket */
+static inline unsigned long hist_value(unsigned int index)
+{
+    unsigned int shift;
+
+    if (index < HIST_SUB)
+        return index;
+
+    shift = index / HIST_SUB - 1;
+    return ((index % HIST_SUB + HIST_SUB + 1UL) << shift) - 1;
+}
+
+static inline void hist_record(struct hist *hist, unsigned long value)
+{
+    hist->count[hist_index(value)]++;
+    hist->total++;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+static inline void hist_merge(struct hist *hist, const struct hist *other)
+{
+    unsigned int index;
+
+    for (index = 0; index < HIST_BUCKETS; ++index)
+        hist->count[index] += other->count[index];
+    hist->total += other->total;
+    if (other->max > hist->max)
+        hist->max = other->max;
+}
+
+/* upper bound of the bucket holding the percentile, capped by the maximum */
+static inline unsigned long hist_percentile(const struct hist *hist, double percent)
+{
+    unsigned long target, sum = 0;
+    unsigned int index;
+
+    target = ceil(hist->total * percent / 100);
+    if (!target)
+        target = 1;
+
+    for (index = 0; index < HIST_BUCKETS; ++index) {
+        if ((sum += hist->count[index]) >= target)
+            break;
+    }
+
+    return index < HIST_BUCKETS && hist_value(index) < hist->max ?
+           hist_value(index) : hist->max;
+}
+
+/* values landing in buckets past the one holding @value */
+static inline unsigned long hist_above(const struct hist *hist, unsigned long value)
+{
+    unsigned long sum = 0;
+    unsigned int index;
+
+    for (index = hist_index(value) + 1; index < HIST_BUCKETS; ++index)
+        sum += hist->count[index];
+
+    return sum;
+}
+
+#endif  /* _HIST_H_ */
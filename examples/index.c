@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "rbindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN 1000000
+
+struct ptr_node {
+    struct rb_node rb;
+    uint32_t key;
+};
+
+struct idx_node {
+    struct rbi_node rb;
+    uint32_t key;
+};
+
+#define rb_to_ptr(node) \
+    rb_entry(node, struct ptr_node, rb)
+
+#define rb_to_idx(node) \
+    rbi_entry(node, struct idx_node, rb)
+
+static long ptr_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_ptr(a)->key < rb_to_ptr(b)->key ? -1 : 1;
+}
+
+static long ptr_find(const struct rb_node *node, const void *key)
+{
+    uint32_t kn = rb_to_ptr(node)->key, kk = (uintptr_t)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static long idx_cmp(const struct rbi_node *a, const struct rbi_node *b)
+{
+    return rb_to_idx(a)->key < rb_to_idx(b)->key ? -1 : 1;
+}
+
+static long idx_find(const struct rbi_node *node, const void *key)
+{
+    uint32_t kn = rb_to_idx(node)->key, kk = (uintptr_t)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, double stop, unsigned long length)
+{
+    printf("\t%s: %lf ns/op\n", name, (stop - start) * 1e9 / length);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count, length = TEST_LEN, found;
+    struct ptr_node *pnodes, *pnode;
+    struct idx_node *inodes, *inode;
+    struct rbi_root iroot;
+    double start, stop;
+    uint32_t *keys;
+    RB_ROOT(proot);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    if (!length || length > RBI_MAX_NODES) {
+        printf("Invalid Length!\n");
+        return -EINVAL;
+    }
+
+    keys = malloc(sizeof(*keys) * length);
+    pnodes = malloc(sizeof(*pnodes) * length);
+    inodes = malloc(sizeof(*inodes) * length);
+    if (!keys || !pnodes || !inodes) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        keys[count] = rand();
+
+    printf("Pointer Tree (%zu bytes/node, %.1lf MiB):\n", sizeof(*pnodes),
+           (double)sizeof(*pnodes) * length / (1 << 20));
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        pnodes[count].key = keys[count];
+        rb_insert(&proot, &pnodes[count].rb, ptr_cmp);
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    found = 0;
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        found += !!rb_find(&proot, (void *)(uintptr_t)keys[count], ptr_find);
+    stop = time_now();
+    report("find", start, stop, length);
+
+    start = time_now();
+    rb_for_each_entry(pnode, &proot, rb)
+        found += pnode->key & 1;
+    stop = time_now();
+    report("traverse", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_delete(&proot, &pnodes[count].rb);
+    stop = time_now();
+    report("delete", start, stop, length);
+
+    printf("Index Tree (%zu bytes/node, %.1lf MiB):\n", sizeof(*inodes),
+           (double)sizeof(*inodes) * length / (1 << 20));
+    iroot = RBI_INIT(inodes, rb);
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        inodes[count].key = keys[count];
+        rbi_insert(&iroot, &inodes[count].rb, idx_cmp);
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        found -= !!rbi_find(&iroot, (void *)(uintptr_t)keys[count], idx_find);
+    stop = time_now();
+    report("find", start, stop, length);
+
+    start = time_now();
+    rbi_for_each_entry(inode, &iroot, rb)
+        found -= inode->key & 1;
+    stop = time_now();
+    report("traverse", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rbi_delete(&iroot, &inodes[count].rb);
+    stop = time_now();
+    report("delete", start, stop, length);
+
+    free(keys);
+    free(pnodes);
+    free(inodes);
+
+    if (found) {
+        printf("Mismatch!\n");
+        return -EFAULT;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
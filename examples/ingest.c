@@ -0,0 +1,150 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "ingest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    1000000
+#define MAX_THREADS 64
+#define BUFFER_LEN  1024
+
+struct ingest_node {
+    struct rb_node rb;
+    unsigned long data;
+};
+
+struct ingest_worker {
+    pthread_t thread;
+    struct rb_ingest *ingest;
+    struct ingest_node *nodes;
+    unsigned long count;
+};
+
+#define rb_to_ingest(node) \
+    rb_entry(node, struct ingest_node, rb)
+
+static long demo_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    struct ingest_node *demo_a = rb_to_ingest(a);
+    struct ingest_node *demo_b = rb_to_ingest(b);
+    return demo_a->data < demo_b->data ? -1 : demo_a->data > demo_b->data;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *locked_worker(void *pdata)
+{
+    struct ingest_worker *worker = pdata;
+    struct rb_ingest *ingest = worker->ingest;
+    unsigned long count;
+
+    for (count = 0; count < worker->count; ++count) {
+        pthread_mutex_lock(&ingest->lock);
+        rb_cached_insert(&ingest->cached, &worker->nodes[count].rb, ingest->cmp);
+        pthread_mutex_unlock(&ingest->lock);
+    }
+
+    return NULL;
+}
+
+static void *buffered_worker(void *pdata)
+{
+    struct ingest_worker *worker = pdata;
+    struct rb_ingest_buffer buffer;
+    unsigned long count;
+
+    if (rb_ingest_buffer_init(&buffer, worker->ingest, BUFFER_LEN))
+        return NULL;
+
+    for (count = 0; count < worker->count; ++count)
+        rb_ingest_add(&buffer, &worker->nodes[count].rb);
+
+    rb_ingest_buffer_destroy(&buffer);
+    return NULL;
+}
+
+static int run(const char *name, void *(*func)(void *), struct ingest_node *nodes,
+               unsigned long length, unsigned int threads)
+{
+    struct ingest_worker workers[MAX_THREADS];
+    struct ingest_node *node, *prev = NULL;
+    struct rb_ingest ingest;
+    unsigned long count, share;
+    double start, stop;
+    unsigned int index;
+
+    if (rb_ingest_init(&ingest, demo_cmp))
+        return -ENOMEM;
+
+    share = length / threads;
+    for (index = 0; index < threads; ++index) {
+        workers[index].ingest = &ingest;
+        workers[index].nodes = nodes + share * index;
+        workers[index].count = index == threads - 1 ? length - share * index : share;
+    }
+
+    start = time_now();
+    for (index = 0; index < threads; ++index)
+        pthread_create(&workers[index].thread, NULL, func, &workers[index]);
+    for (index = 0; index < threads; ++index)
+        pthread_join(workers[index].thread, NULL);
+    stop = time_now();
+
+    printf("\t%-8s %2u threads: %8.2lf ns/op\n", name, threads,
+           (stop - start) * 1e9 / length);
+
+    count = 0;
+    rb_cached_for_each_entry(node, &ingest.cached, rb) {
+        if (prev && prev->data > node->data)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    rb_ingest_destroy(&ingest);
+    return count == length ? 0 : -ENODATA;
+}
+
+int main(int argc, char *argv[])
+{
+    struct ingest_node *nodes;
+    unsigned long count, length = TEST_LEN;
+    unsigned int threads;
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    nodes = malloc(sizeof(*nodes) * length);
+    if (!nodes) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        nodes[count].data = ((unsigned long)rand() << 32) | rand();
+
+    printf("Ingest %lu Node:\n", length);
+    for (threads = 1; threads <= MAX_THREADS; threads <<= 1) {
+        if (run("locked", locked_worker, nodes, length, threads) ||
+            run("buffered", buffered_worker, nodes, length, threads)) {
+            printf("Abort.\n");
+            return -EFAULT;
+        }
+    }
+
+    printf("Done.\n");
+    free(nodes);
+
+    return 0;
+}
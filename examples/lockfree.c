@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "skiplist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define KEY_RANGE   (1UL << 20)
+#define TEST_OPS    2000000
+#define READ_RATIO  90
+#define MAX_THREADS 256
+
+struct lf_node {
+    SL_NODE(sl, SL_MAX_LEVEL);
+    struct rb_node rb;
+    unsigned long key;
+};
+
+struct lf_worker {
+    pthread_t thread;
+    struct lf_node *pool;
+    unsigned long ops, seed;
+    unsigned long found;
+};
+
+#define sl_to_lf(node) \
+    sl_entry(node, struct lf_node, sl)
+
+#define rb_to_lf(node) \
+    rb_entry(node, struct lf_node, rb)
+
+static SL_ROOT(sl_root);
+static RB_ROOT(rb_root);
+static pthread_mutex_t rb_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int read_ratio = READ_RATIO;
+
+static long sl_cmp(const struct sl_node *a, const struct sl_node *b)
+{
+    unsigned long ka = sl_to_lf(a)->key, kb = sl_to_lf(b)->key;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static long sl_key(const struct sl_node *node, const void *key)
+{
+    unsigned long kn = sl_to_lf(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static long rb_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    unsigned long ka = rb_to_lf(a)->key, kb = rb_to_lf(b)->key;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static long rb_key(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_lf(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *sl_worker(void *pdata)
+{
+    struct lf_worker *worker = pdata;
+    struct sl_node *node;
+    unsigned long count, rand, used = 0;
+
+    for (count = 0; count < worker->ops; ++count) {
+        rand = next_rand(&worker->seed);
+        if (rand % 100 < read_ratio) {
+            worker->found += !!sl_find(&sl_root, (void *)(rand % KEY_RANGE), sl_key);
+        } else if (rand & (1UL << 40)) {
+            worker->pool[used].key = (rand >> 8) % KEY_RANGE;
+            sl_node_init(&worker->pool[used].sl, sl_random_level(SL_MAX_LEVEL));
+            used += sl_insert(&sl_root, &worker->pool[used].sl, sl_cmp);
+        } else {
+            /* deleted nodes are never reused, no reclamation needed */
+            node = sl_find(&sl_root, (void *)((rand >> 8) % KEY_RANGE), sl_key);
+            if (node)
+                sl_delete(&sl_root, node, sl_cmp);
+        }
+    }
+
+    return NULL;
+}
+
+static void *rb_worker(void *pdata)
+{
+    struct lf_worker *worker = pdata;
+    struct rb_node *node;
+    unsigned long count, rand, used = 0;
+
+    for (count = 0; count < worker->ops; ++count) {
+        rand = next_rand(&worker->seed);
+        if (rand % 100 < read_ratio) {
+            pthread_mutex_lock(&rb_lock);
+            worker->found += !!rb_find(&rb_root, (void *)(rand % KEY_RANGE), rb_key);
+            pthread_mutex_unlock(&rb_lock);
+        } else if (rand & (1UL << 40)) {
+            worker->pool[used].key = (rand >> 8) % KEY_RANGE;
+            pthread_mutex_lock(&rb_lock);
+            used += !rb_insert_conflict(&rb_root, &worker->pool[used].rb, rb_cmp);
+            pthread_mutex_unlock(&rb_lock);
+        } else {
+            pthread_mutex_lock(&rb_lock);
+            node = rb_find(&rb_root, (void *)((rand >> 8) % KEY_RANGE), rb_key);
+            if (node)
+                rb_delete(&rb_root, node);
+            pthread_mutex_unlock(&rb_lock);
+        }
+    }
+
+    return NULL;
+}
+
+static double run(void *(*func)(void *), struct lf_worker *workers, unsigned int threads)
+{
+    double start, stop;
+    unsigned int index;
+
+    start = time_now();
+    for (index = 0; index < threads; ++index)
+        pthread_create(&workers[index].thread, NULL, func, &workers[index]);
+    for (index = 0; index < threads; ++index)
+        pthread_join(workers[index].thread, NULL);
+    stop = time_now();
+
+    return TEST_OPS / (stop - start) / 1e6;
+}
+
+static struct lf_node *prepare(struct lf_worker *workers, unsigned int threads)
+{
+    struct lf_node *prefill;
+    unsigned long count;
+    unsigned int index;
+
+    sl_root = SL_INIT;
+    rb_root = RB_INIT;
+
+    prefill = malloc(sizeof(*prefill) * (KEY_RANGE / 2));
+    if (!prefill)
+        return NULL;
+
+    for (count = 0; count < KEY_RANGE / 2; ++count) {
+        prefill[count].key = count * 2;
+        sl_node_init(&prefill[count].sl, sl_random_level(SL_MAX_LEVEL));
+        sl_insert(&sl_root, &prefill[count].sl, sl_cmp);
+        rb_insert(&rb_root, &prefill[count].rb, rb_cmp);
+    }
+
+    for (index = 0; index < threads; ++index) {
+        workers[index].ops = TEST_OPS / threads;
+        workers[index].seed = index * 0x9e3779b97f4a7c15UL + 1;
+        workers[index].found = 0;
+        workers[index].pool = malloc(sizeof(*workers->pool) * workers[index].ops);
+        if (!workers[index].pool)
+            return NULL;
+    }
+
+    return prefill;
+}
+
+static void cleanup(struct lf_worker *workers, unsigned int threads, struct lf_node *prefill)
+{
+    unsigned int index;
+
+    for (index = 0; index < threads; ++index)
+        free(workers[index].pool);
+    free(prefill);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct lf_worker workers[MAX_THREADS];
+    unsigned int threads, cpus;
+    struct lf_node *prefill;
+    double sl_mops, rb_mops;
+
+    if (argc > 1)
+        read_ratio = atoi(argv[1]);
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > MAX_THREADS)
+        cpus = MAX_THREADS;
+
+    printf("Mixed Workload (%u%% find, %u cpus):\n", read_ratio, cpus);
+    for (threads = 1;; threads <<= 1) {
+        if (threads > cpus)
+            threads = cpus;
+
+        /* both structures start from the same prefilled key set */
+        if (!(prefill = prepare(workers, threads))) {
+            printf("Insufficient Memory!\n");
+            return -ENOMEM;
+        }
+        rb_mops = run(rb_worker, workers, threads);
+        cleanup(workers, threads, prefill);
+
+        if (!(prefill = prepare(workers, threads))) {
+            printf("Insufficient Memory!\n");
+            return -ENOMEM;
+        }
+        sl_mops = run(sl_worker, workers, threads);
+        cleanup(workers, threads, prefill);
+
+        printf("\t%3u threads: mutex rbtree %8.3lf Mops/s, skiplist %8.3lf Mops/s\n",
+               threads, rb_mops, sl_mops);
+
+        if (threads == cpus)
+            break;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    1000000
+#define CHURN_OPS   4000000
+
+struct pool_node {
+    struct rb_node rb;
+    unsigned long data;
+};
+
+#define rb_to_pool(node) \
+    rb_entry(node, struct pool_node, rb)
+
+static struct rb_pool pool;
+
+static long demo_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    struct pool_node *demo_a = rb_to_pool(a);
+    struct pool_node *demo_b = rb_to_pool(b);
+    return demo_a->data < demo_b->data ? -1 : 1;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *malloc_alloc(void)
+{
+    return malloc(sizeof(struct pool_node));
+}
+
+static void malloc_release(struct rb_root *root)
+{
+    struct pool_node *node, *tmp;
+
+    rb_post_for_each_entry_safe(node, tmp, root, rb)
+        free(node);
+    *root = RB_INIT;
+}
+
+static void *pool_alloc(void)
+{
+    return rb_pool_alloc(&pool);
+}
+
+static void pool_free(void *object)
+{
+    rb_pool_free(&pool, object);
+}
+
+static void pool_release(struct rb_root *root)
+{
+    rb_pool_free_entries(&pool, root, struct pool_node, rb);
+}
+
+static int run(const char *name, struct pool_node **live, unsigned long length,
+               void *(*alloc)(void), void (*release)(void *), void (*teardown)(struct rb_root *))
+{
+    unsigned long count, index, seed = 0x9e3779b97f4a7c15UL, sum = 0;
+    struct pool_node *node;
+    double start, stop;
+    RB_ROOT(root);
+
+    printf("%s:\n", name);
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        if (!(node = alloc()))
+            return -ENOMEM;
+        node->data = next_rand(&seed);
+        rb_insert(&root, &node->rb, demo_cmp);
+        live[count] = node;
+    }
+    stop = time_now();
+    printf("\tinsert: %lf ns/op\n", (stop - start) * 1e9 / length);
+
+    start = time_now();
+    for (count = 0; count < CHURN_OPS; ++count) {
+        index = next_rand(&seed) % length;
+        rb_delete(&root, &live[index]->rb);
+        release(live[index]);
+
+        if (!(node = alloc()))
+            return -ENOMEM;
+        node->data = next_rand(&seed);
+        rb_insert(&root, &node->rb, demo_cmp);
+        live[index] = node;
+    }
+    stop = time_now();
+    printf("\tchurn: %lf ns/op\n", (stop - start) * 1e9 / CHURN_OPS);
+
+    start = time_now();
+    rb_for_each_entry(node, &root, rb)
+        sum += node->data;
+    stop = time_now();
+    printf("\ttraverse: %lf ns/op (%lx)\n", (stop - start) * 1e9 / length, sum & 0xff);
+
+    start = time_now();
+    teardown(&root);
+    stop = time_now();
+    printf("\tteardown: %lf ns/op\n", (stop - start) * 1e9 / length);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long length = TEST_LEN;
+    struct pool_node **live;
+    int retval;
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    live = malloc(sizeof(*live) * length);
+    if (!live || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    retval = run("Malloc", live, length, malloc_alloc, free, malloc_release);
+    if (retval)
+        goto failed;
+
+    if ((retval = rb_pool_init(&pool, sizeof(struct pool_node), 0)))
+        goto failed;
+    retval = run("Pool", live, length, pool_alloc, pool_free, pool_release);
+    rb_pool_destroy(&pool);
+    if (retval)
+        goto failed;
+
+    if ((retval = rb_pool_init(&pool, sizeof(struct pool_node), RB_POOL_HUGEPAGE)))
+        goto failed;
+    retval = run("Pool (hugepage)", live, length, pool_alloc, pool_free, pool_release);
+    rb_pool_destroy(&pool);
+    if (retval)
+        goto failed;
+
+    printf("Done.\n");
+    free(live);
+    return 0;
+
+failed:
+    printf("Abort.\n");
+    free(live);
+    return retval;
+}
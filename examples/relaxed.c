@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    1000000
+#define PENDING_LEN 65536
+
+struct relaxed_node {
+    struct rb_relaxed_node rb;
+    unsigned long data;
+};
+
+#define rb_to_relaxed(ptr) \
+    rb_entry(ptr, struct relaxed_node, rb.node)
+
+static long demo_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    struct relaxed_node *demo_a = rb_to_relaxed(a);
+    struct relaxed_node *demo_b = rb_to_relaxed(b);
+    return demo_a->data < demo_b->data ? -1 : 1;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int tree_depth(const struct rb_root *root)
+{
+    struct rb_report report;
+
+    if (rb_analyze(root, &report))
+        return 0;
+
+    return report.max_depth;
+}
+
+int main(int argc, char *argv[])
+{
+    struct relaxed_node *nodes;
+    struct rb_relaxed_node **pending;
+    struct rb_relaxed relaxed;
+    unsigned long count, length = TEST_LEN;
+    double start, stop;
+    RB_ROOT(strict);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    nodes = malloc(sizeof(*nodes) * length);
+    pending = malloc(sizeof(*pending) * PENDING_LEN);
+    if (!nodes || !pending) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        nodes[count].data = ((unsigned long)rand() << 32) | rand();
+
+    printf("Strict Burst %lu Node:\n", length);
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_insert(&strict, &nodes[count].rb.node, demo_cmp);
+    stop = time_now();
+    printf("\tinsert: %lf ns/op\n", (stop - start) * 1e9 / length);
+    printf("\tdeepth: %u\n", tree_depth(&strict));
+
+    start = time_now();
+    for (count = length; count--;)
+        rb_delete(&strict, &nodes[count].rb.node);
+    stop = time_now();
+    printf("\tdelete: %lf ns/op\n", (stop - start) * 1e9 / length);
+
+    printf("Relaxed Burst %lu Node:\n", length);
+    rb_relaxed_init(&relaxed, pending, PENDING_LEN);
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_relaxed_insert(&relaxed, &nodes[count].rb, demo_cmp);
+    stop = time_now();
+    printf("\tinsert: %lf ns/op\n", (stop - start) * 1e9 / length);
+    printf("\tpending: %lu\n", relaxed.count);
+    printf("\tdeepth: %u (bound %u)\n", tree_depth(&relaxed.root),
+           rb_relaxed_height_bound(&relaxed));
+
+    start = time_now();
+    for (count = length; count--;)
+        rb_relaxed_delete(&relaxed, &nodes[count].rb);
+    stop = time_now();
+    printf("\tdelete: %lf ns/op\n", (stop - start) * 1e9 / length);
+
+    printf("Relaxed Burst With Batched Rebalance:\n");
+    rb_relaxed_init(&relaxed, pending, PENDING_LEN);
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_relaxed_insert(&relaxed, &nodes[count].rb, demo_cmp);
+    rb_rebalance_pending(&relaxed, RB_REBALANCE_ALL);
+    stop = time_now();
+    printf("\tinsert: %lf ns/op\n", (stop - start) * 1e9 / length);
+    printf("\tdeepth: %u (bound %u)\n", tree_depth(&relaxed.root),
+           rb_relaxed_height_bound(&relaxed));
+
+    printf("Done.\n");
+    free(pending);
+    free(nodes);
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    10000000
+#define LOOKUP_OPS  2000000
+
+struct layout_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+#define rb_to_layout(node) \
+    rb_entry(node, struct layout_node, rb)
+
+static long layout_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_layout(a)->key < rb_to_layout(b)->key ? -1 : 1;
+}
+
+static long layout_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_layout(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void relocate_free(void *old, void *new, void *pdata)
+{
+    free(old);
+}
+
+static unsigned long lookup(struct rb_root *root, unsigned long *keys, unsigned long length)
+{
+    unsigned long count, seed = 0x9e3779b97f4a7c15UL, found = 0;
+    double start, stop;
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        found += !!rb_find(root, (void *)keys[next_rand(&seed) % length], layout_find);
+    stop = time_now();
+
+    printf("\tlookup: %lf ns/op\n", (stop - start) * 1e9 / LOOKUP_OPS);
+    return found;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count, length = TEST_LEN, seed = 1, found = 0;
+    struct layout_node *node, *veb, *blocked;
+    unsigned long *keys;
+    double start, stop;
+    void *junk;
+    RB_ROOT(root);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    keys = malloc(sizeof(*keys) * length);
+    veb = malloc(sizeof(*veb) * length);
+    blocked = malloc(sizeof(*blocked) * length);
+    if (!keys || !veb || !blocked || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    /* interleave short lived allocations to scatter the nodes */
+    for (count = 0; count < length; ++count) {
+        node = malloc(sizeof(*node));
+        junk = malloc(16 + next_rand(&seed) % 256);
+        if (!node || !junk) {
+            printf("Insufficient Memory!\n");
+            return -ENOMEM;
+        }
+
+        node->key = keys[count] = next_rand(&seed);
+        rb_insert(&root, &node->rb, layout_cmp);
+        free(junk);
+    }
+
+    printf("Fragmented Heap (%lu nodes):\n", length);
+    found += lookup(&root, keys, length);
+
+    start = time_now();
+    if (rb_relayout_entries(&root, veb, struct layout_node, rb,
+                            RB_LAYOUT_VEB, relocate_free, NULL)) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+    stop = time_now();
+
+    printf("van Emde Boas Layout:\n");
+    printf("\trelayout: %lf ns/node\n", (stop - start) * 1e9 / length);
+    found += lookup(&root, keys, length);
+
+    start = time_now();
+    if (rb_relayout_entries(&root, blocked, struct layout_node, rb,
+                            RB_LAYOUT_BLOCKED, NULL, NULL)) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+    stop = time_now();
+
+    printf("Breadth-first Blocked Layout:\n");
+    printf("\trelayout: %lf ns/node\n", (stop - start) * 1e9 / length);
+    found += lookup(&root, keys, length);
+
+    free(keys);
+    free(veb);
+    free(blocked);
+
+    if (found != LOOKUP_OPS * 3) {
+        printf("Mismatch!\n");
+        return -EFAULT;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
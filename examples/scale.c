@@ -0,0 +1,549 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+/*
+ * Multi-threaded scalability benchmark.
+ *
+ * For every selected synchronization scheme and thread count from 1
+ * up to the limit, a fixed number of mixed operations is split over
+ * the threads. The shared schemes run them on one tree prefilled with
+ * every even key, under a global mutex, a reader-writer lock or a
+ * spinlock. The private scheme gives each thread its own tree holding
+ * its share of the keys, with no locking, and merges the trees into
+ * one with a linear build at the end; the merge is timed separately.
+ *
+ * One operation in HOLD_SAMPLE has its lock acquisition and hold time
+ * recorded, to keep the clock reads out of most critical sections.
+ * Threads are pinned round-robin to the CPUs the process may run on.
+ */
+
+#define _GNU_SOURCE
+#undef DEBUG_RBTREE
+
+/* coarser latency buckets, one histogram per thread and scheme */
+#define HIST_SUB_BITS 3
+
+#include "rbtree.h"
+#include "hist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define KEY_RANGE   (1UL << 20)
+#define TEST_OPS    2000000
+#define READ_RATIO  90
+#define MAX_THREADS 256
+#define HOLD_SAMPLE 8
+
+
+enum scale_scheme {
+    SCALE_MUTEX,
+    SCALE_RWLOCK,
+    SCALE_SPINLOCK,
+    SCALE_PRIVATE,
+    SCALE_NR_SCHEMES,
+};
+
+struct scale_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+struct scale_worker {
+    pthread_t thread;
+    struct rb_root root;
+    struct scale_node *pool;
+    unsigned long ops, seed, used;
+    unsigned long found;
+    unsigned int index;
+    struct hist hold, wait;
+};
+
+#define rb_to_scale(node) \
+    rb_entry(node, struct scale_node, rb)
+
+static const char *const scheme_names[] = {
+    [SCALE_MUTEX] = "mutex",
+    [SCALE_RWLOCK] = "rwlock",
+    [SCALE_SPINLOCK] = "spinlock",
+    [SCALE_PRIVATE] = "private",
+};
+
+static struct scale_worker workers[MAX_THREADS];
+static RB_ROOT(shared_root);
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t shared_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_spinlock_t shared_spinlock;
+static pthread_barrier_t start_barrier;
+
+/* opened once every worker exists, or set to abort when one cannot be created */
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static int start_gate;
+
+static enum scale_scheme scheme;
+static unsigned int read_ratio = READ_RATIO;
+static unsigned int cpu_ids[MAX_THREADS];
+static unsigned int threads, cpus;
+static unsigned long total_ops = TEST_OPS;
+static bool pinned = true;
+
+static long scale_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    unsigned long ka = rb_to_scale(a)->key, kb = rb_to_scale(b)->key;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static long scale_key(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_scale(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static unsigned long time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static void lock_shared(bool write)
+{
+    switch (scheme) {
+        case SCALE_MUTEX:
+            pthread_mutex_lock(&shared_mutex);
+            break;
+
+        case SCALE_RWLOCK:
+            if (write)
+                pthread_rwlock_wrlock(&shared_rwlock);
+            else
+                pthread_rwlock_rdlock(&shared_rwlock);
+            break;
+
+        case SCALE_SPINLOCK:
+            pthread_spin_lock(&shared_spinlock);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void unlock_shared(void)
+{
+    switch (scheme) {
+        case SCALE_MUTEX:
+            pthread_mutex_unlock(&shared_mutex);
+            break;
+
+        case SCALE_RWLOCK:
+            pthread_rwlock_unlock(&shared_rwlock);
+            break;
+
+        case SCALE_SPINLOCK:
+            pthread_spin_unlock(&shared_spinlock);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * worker_op - run one operation on the tree of a worker.
+ * @worker: worker running the operation.
+ * @root: tree to operate on.
+ * @rand: random draw choosing the operation and its key.
+ *
+ * The private scheme keeps each key in the tree of the thread
+ * key / 2 % threads maps to, so a worker only draws keys of its
+ * own share.
+ */
+static void worker_op(struct scale_worker *worker, struct rb_root *root, unsigned long rand)
+{
+    unsigned long key = (rand >> 8) % KEY_RANGE, start = 0, locked = 0;
+    bool write = rand % 100 >= read_ratio, sample;
+    struct scale_node *node;
+    struct rb_node *rb;
+
+    if (scheme == SCALE_PRIVATE)
+        key = (key / 2 - key / 2 % threads + worker->index) * 2 + key % 2;
+
+    sample = scheme != SCALE_PRIVATE && (rand >> 48) % HOLD_SAMPLE == 0;
+    if (sample)
+        start = time_ns();
+    lock_shared(write);
+    if (sample)
+        locked = time_ns();
+
+    if (!write)
+        worker->found += !!rb_find(root, (void *)key, scale_key);
+    else if (rand & (1UL << 40)) {
+        /* deleted nodes are never reused, no reclamation needed */
+        node = &worker->pool[worker->used];
+        node->key = key;
+        worker->used += !rb_insert_conflict(root, &node->rb, scale_cmp);
+    } else if ((rb = rb_find(root, (void *)key, scale_key)))
+        rb_delete(root, rb);
+
+    if (sample) {
+        hist_record(&worker->hold, time_ns() - locked);
+        hist_record(&worker->wait, locked - start);
+    }
+    unlock_shared();
+}
+
+static void *worker_main(void *pdata)
+{
+    struct scale_worker *worker = pdata;
+    struct rb_root *root = scheme == SCALE_PRIVATE ? &worker->root : &shared_root;
+    unsigned long count;
+    cpu_set_t set;
+
+    if (pinned) {
+        CPU_ZERO(&set);
+        CPU_SET(cpu_ids[worker->index % cpus], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    pthread_mutex_lock(&start_lock);
+    while (!start_gate)
+        pthread_cond_wait(&start_cond, &start_lock);
+    pthread_mutex_unlock(&start_lock);
+
+    if (start_gate < 0)
+        return NULL;
+
+    pthread_barrier_wait(&start_barrier);
+    for (count = 0; count < worker->ops; ++count)
+        worker_op(worker, root, next_rand(&worker->seed));
+    pthread_barrier_wait(&start_barrier);
+
+    return NULL;
+}
+
+static int node_sort(const void *a, const void *b)
+{
+    unsigned long ka = rb_to_scale(*(struct rb_node *const *)a)->key;
+    unsigned long kb = rb_to_scale(*(struct rb_node *const *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+/**
+ * merge_private - combine the private trees into the shared one.
+ * @nodes: scratch array with room for every node.
+ *
+ * The shares are disjoint, so sorting the union and building a
+ * balanced tree from it is all a merge takes.
+ */
+static void merge_private(struct rb_node **nodes)
+{
+    unsigned long count = 0;
+    struct rb_node *walk;
+    unsigned int index;
+
+    for (index = 0; index < threads; ++index) {
+        rb_for_each(walk, &workers[index].root)
+            nodes[count++] = walk;
+        workers[index].root = RB_INIT;
+    }
+
+    qsort(nodes, count, sizeof(*nodes), node_sort);
+    rb_build(&shared_root, nodes, count);
+}
+
+/**
+ * prepare - prefill the trees and hand out the operations.
+ * @prefill: nodes holding every even key.
+ */
+static int prepare(struct scale_node *prefill)
+{
+    unsigned long count, key;
+    unsigned int index;
+
+    shared_root = RB_INIT;
+    for (index = 0; index < threads; ++index) {
+        workers[index].root = RB_INIT;
+        workers[index].index = index;
+        workers[index].ops = total_ops / threads;
+        workers[index].seed = index * 0x9e3779b97f4a7c15UL + 1;
+        workers[index].found = workers[index].used = 0;
+        memset(&workers[index].hold, 0, sizeof(workers[index].hold));
+        memset(&workers[index].wait, 0, sizeof(workers[index].wait));
+        workers[index].pool = malloc(sizeof(*workers->pool) * workers[index].ops);
+        if (!workers[index].pool)
+            return -ENOMEM;
+    }
+
+    for (count = 0; count < KEY_RANGE / 2; ++count) {
+        prefill[count].key = key = count * 2;
+        if (scheme == SCALE_PRIVATE)
+            rb_insert(&workers[key / 2 % threads].root, &prefill[count].rb, scale_cmp);
+        else
+            rb_insert(&shared_root, &prefill[count].rb, scale_cmp);
+    }
+
+    return 0;
+}
+
+static void cleanup(void)
+{
+    unsigned int index;
+
+    for (index = 0; index < threads; ++index)
+        free(workers[index].pool);
+}
+
+/**
+ * run - time one scheme at the current thread count.
+ * @hold: lock hold times of every thread, merged.
+ * @wait: lock acquisition times of every thread, merged.
+ * @merge: set to the seconds the private merge took.
+ * @nodes: scratch array for the merge.
+ * @mops: set to million operations per second.
+ *
+ * Returns the pthread_create() error when a worker cannot be started;
+ * the workers already created are then released and joined.
+ */
+static int run(struct hist *hold, struct hist *wait, double *merge, struct rb_node **nodes,
+               double *mops)
+{
+    unsigned long start, stop;
+    unsigned int index, count;
+    int retval = 0;
+
+    start_gate = 0;
+    for (index = 0; index < threads; ++index) {
+        if ((retval = pthread_create(&workers[index].thread, NULL, worker_main, &workers[index])))
+            break;
+    }
+
+    pthread_barrier_init(&start_barrier, NULL, threads + 1);
+    pthread_mutex_lock(&start_lock);
+    start_gate = retval ? -1 : 1;
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&start_lock);
+
+    if (retval) {
+        for (count = 0; count < index; ++count)
+            pthread_join(workers[count].thread, NULL);
+        pthread_barrier_destroy(&start_barrier);
+        return retval;
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    start = time_ns();
+    pthread_barrier_wait(&start_barrier);
+    stop = time_ns();
+
+    for (index = 0; index < threads; ++index) {
+        pthread_join(workers[index].thread, NULL);
+        hist_merge(hold, &workers[index].hold);
+        hist_merge(wait, &workers[index].wait);
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    *merge = 0;
+    if (scheme == SCALE_PRIVATE) {
+        *merge = time_ns();
+        merge_private(nodes);
+        *merge = (time_ns() - *merge) / 1e9;
+    }
+
+    *mops = (double)(total_ops / threads * threads) / (stop - start) * 1e3;
+    return 0;
+}
+
+/* share of the samples in each power-of-two range of ns, from 0.01% */
+static void output_octaves(const char *name, const struct hist *hist)
+{
+    unsigned long sum;
+    unsigned int octave, index;
+
+    printf("\t\t%s:", name);
+    for (octave = 0; octave < HIST_BUCKETS / HIST_SUB; ++octave) {
+        sum = 0;
+        for (index = octave * HIST_SUB; index < (octave + 1) * HIST_SUB; ++index)
+            sum += hist->count[index];
+        if (sum * 10000 >= hist->total)
+            printf(" <%lu %.2lf%%", hist_value((octave + 1) * HIST_SUB - 1) + 1,
+                   100.0 * sum / hist->total);
+    }
+    printf(" ns\n");
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options]\n", name);
+    printf("\t-t threads      highest thread count (default all cpus)\n");
+    printf("\t-n ops          operations per thread count (default %u)\n", TEST_OPS);
+    printf("\t-r percent      share of finds (default %u)\n", READ_RATIO);
+    printf("\t-s schemes      mutex,rwlock,spinlock,private (default all)\n");
+    printf("\t-u              leave threads unpinned\n");
+    printf("\t-f format       text or csv (default text)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int schemes[SCALE_NR_SCHEMES * 2], nr_schemes = 0, index, limit;
+    double mops = 0, base = 0, merge = 0;
+    struct scale_node *prefill;
+    struct hist hold, wait;
+    struct rb_node **nodes;
+    bool csv = false;
+    cpu_set_t set;
+    char *walk;
+    int opt, retval;
+
+    if (sched_getaffinity(0, sizeof(set), &set))
+        return -errno;
+    for (index = 0; index < CPU_SETSIZE && cpus < MAX_THREADS; ++index) {
+        if (CPU_ISSET(index, &set))
+            cpu_ids[cpus++] = index;
+    }
+    limit = cpus;
+
+    while ((opt = getopt(argc, argv, "t:n:r:s:uf:h")) != -1) {
+        switch (opt) {
+            case 't':
+                limit = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'n':
+                total_ops = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'r':
+                read_ratio = strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                for (walk = strtok(optarg, ","); walk; walk = strtok(NULL, ",")) {
+                    for (index = 0; index < SCALE_NR_SCHEMES; ++index) {
+                        if (!strcmp(walk, scheme_names[index]))
+                            break;
+                    }
+                    if (index == SCALE_NR_SCHEMES || nr_schemes == SCALE_NR_SCHEMES * 2) {
+                        fprintf(stderr, "unknown or too many schemes: %s\n", walk);
+                        return -EINVAL;
+                    }
+                    schemes[nr_schemes++] = index;
+                }
+                break;
+
+            case 'u':
+                pinned = false;
+                break;
+
+            case 'f':
+                if (strcmp(optarg, "csv") && strcmp(optarg, "text")) {
+                    usage(argv[0]);
+                    return -EINVAL;
+                }
+                csv = !strcmp(optarg, "csv");
+                break;
+
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+
+    if (!limit || limit > MAX_THREADS || read_ratio > 100 || total_ops < limit) {
+        usage(argv[0]);
+        return -EINVAL;
+    }
+
+    if (!nr_schemes) {
+        for (; nr_schemes < SCALE_NR_SCHEMES; ++nr_schemes)
+            schemes[nr_schemes] = nr_schemes;
+    }
+
+    prefill = malloc(sizeof(*prefill) * (KEY_RANGE / 2));
+    nodes = malloc(sizeof(*nodes) * (KEY_RANGE / 2 + total_ops));
+    if (!prefill || !nodes) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+    pthread_spin_init(&shared_spinlock, PTHREAD_PROCESS_PRIVATE);
+
+    if (csv)
+        printf("scheme,threads,mops,speedup,merge_ms,hold_p50,hold_p99,hold_max,wait_p50,wait_p99,wait_max\n");
+    else
+        printf("Scalability (%u%% find, %u cpus, %s):\n", read_ratio, cpus,
+               pinned ? "pinned" : "unpinned");
+
+    for (index = 0; index < nr_schemes; ++index) {
+        scheme = schemes[index];
+        if (!csv)
+            printf("%s:\n", scheme_names[scheme]);
+
+        for (threads = 1;; threads <<= 1) {
+            if (threads > limit)
+                threads = limit;
+
+            memset(&hold, 0, sizeof(hold));
+            memset(&wait, 0, sizeof(wait));
+            if (prepare(prefill)) {
+                printf("Insufficient Memory!\n");
+                return -ENOMEM;
+            }
+            retval = run(&hold, &wait, &merge, nodes, &mops);
+            cleanup();
+            if (retval) {
+                printf("Cannot create %u threads: %d\n", threads, retval);
+                return -retval;
+            }
+            if (threads == 1)
+                base = mops;
+
+            if (csv) {
+                printf("%s,%u,%.3lf,%.3lf,%.3lf,%lu,%lu,%lu,%lu,%lu,%lu\n", scheme_names[scheme],
+                       threads, mops, mops / base, merge * 1e3,
+                       hist_percentile(&hold, 50), hist_percentile(&hold, 99), hold.max,
+                       hist_percentile(&wait, 50), hist_percentile(&wait, 99), wait.max);
+            } else if (scheme == SCALE_PRIVATE) {
+                printf("\t%3u threads: %8.3lf Mops/s, %5.2lfx, merge %.3lf ms\n",
+                       threads, mops, mops / base, merge * 1e3);
+            } else {
+                printf("\t%3u threads: %8.3lf Mops/s, %5.2lfx, hold p50 %lu p99 %lu max %lu ns, "
+                       "wait p50 %lu p99 %lu max %lu ns\n", threads, mops, mops / base,
+                       hist_percentile(&hold, 50), hist_percentile(&hold, 99), hold.max,
+                       hist_percentile(&wait, 50), hist_percentile(&wait, 99), wait.max);
+                if (threads == limit) {
+                    output_octaves("hold", &hold);
+                    output_octaves("wait", &wait);
+                }
+            }
+
+            if (threads == limit)
+                break;
+        }
+    }
+
+    pthread_spin_destroy(&shared_spinlock);
+    free(prefill);
+    free(nodes);
+
+    if (!csv)
+        printf("Done.\n");
+    return 0;
+}
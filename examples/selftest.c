@@ -4,9 +4,20 @@
  */
 
 #include "rbtree.h"
+#include "btree.h"
+#include "frozen.h"
+#include "persist.h"
+#include "pool.h"
+#include "rbindex.h"
+#include "skiplist.h"
+#include "slim.h"
+#include "small.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 #define TEST_LOOP 100
 
@@ -420,6 +431,1284 @@ static int rbtree_test_testing(struct rbtree_test_pdata *sdata)
     return 0;
 }
 
+static int rbtree_test_child_check_cmp(const struct rb_root *root, rb_cmp_t cmp)
+{
+    struct rb_node *rbnode, *child;
+    unsigned int dir;
+
+    rb_for_each(rbnode, root) {
+        if (rbnode->child[RB_LEFT] != rbnode->left ||
+            rbnode->child[RB_RIGHT] != rbnode->right)
+            return -EFAULT;
+
+        for (dir = RB_LEFT; dir <= RB_RIGHT; ++dir) {
+            if (!(child = rbnode->child[dir]))
+                continue;
+            if (child->parent != rbnode)
+                return -EFAULT;
+            if (rbnode->color == RB_RED && child->color == RB_RED)
+                return -EFAULT;
+            if ((cmp(child, rbnode) > 0) != dir)
+                return -EFAULT;
+        }
+    }
+
+    return 0;
+}
+
+static int rbtree_test_child_check(const struct rb_root *root)
+{
+    return rbtree_test_child_check_cmp(root, rbtest_rb_cmp);
+}
+
+/* every path from the root down to a missing child has the same black count */
+static int rbtree_test_black_check(const struct rb_root *root)
+{
+    struct rb_node *rbnode, *walk;
+    unsigned int blacks, height = 0;
+
+    if (root->node && root->node->color != RB_BLACK)
+        return -EFAULT;
+
+    rb_for_each(rbnode, root) {
+        if (rbnode->left && rbnode->right)
+            continue;
+
+        blacks = 0;
+        for (walk = rbnode; walk; walk = walk->parent)
+            blacks += walk->color == RB_BLACK;
+
+        if (!height)
+            height = blacks;
+        else if (blacks != height)
+            return -EFAULT;
+    }
+
+    return 0;
+}
+
+static int rbtree_test_sort(const void *a, const void *b)
+{
+    const struct rb_node *rba = *(const struct rb_node **)a;
+    const struct rb_node *rbb = *(const struct rb_node **)b;
+    return rbtest_rb_cmp(rba, rbb);
+}
+
+static int rbtree_test_build(struct rbtree_test_pdata *sdata)
+{
+    struct rb_node *nodes[TEST_LOOP], *rbnode;
+    struct rbtree_test_node *node;
+    unsigned long count;
+    int retval;
+
+    RB_ROOT_CACHED(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        nodes[count] = &sdata->nodes[count].node;
+
+    qsort(nodes, TEST_LOOP, sizeof(*nodes), rbtree_test_sort);
+    rb_cached_build(&test_root, nodes, TEST_LOOP);
+
+    count = 0;
+    rb_cached_for_each(rbnode, &test_root) {
+        if (rbnode != nodes[count++])
+            return -EFAULT;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    if ((retval = rbtree_test_child_check(&test_root.root)) ||
+        (retval = rbtree_test_black_check(&test_root.root)))
+        return retval;
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        node = rbnode_to_test(nodes[count]);
+        rb_cached_delete(&test_root, nodes[count]);
+        printf("rbtree 'rb_cached_build' test: %lu\n", node->data);
+    }
+
+    if (!RB_EMPTY_ROOT_CACHED(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+static int rbtree_test_hint(struct rbtree_test_pdata *sdata)
+{
+    struct rb_node *nodes[TEST_LOOP], *rbnode, *hint = NULL;
+    unsigned long count;
+
+    RB_ROOT_CACHED(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        nodes[count] = &sdata->nodes[count].node;
+
+    qsort(nodes, TEST_LOOP, sizeof(*nodes), rbtree_test_sort);
+    for (count = 0; count < TEST_LOOP; count += 2) {
+        rb_cached_insert_hint(&test_root, nodes[count], hint, rbtest_rb_cmp);
+        hint = nodes[count];
+    }
+
+    /* interleave the odd half without a hint */
+    for (count = 1; count < TEST_LOOP; count += 2)
+        rb_cached_insert(&test_root, nodes[count], rbtest_rb_cmp);
+
+    count = 0;
+    rb_cached_for_each(rbnode, &test_root) {
+        printf("rbtree 'rb_cached_insert_hint' test: %lu\n", rbnode_to_test(rbnode)->data);
+        if (rbnode != nodes[count++])
+            return -EFAULT;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    return 0;
+}
+
+static int rbtree_test_u64(struct rbtree_test_pdata *sdata)
+{
+    struct rb_node_u64 unodes[TEST_LOOP], *node;
+    struct rb_node *rbnode;
+    unsigned long count;
+
+    RB_ROOT(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        unodes[count].key = sdata->nodes[count].data;
+        rb_u64_insert(&test_root, &unodes[count]);
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        node = rb_u64_find(&test_root, unodes[count].key);
+        if (!node || node->key != unodes[count].key)
+            return -EFAULT;
+
+        node = rb_u64_lower_bound(&test_root, unodes[count].key);
+        if (!node || node->key != unodes[count].key)
+            return -EFAULT;
+
+        node = rb_u64_upper_bound(&test_root, unodes[count].key);
+        if (node && node->key <= unodes[count].key)
+            return -EFAULT;
+    }
+
+    count = 0;
+    rb_for_each(rbnode, &test_root) {
+        printf("rbtree 'rb_u64_insert' test: %lu\n", (unsigned long)rb_u64_node(rbnode)->key);
+        if (count && rb_u64_node(rb_prev(rbnode))->key > rb_u64_node(rbnode)->key)
+            return -EFAULT;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_u64_delete(&test_root, &unodes[count]);
+
+    if (!RB_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+static int rbtree_test_child(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_node *node;
+    struct rb_node *rbnode;
+    unsigned long count;
+    int retval;
+
+    RB_ROOT(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_insert(&test_root, &sdata->nodes[count].node, rbtest_rb_cmp);
+
+    if ((retval = rbtree_test_child_check(&test_root)))
+        return retval;
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        rbnode = rb_find(&test_root, (void *)sdata->nodes[count].data, rbtest_rb_find);
+        if (!(node = rbnode_to_test_safe(rbnode)) || node->data != sdata->nodes[count].data)
+            return -EFAULT;
+        printf("rbtree 'child' test: %lu\n", node->data);
+    }
+
+    for (count = 0; count < TEST_LOOP; count += 2)
+        rb_delete(&test_root, &sdata->nodes[count].node);
+
+    if ((retval = rbtree_test_child_check(&test_root)))
+        return retval;
+
+    for (count = 1; count < TEST_LOOP; count += 2)
+        rb_delete(&test_root, &sdata->nodes[count].node);
+
+    if (!RB_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+static int rbtree_test_stats(struct rbtree_test_pdata *sdata)
+{
+    struct rb_stats stats;
+    struct rb_node *rbnode;
+    unsigned long count;
+    bool enabled;
+
+    RB_ROOT(test_root);
+
+    rb_stats_reset();
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_insert(&test_root, &sdata->nodes[count].node, rbtest_rb_cmp);
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_find(&test_root, (void *)sdata->nodes[count].data, rbtest_rb_find);
+    rb_for_each(rbnode, &test_root)
+        ;
+
+    enabled = rb_stats_read(&stats);
+    printf("rbtree 'stats' test: %s, %lu rotations %lu levels\n",
+           enabled ? "enabled" : "disabled", stats.rotations, stats.levels);
+
+    if (enabled) {
+        if (stats.descents != TEST_LOOP * 2 || !stats.rotations || !stats.climbs ||
+            stats.levels < stats.descents - 1 || stats.compares != stats.levels)
+            return -EFAULT;
+    } else if (stats.rotations || stats.recolors || stats.descents ||
+               stats.levels || stats.compares || stats.climbs)
+        return -EFAULT;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_delete(&test_root, &sdata->nodes[count].node);
+
+    rb_stats_reset();
+    rb_stats_read(&stats);
+    if (stats.rotations || stats.descents)
+        return -EFAULT;
+
+    return 0;
+}
+
+static void rbtree_test_analyze_walk(struct rb_node *node, unsigned int depth,
+                                     struct rb_report *report)
+{
+    if (!node)
+        return;
+
+    report->nodes++;
+    report->depths[depth - 1]++;
+    report->red_ratio += node->color == RB_RED;
+    report->avg_compares += depth;
+    if (!node->left && !node->right && depth > report->max_depth)
+        report->max_depth = depth;
+
+    rbtree_test_analyze_walk(node->left, depth + 1, report);
+    rbtree_test_analyze_walk(node->right, depth + 1, report);
+}
+
+static int rbtree_test_analyze(struct rbtree_test_pdata *sdata)
+{
+    struct rb_report report, expect = {};
+    unsigned long count;
+    unsigned int index;
+    int retval;
+
+    RB_ROOT(test_root);
+
+    if ((retval = rb_analyze(&test_root, &report)))
+        return retval;
+    if (report.nodes || report.max_depth || report.lines)
+        return -EFAULT;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_insert(&test_root, &sdata->nodes[count].node, rbtest_rb_cmp);
+
+    if ((retval = rb_analyze(&test_root, &report)))
+        return retval;
+
+    rbtree_test_analyze_walk(test_root.node, 1, &expect);
+    printf("rbtree 'analyze' test: depth %u-%u, black height %u, %lu lines\n",
+           report.min_depth, report.max_depth, report.black_height, report.lines);
+
+    if (report.nodes != TEST_LOOP || report.max_depth != expect.max_depth ||
+        report.min_depth > report.max_depth || report.avg_depth < report.min_depth ||
+        report.avg_depth > report.max_depth || !report.leaves ||
+        report.red_ratio * TEST_LOOP + 0.5 < expect.red_ratio ||
+        report.red_ratio * TEST_LOOP - 0.5 > expect.red_ratio ||
+        report.avg_compares * TEST_LOOP + 0.5 < expect.avg_compares ||
+        report.avg_compares * TEST_LOOP - 0.5 > expect.avg_compares ||
+        report.black_height < (report.max_depth + 1) / 2 ||
+        report.black_height > report.min_depth ||
+        !report.pages || report.pages > report.lines || report.lines > TEST_LOOP)
+        return -EFAULT;
+
+    for (index = 0; index < RB_REPORT_DEPTH; ++index) {
+        if (report.depths[index] != expect.depths[index])
+            return -EFAULT;
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_delete(&test_root, &sdata->nodes[count].node);
+
+    return 0;
+}
+
+static int rbtree_test_trace(struct rbtree_test_pdata *sdata)
+{
+    char path[] = "/tmp/rbtree-trace-XXXXXX";
+    struct rb_trace_record *records;
+    static struct rb_trace trace;
+    unsigned long count, length;
+    struct rb_node *rbnode;
+    int fd, retval, error;
+
+    RB_ROOT(test_root);
+
+    if ((fd = mkstemp(path)) < 0)
+        return -errno;
+    close(fd);
+
+    if ((retval = rb_trace_open(&trace, path)))
+        goto unlink;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_trace_insert(&trace, &test_root, &sdata->nodes[count].node,
+                        rbtest_rb_cmp, sdata->nodes[count].data);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        rbnode = rb_trace_find(&trace, &test_root, (void *)sdata->nodes[count].data,
+                               rbtest_rb_find, sdata->nodes[count].data);
+        if (rbnode != &sdata->nodes[count].node) {
+            retval = -EFAULT;
+            goto close;
+        }
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_trace_delete(&trace, &test_root, &sdata->nodes[count].node,
+                        sdata->nodes[count].data);
+
+close:
+    /* the trace is closed and its file removed on every path */
+    if ((error = rb_trace_close(&trace)) && !retval)
+        retval = error;
+    if (!retval)
+        retval = rb_trace_load(path, &records, &length);
+unlink:
+    unlink(path);
+    if (retval)
+        return retval;
+
+    printf("rbtree 'trace' test: %lu records\n", length);
+    if (length != TEST_LOOP * 3 || !RB_EMPTY_ROOT(&test_root))
+        retval = -EFAULT;
+
+    for (count = 0; !retval && count < length; ++count) {
+        if (records[count].op != count / TEST_LOOP ||
+            records[count].key != sdata->nodes[count % TEST_LOOP].data)
+            retval = -EFAULT;
+    }
+
+    free(records);
+    return retval;
+}
+
+static int rbtree_test_str(struct rbtree_test_pdata *sdata)
+{
+    struct rb_node_str snodes[TEST_LOOP], *node, *prev = NULL;
+    char keys[TEST_LOOP][32];
+    struct rb_node *rbnode;
+    unsigned long count;
+
+    RB_ROOT(test_root);
+
+    /* odd keys share a prefix longer than the cached one */
+    for (count = 0; count < TEST_LOOP; ++count) {
+        snprintf(keys[count], sizeof(*keys), count & 1 ? "/usr/share/%lu" : "%lu",
+                 sdata->nodes[count].data);
+        rb_str_init(&snodes[count], keys[count], strlen(keys[count]));
+        rb_str_insert(&test_root, &snodes[count]);
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        node = rb_str_find(&test_root, keys[count], strlen(keys[count]));
+        if (!node || strcmp(node->key, keys[count]))
+            return -EFAULT;
+
+        node = rb_str_lower_bound(&test_root, keys[count], strlen(keys[count]) - 1);
+        if (!node || strcmp(node->key, keys[count]) > 0)
+            return -EFAULT;
+    }
+
+    count = 0;
+    rb_for_each(rbnode, &test_root) {
+        node = rb_str_node(rbnode);
+        printf("rbtree 'rb_str_insert' test: %s\n", node->key);
+        if (prev && strcmp(prev->key, node->key) > 0)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_str_delete(&test_root, &snodes[count]);
+
+    if (!RB_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+static int rbtree_test_small(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_node *node, *prev;
+    struct rb_node *rbnode;
+    unsigned long count, loop;
+
+    RB_SMALL(test_small);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        rb_small_insert(&test_small, &sdata->nodes[count].node, rbtest_rb_cmp);
+        if (test_small.tree != (count >= RB_SMALL_MAX))
+            return -EFAULT;
+    }
+
+    /* shrink through the demotion point and check both modes */
+    for (loop = TEST_LOOP; loop; loop = loop > RB_SMALL_MAX ? RB_SMALL_MAX / 2 : 0) {
+        for (count = loop; count < TEST_LOOP; ++count)
+            rb_small_delete(&test_small, &sdata->nodes[count].node);
+
+        for (count = 0; count < loop; ++count) {
+            if (!rb_small_find(&test_small, (void *)sdata->nodes[count].data, rbtest_rb_find))
+                return -EFAULT;
+        }
+
+        count = 0;
+        prev = NULL;
+        rb_small_for_each_entry(node, &test_small, node) {
+            printf("rbtree 'rb_small_for_each_entry' test: %lu\n", node->data);
+            if (prev && prev->data > node->data)
+                return -EFAULT;
+            prev = node;
+            count++;
+        }
+
+        if (count != loop)
+            return -ENODATA;
+
+        count = 0;
+        rb_small_for_each_reverse(rbnode, &test_small)
+            count++;
+
+        if (count != loop)
+            return -ENODATA;
+    }
+
+    if (test_small.tree)
+        return -EFAULT;
+
+    for (count = 0; count < RB_SMALL_MAX / 2; ++count)
+        rb_small_delete(&test_small, &sdata->nodes[count].node);
+
+    if (!RB_EMPTY_SMALL(&test_small))
+        return -EFAULT;
+
+    return 0;
+}
+
+struct rbtree_test_rnode {
+    struct rb_relaxed_node node;
+    unsigned long data;
+};
+
+#define rbnode_to_rtest(ptr) \
+    rb_entry(ptr, struct rbtree_test_rnode, node.node)
+
+static long rbtest_rl_cmp(const struct rb_node *rba, const struct rb_node *rbb)
+{
+    struct rbtree_test_rnode *nodea = rbnode_to_rtest(rba);
+    struct rbtree_test_rnode *nodeb = rbnode_to_rtest(rbb);
+    return nodea->data < nodeb->data ? -1 : 1;
+}
+
+static long rbtest_rl_find(const struct rb_node *rb, const void *key)
+{
+    struct rbtree_test_rnode *node = rbnode_to_rtest(rb);
+    if (node->data == (unsigned long)key) return 0;
+    return (unsigned long)key < node->data ? -1 : 1;
+}
+
+/* delete while insertions are pending, also pending nodes that grew children */
+static int rbtree_test_relaxed_churn(struct rbtree_test_rnode *rnodes, unsigned long stride)
+{
+    struct rb_relaxed_node *pending[TEST_LOOP / 8];
+    struct rb_relaxed relaxed;
+    struct rb_node *rbnode;
+    bool linked[TEST_LOOP] = {};
+    unsigned long count, victim, live = 0;
+    int retval;
+
+    rb_relaxed_init(&relaxed, pending, TEST_LOOP / 8);
+    for (count = 0; count < TEST_LOOP; ++count) {
+        rb_relaxed_insert(&relaxed, &rnodes[count].node, rbtest_rl_cmp);
+        linked[count] = true;
+        live++;
+
+        if (count % 3 != 2)
+            continue;
+
+        victim = count - 1 - (count * stride) % (count / 2 + 1);
+        if (!linked[victim])
+            continue;
+
+        rb_relaxed_delete(&relaxed, &rnodes[victim].node);
+        linked[victim] = false;
+        live--;
+    }
+
+    if (rb_rebalance_pending(&relaxed, RB_REBALANCE_ALL))
+        return -EFAULT;
+
+    if ((retval = rbtree_test_child_check_cmp(&relaxed.root, rbtest_rl_cmp)) ||
+        (retval = rbtree_test_black_check(&relaxed.root)))
+        return retval;
+
+    count = 0;
+    rb_for_each(rbnode, &relaxed.root)
+        count++;
+
+    if (count != live || relaxed.nodes != live)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (linked[count])
+            rb_relaxed_delete(&relaxed, &rnodes[count].node);
+    }
+
+    if (!RB_EMPTY_ROOT(&relaxed.root))
+        return -EFAULT;
+
+    printf("rbtree 'rb_relaxed_delete' test: stride %lu, %lu left\n", stride, live);
+    return 0;
+}
+
+static int rbtree_test_relaxed(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_rnode rnodes[TEST_LOOP], *node, *prev = NULL;
+    struct rb_relaxed_node *pending[TEST_LOOP / 4];
+    struct rb_relaxed relaxed;
+    struct rb_node *rbnode;
+    unsigned long count;
+    int retval;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rnodes[count].data = sdata->nodes[count].data;
+
+    rb_relaxed_init(&relaxed, pending, TEST_LOOP / 4);
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_relaxed_insert(&relaxed, &rnodes[count].node, rbtest_rl_cmp);
+
+    printf("rbtree 'rb_relaxed_height_bound' test: %u\n",
+           rb_relaxed_height_bound(&relaxed));
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        rbnode = rb_find(&relaxed.root, (void *)rnodes[count].data, rbtest_rl_find);
+        if (!rbnode)
+            return -EFAULT;
+    }
+
+    if (rb_rebalance_pending(&relaxed, 1) > TEST_LOOP / 4)
+        return -EFAULT;
+
+    if (rb_rebalance_pending(&relaxed, RB_REBALANCE_ALL))
+        return -EFAULT;
+
+    count = 0;
+    rb_for_each_entry(node, &relaxed.root, node.node) {
+        printf("rbtree 'rb_relaxed_insert' test: %lu\n", node->data);
+        if (prev && prev->data > node->data)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        rb_relaxed_delete(&relaxed, &rnodes[count].node);
+
+    if (!RB_EMPTY_ROOT(&relaxed.root))
+        return -EFAULT;
+
+    for (count = 1; count <= 4; ++count) {
+        if ((retval = rbtree_test_relaxed_churn(rnodes, count)))
+            return retval;
+    }
+
+    return 0;
+}
+
+struct rbtree_test_pnode {
+    struct rbp_node node;
+    unsigned long data;
+};
+
+#define rbpnode_to_test(ptr) \
+    rbp_entry(ptr, struct rbtree_test_pnode, node)
+
+static unsigned long rbtest_rb_key(const struct rb_node *rb)
+{
+    return rbnode_to_test(rb)->data;
+}
+
+static int rbtree_test_frozen(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_node nodes[TEST_LOOP], *node, *next;
+    struct rb_frozen frozen;
+    unsigned long count;
+    int retval;
+
+    RB_ROOT(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        nodes[count].data = sdata->nodes[count].data;
+        rb_insert(&test_root, &nodes[count].node, rbtest_rb_cmp);
+    }
+
+    retval = rb_freeze(&frozen, &test_root, rbtest_rb_key);
+    if (retval)
+        return retval;
+
+    rb_for_each_entry(node, &test_root, node) {
+        printf("rbtree 'rb_frozen_find' test: %lu\n", node->data);
+        next = rb_next_entry(node, node);
+        if (rbnode_to_test_safe(rb_frozen_find(&frozen, node->data))->data != node->data ||
+            rbnode_to_test_safe(rb_frozen_lower_bound(&frozen, node->data))->data != node->data ||
+            (next && next->data != node->data &&
+             rb_frozen_upper_bound(&frozen, node->data) != &next->node)) {
+            rb_frozen_destroy(&frozen);
+            return -EFAULT;
+        }
+    }
+
+    if (rb_frozen_lower_bound(&frozen, 0) != rb_first(&test_root) ||
+        rb_frozen_upper_bound(&frozen, ULONG_MAX)) {
+        rb_frozen_destroy(&frozen);
+        return -EFAULT;
+    }
+
+    rb_frozen_destroy(&frozen);
+    return 0;
+}
+
+static void rbtest_relocate(void *old, void *new, void *pdata)
+{
+    (*(unsigned long *)pdata)++;
+}
+
+static int rbtree_test_relayout(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_node *nodes, *node, *prev;
+    unsigned long count, moved;
+    unsigned int layout;
+    struct rb_node *rb;
+
+    RB_ROOT(test_root);
+
+    nodes = malloc(sizeof(*nodes) * TEST_LOOP * 3);
+    if (!nodes)
+        return -ENOMEM;
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        nodes[count].data = sdata->nodes[count].data;
+        rb_insert(&test_root, &nodes[count].node, rbtest_rb_cmp);
+    }
+
+    for (layout = RB_LAYOUT_VEB; layout <= RB_LAYOUT_BLOCKED; ++layout) {
+        moved = 0;
+        if (rb_relayout_entries(&test_root, nodes + TEST_LOOP * (layout + 1),
+                                struct rbtree_test_node, node, layout,
+                                rbtest_relocate, &moved)) {
+            free(nodes);
+            return -ENOMEM;
+        }
+
+        if (moved != TEST_LOOP) {
+            free(nodes);
+            return -ENODATA;
+        }
+
+        prev = NULL;
+        rb_for_each_entry(node, &test_root, node) {
+            printf("rbtree 'rb_relayout' test: %lu\n", node->data);
+            rb = &node->node;
+            if ((prev && prev->data > node->data) ||
+                node < nodes + TEST_LOOP * (layout + 1) ||
+                node >= nodes + TEST_LOOP * (layout + 2) ||
+                (rb->left && rb->left->parent != rb) ||
+                (rb->right && rb->right->parent != rb)) {
+                free(nodes);
+                return -EFAULT;
+            }
+            prev = node;
+        }
+
+        for (count = 0; count < TEST_LOOP; ++count) {
+            if (!rb_find(&test_root, (void *)sdata->nodes[count].data, rbtest_rb_find)) {
+                free(nodes);
+                return -EFAULT;
+            }
+        }
+    }
+
+    free(nodes);
+    return 0;
+}
+
+static unsigned long rbtree_test_plive;
+
+static struct rbp_node *rbtest_rbp_clone(const struct rbp_node *rbp, void *pdata)
+{
+    struct rbtree_test_pnode *node;
+
+    node = malloc(sizeof(*node));
+    if (!node)
+        abort();
+
+    node->data = rbpnode_to_test(rbp)->data;
+    rbtree_test_plive++;
+    return &node->node;
+}
+
+static void rbtest_rbp_release(struct rbp_node *rbp, void *pdata)
+{
+    rbtree_test_plive--;
+    free(rbpnode_to_test(rbp));
+}
+
+static const struct rbp_ops rbtest_rbp_ops = {
+    .clone = rbtest_rbp_clone,
+    .release = rbtest_rbp_release,
+};
+
+static long rbtest_rbp_cmp(const struct rbp_node *rba, const struct rbp_node *rbb)
+{
+    struct rbtree_test_pnode *nodea = rbpnode_to_test(rba);
+    struct rbtree_test_pnode *nodeb = rbpnode_to_test(rbb);
+    return nodea->data < nodeb->data ? -1 : 1;
+}
+
+static long rbtest_rbp_find(const struct rbp_node *rbp, const void *key)
+{
+    struct rbtree_test_pnode *node = rbpnode_to_test(rbp);
+    if (node->data == (unsigned long)key) return 0;
+    return (unsigned long)key < node->data ? -1 : 1;
+}
+
+static int rbtree_test_persist(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_pnode *node;
+    struct rbp_iter iter;
+    unsigned long count;
+
+    RBP_ROOT(test_root);
+    RBP_ROOT(test_snapshot);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        node = malloc(sizeof(*node));
+        if (!node)
+            return -ENOMEM;
+        node->data = sdata->nodes[count].data;
+        rbtree_test_plive++;
+        rbp_insert(&test_root, &node->node, rbtest_rbp_cmp, &rbtest_rbp_ops, NULL);
+    }
+
+    rbp_snapshot(&test_root, &test_snapshot);
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!rbp_delete(&test_root, (void *)sdata->nodes[count].data,
+                        rbtest_rbp_find, &rbtest_rbp_ops, NULL))
+            return -EFAULT;
+    }
+
+    if (!RBP_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    count = 0;
+    rbp_for_each_entry(node, &iter, &test_snapshot, node) {
+        printf("rbtree 'rbp_for_each_entry' test: %lu\n", node->data);
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    rbp_release(&test_snapshot, &rbtest_rbp_ops, NULL);
+    if (rbtree_test_plive)
+        return -EFAULT;
+
+    return 0;
+}
+
+static int rbtree_test_pool(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_node *nodes[TEST_LOOP], *node;
+    struct rb_pool pool;
+    unsigned long count;
+    char *carve;
+    int retval;
+
+    RB_ROOT(test_root);
+
+    retval = rb_pool_init(&pool, sizeof(*node), 0);
+    if (retval)
+        return retval;
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        node = rb_pool_alloc(&pool);
+        if (!node) {
+            rb_pool_destroy(&pool);
+            return -ENOMEM;
+        }
+        node->data = sdata->nodes[count].data;
+        rb_insert(&test_root, &node->node, rbtest_rb_cmp);
+        nodes[count] = node;
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!rb_find(&test_root, (void *)nodes[count]->data, rbtest_rb_find)) {
+            rb_pool_destroy(&pool);
+            return -EFAULT;
+        }
+    }
+
+    rb_pool_free_entries(&pool, &test_root, struct rbtree_test_node, node);
+    if (!RB_EMPTY_ROOT(&test_root)) {
+        rb_pool_destroy(&pool);
+        return -EFAULT;
+    }
+
+    /* released containers are handed out again before carving new ones */
+    carve = pool.carve;
+    for (count = 0; count < TEST_LOOP; ++count) {
+        node = rb_pool_alloc(&pool);
+        printf("rbtree 'rb_pool_alloc' test: %p\n", node);
+        if (!node || pool.carve != carve) {
+            rb_pool_destroy(&pool);
+            return -EFAULT;
+        }
+    }
+
+    rb_pool_destroy(&pool);
+    return 0;
+}
+
+struct rbtree_test_inode {
+    struct rbi_node node;
+    unsigned long data;
+};
+
+#define rbinode_to_test(ptr) \
+    rbi_entry(ptr, struct rbtree_test_inode, node)
+
+static long rbtest_rbi_cmp(const struct rbi_node *rba, const struct rbi_node *rbb)
+{
+    struct rbtree_test_inode *nodea = rbinode_to_test(rba);
+    struct rbtree_test_inode *nodeb = rbinode_to_test(rbb);
+    if (nodea->data == nodeb->data) return 0;
+    return nodea->data < nodeb->data ? -1 : 1;
+}
+
+static long rbtest_rbi_find(const struct rbi_node *rb, const void *key)
+{
+    struct rbtree_test_inode *node = rbinode_to_test(rb);
+    if (node->data == (unsigned long)key) return 0;
+    return (unsigned long)key < node->data ? -1 : 1;
+}
+
+static int rbtree_test_index(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_inode inodes[TEST_LOOP], *node, *prev = NULL;
+    unsigned long count;
+
+    RBI_ROOT(test_root, inodes, node);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        inodes[count].data = sdata->nodes[count].data;
+        rbi_insert(&test_root, &inodes[count].node, rbtest_rbi_cmp);
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!rbi_find(&test_root, (void *)inodes[count].data, rbtest_rbi_find))
+            return -EFAULT;
+    }
+
+    count = 0;
+    rbi_for_each_entry(node, &test_root, node) {
+        printf("rbtree 'rbi_for_each_entry' test: %lu\n", node->data);
+        if (prev && prev->data > node->data)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; count += 2)
+        rbi_delete(&test_root, &inodes[count].node);
+
+    for (count = 1; count < TEST_LOOP; count += 2) {
+        if (!rbi_find(&test_root, (void *)inodes[count].data, rbtest_rbi_find))
+            return -EFAULT;
+    }
+
+    for (count = 1; count < TEST_LOOP; count += 2)
+        rbi_delete(&test_root, &inodes[count].node);
+
+    if (!RBI_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+struct rbtree_test_lnode {
+    struct rbs_node node;
+    unsigned long data;
+};
+
+#define rbsnode_to_test(ptr) \
+    rbs_entry(ptr, struct rbtree_test_lnode, node)
+
+static long rbtest_rbs_cmp(const struct rbs_node *rba, const struct rbs_node *rbb)
+{
+    struct rbtree_test_lnode *nodea = rbsnode_to_test(rba);
+    struct rbtree_test_lnode *nodeb = rbsnode_to_test(rbb);
+    if (nodea->data == nodeb->data) return 0;
+    return nodea->data < nodeb->data ? -1 : 1;
+}
+
+static long rbtest_rbs_find(const struct rbs_node *rb, const void *key)
+{
+    struct rbtree_test_lnode *node = rbsnode_to_test(rb);
+    if (node->data == (unsigned long)key) return 0;
+    return (unsigned long)key < node->data ? -1 : 1;
+}
+
+static int rbtree_test_slim(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_lnode lnodes[TEST_LOOP], *node, *prev = NULL;
+    struct rbs_iter iter;
+    unsigned long count;
+
+    RBS_ROOT(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        lnodes[count].data = sdata->nodes[count].data;
+        rbs_insert(&test_root, &lnodes[count].node, rbtest_rbs_cmp);
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!rbs_find(&test_root, (void *)lnodes[count].data, rbtest_rbs_find))
+            return -EFAULT;
+    }
+
+    count = 0;
+    rbs_for_each_entry(node, &iter, &test_root, node) {
+        printf("rbtree 'rbs_for_each_entry' test: %lu\n", node->data);
+        if (prev && prev->data > node->data)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    count = 0;
+    rbs_post_for_each_entry(node, &iter, &test_root, node) {
+        printf("rbtree 'rbs_post_for_each_entry' test: %lu\n", node->data);
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!rbs_delete(&test_root, (void *)lnodes[count].data, rbtest_rbs_find))
+            return -EFAULT;
+    }
+
+    if (!RBS_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+struct rbtree_test_bnode {
+    struct bt_node node;
+};
+
+static int rbtree_test_btree(struct rbtree_test_pdata *bdata)
+{
+    struct rbtree_test_bnode bnodes[TEST_LOOP], *node, *prev = NULL;
+    struct bt_iter iter;
+    unsigned long count;
+
+    BT_ROOT(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        bnodes[count].node.key = bdata->nodes[count].data;
+        if (bt_insert(&test_root, &bnodes[count].node))
+            return -ENOMEM;
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!bt_find(&test_root, bnodes[count].node.key))
+            return -EFAULT;
+    }
+
+    count = 0;
+    bt_for_each_entry(node, &iter, &test_root, node) {
+        printf("rbtree 'bt_for_each_entry' test: %lu\n", node->node.key);
+        if (prev && prev->node.key > node->node.key)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    count = 0;
+    bt_for_each_entry_reverse(node, &iter, &test_root, node) {
+        printf("rbtree 'bt_for_each_entry_reverse' test: %lu\n", node->node.key);
+        if (count && prev->node.key < node->node.key)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != TEST_LOOP)
+        return -ENODATA;
+
+    count = 0;
+    bt_for_each_entry_from(node, &iter, &test_root, bnodes[0].node.key, node) {
+        if (node->node.key < bnodes[0].node.key)
+            return -EFAULT;
+        count++;
+    }
+
+    if (!count)
+        return -ENODATA;
+
+    for (count = 0; count < TEST_LOOP; ++count)
+        bt_delete(&test_root, &bnodes[count].node);
+
+    if (!BT_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    bt_destroy(&test_root);
+    return 0;
+}
+
+#define TEST_SL_LEVELS 4
+
+struct rbtree_test_snode {
+    SL_NODE(node, TEST_SL_LEVELS);
+    unsigned long data;
+};
+
+#define slnode_to_test(ptr) \
+    sl_entry(ptr, struct rbtree_test_snode, node)
+
+static long rbtest_sl_cmp(const struct sl_node *sla, const struct sl_node *slb)
+{
+    struct rbtree_test_snode *nodea = slnode_to_test(sla);
+    struct rbtree_test_snode *nodeb = slnode_to_test(slb);
+    if (nodea->data == nodeb->data) return 0;
+    return nodea->data < nodeb->data ? -1 : 1;
+}
+
+static long rbtest_sl_find(const struct sl_node *sl, const void *key)
+{
+    struct rbtree_test_snode *node = slnode_to_test(sl);
+    if (node->data == (unsigned long)key) return 0;
+    return (unsigned long)key < node->data ? -1 : 1;
+}
+
+static int rbtree_test_skiplist(struct rbtree_test_pdata *sdata)
+{
+    struct rbtree_test_snode snodes[TEST_LOOP], *node, *prev = NULL;
+    unsigned long count, inserted = 0;
+
+    SL_ROOT(test_root);
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        snodes[count].data = sdata->nodes[count].data;
+        sl_node_init(&snodes[count].node, sl_random_level(TEST_SL_LEVELS));
+        if (snodes[count].node.level > TEST_SL_LEVELS)
+            return -EFAULT;
+        inserted += sl_insert(&test_root, &snodes[count].node, rbtest_sl_cmp);
+    }
+
+    for (count = 0; count < TEST_LOOP; ++count) {
+        if (!sl_find(&test_root, (void *)snodes[count].data, rbtest_sl_find))
+            return -EFAULT;
+    }
+
+    count = 0;
+    sl_for_each_entry(node, &test_root, node) {
+        printf("rbtree 'sl_for_each_entry' test: %lu\n", node->data);
+        if (prev && prev->data >= node->data)
+            return -EFAULT;
+        prev = node;
+        count++;
+    }
+
+    if (count != inserted)
+        return -ENODATA;
+
+    sl_for_each_entry(node, &test_root, node) {
+        if (!sl_delete(&test_root, &node->node, rbtest_sl_cmp))
+            return -EFAULT;
+    }
+
+    if (!SL_EMPTY_ROOT(&test_root))
+        return -EFAULT;
+
+    return 0;
+}
+
+struct rbtree_test_anode {
+    struct rbtree_test_node test;
+    unsigned long size;
+};
+
+#define rbnode_to_atest(ptr) \
+    rb_entry(ptr, struct rbtree_test_anode, test.node)
+
+static unsigned long rbtree_test_asize(struct rb_node *rbnode)
+{
+    return rbnode ? rbnode_to_atest(rbnode)->size : 0;
+}
+
+static bool rbtree_test_acompute(struct rbtree_test_anode *node, bool exit)
+{
+    unsigned long size;
+
+    size = rbtree_test_asize(node->test.node.left) +
+           rbtree_test_asize(node->test.node.right) + 1;
+
+    if (exit && node->size == size)
+        return true;
+
+    node->size = size;
+    return false;
+}
+
+RB_DECLARE_CALLBACKS(static, rbtree_test_acallbacks, struct rbtree_test_anode,
+                     test.node, size, rbtree_test_acompute);
+
+/* empty, single, full and one past full trees, below and above the parallel cutoff */
+static const unsigned long rbtree_test_bcounts[] = {
+    0, 1, 2, 3, 31, 32, 63, 64, 4095, 4096, 8191, 8192, 10000,
+};
+
+static const unsigned int rbtree_test_bthreads[] = {
+    0, 1, 2, 3, 4, 8,
+};
+
+#define RBTREE_TEST_NR(array) \
+    (sizeof(array) / sizeof(*array))
+
+static int rbtree_test_build_check(struct rb_root *root, struct rb_node **nodes,
+                                   unsigned long count, bool augmented)
+{
+    struct rb_node *rbnode;
+    unsigned long index = 0;
+    int retval;
+
+    rb_for_each(rbnode, root) {
+        if (index == count || rbnode != nodes[index++])
+            return -EFAULT;
+        if (augmented && rbnode_to_atest(rbnode)->size !=
+            rbtree_test_asize(rbnode->left) + rbtree_test_asize(rbnode->right) + 1)
+            return -EFAULT;
+    }
+
+    if (index != count)
+        return -ENODATA;
+
+    if (augmented && rbtree_test_asize(root->node) != count)
+        return -EFAULT;
+
+    if ((retval = rbtree_test_child_check(root)) ||
+        (retval = rbtree_test_black_check(root)))
+        return retval;
+
+    return 0;
+}
+
+static int rbtree_test_build_sizes(struct rbtree_test_pdata *sdata)
+{
+    unsigned long max = rbtree_test_bcounts[RBTREE_TEST_NR(rbtree_test_bcounts) - 1];
+    unsigned long count, index;
+    struct rbtree_test_anode *anodes;
+    struct rb_node **nodes;
+    unsigned int ccount, tcount;
+    int retval = 0;
+
+    RB_ROOT(test_root);
+
+    anodes = malloc(sizeof(*anodes) * max);
+    nodes = malloc(sizeof(*nodes) * max);
+    if (!anodes || !nodes) {
+        retval = -ENOMEM;
+        goto free;
+    }
+
+    for (index = 0; index < max; ++index) {
+        anodes[index].test.data = index;
+        nodes[index] = &anodes[index].test.node;
+    }
+
+    for (ccount = 0; ccount < RBTREE_TEST_NR(rbtree_test_bcounts); ++ccount) {
+        count = rbtree_test_bcounts[ccount];
+
+        rb_build(&test_root, nodes, count);
+        if ((retval = rbtree_test_build_check(&test_root, nodes, count, false)))
+            goto free;
+
+        rb_build_augmented(&test_root, nodes, count, &rbtree_test_acallbacks);
+        if ((retval = rbtree_test_build_check(&test_root, nodes, count, true)))
+            goto free;
+
+        for (tcount = 0; tcount < RBTREE_TEST_NR(rbtree_test_bthreads); ++tcount) {
+            rb_parallel_build(&test_root, nodes, count, rbtree_test_bthreads[tcount]);
+            if ((retval = rbtree_test_build_check(&test_root, nodes, count, false)))
+                goto free;
+
+            rb_parallel_build_augmented(&test_root, nodes, count,
+                                        rbtree_test_bthreads[tcount], &rbtree_test_acallbacks);
+            if ((retval = rbtree_test_build_check(&test_root, nodes, count, true)))
+                goto free;
+        }
+
+        printf("rbtree 'rb_parallel_build' test: %lu nodes\n", count);
+    }
+
+free:
+    free(nodes);
+    free(anodes);
+    return retval;
+}
+
 int main(void)
 {
     struct rbtree_test_pdata *rdata;
@@ -452,6 +1741,158 @@ int main(void)
         return retval;
     }
 
+    printf("Build Test...\n");
+    retval = rbtree_test_build(rdata);
+    if (retval) {
+        printf("Abort3.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Hint Test...\n");
+    retval = rbtree_test_hint(rdata);
+    if (retval) {
+        printf("Abort4.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("U64 Test...\n");
+    retval = rbtree_test_u64(rdata);
+    if (retval) {
+        printf("Abort5.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Child Test...\n");
+    retval = rbtree_test_child(rdata);
+    if (retval) {
+        printf("Abort6.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Stats Test...\n");
+    retval = rbtree_test_stats(rdata);
+    if (retval) {
+        printf("Abort7.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Analyze Test...\n");
+    retval = rbtree_test_analyze(rdata);
+    if (retval) {
+        printf("Abort8.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("String Test...\n");
+    retval = rbtree_test_str(rdata);
+    if (retval) {
+        printf("Abort10.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Small Test...\n");
+    retval = rbtree_test_small(rdata);
+    if (retval) {
+        printf("Abort11.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Relaxed Test...\n");
+    retval = rbtree_test_relaxed(rdata);
+    if (retval) {
+        printf("Abort12.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Frozen Test...\n");
+    retval = rbtree_test_frozen(rdata);
+    if (retval) {
+        printf("Abort13.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Relayout Test...\n");
+    retval = rbtree_test_relayout(rdata);
+    if (retval) {
+        printf("Abort14.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Persist Test...\n");
+    retval = rbtree_test_persist(rdata);
+    if (retval) {
+        printf("Abort15.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Pool Test...\n");
+    retval = rbtree_test_pool(rdata);
+    if (retval) {
+        printf("Abort16.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Index Test...\n");
+    retval = rbtree_test_index(rdata);
+    if (retval) {
+        printf("Abort17.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Slim Test...\n");
+    retval = rbtree_test_slim(rdata);
+    if (retval) {
+        printf("Abort18.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Btree Test...\n");
+    retval = rbtree_test_btree(rdata);
+    if (retval) {
+        printf("Abort19.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Skiplist Test...\n");
+    retval = rbtree_test_skiplist(rdata);
+    if (retval) {
+        printf("Abort20.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Build Sizes Test...\n");
+    retval = rbtree_test_build_sizes(rdata);
+    if (retval) {
+        printf("Abort21.\n");
+        free(rdata);
+        return retval;
+    }
+
+    printf("Trace Test...\n");
+    retval = rbtree_test_trace(rdata);
+    if (retval) {
+        printf("Abort9.\n");
+        free(rdata);
+        return retval;
+    }
+
     printf("Done.\n");
     free(rdata);
 
@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "slim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN 1000000
+
+struct std_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+struct slim_node {
+    struct rbs_node rb;
+    unsigned long key;
+};
+
+#define rb_to_std(node) \
+    rb_entry(node, struct std_node, rb)
+
+#define rb_to_slim(node) \
+    rbs_entry(node, struct slim_node, rb)
+
+static long std_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_std(a)->key < rb_to_std(b)->key ? -1 : 1;
+}
+
+static long std_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_std(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static long slim_cmp(const struct rbs_node *a, const struct rbs_node *b)
+{
+    return rb_to_slim(a)->key < rb_to_slim(b)->key ? -1 : 1;
+}
+
+static long slim_find(const struct rbs_node *node, const void *key)
+{
+    unsigned long kn = rb_to_slim(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, double stop, unsigned long length)
+{
+    printf("\t%s: %lf ns/op\n", name, (stop - start) * 1e9 / length);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count, length = TEST_LEN, found = 0;
+    struct std_node *snodes, *snode;
+    struct slim_node *lnodes, *lnode;
+    unsigned long *keys;
+    struct rbs_iter iter;
+    double start, stop;
+    RB_ROOT(sroot);
+    RBS_ROOT(lroot);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    keys = malloc(sizeof(*keys) * length);
+    snodes = malloc(sizeof(*snodes) * length);
+    lnodes = malloc(sizeof(*lnodes) * length);
+    if (!keys || !snodes || !lnodes || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        keys[count] = ((unsigned long)rand() << 32) | rand();
+
+    printf("Standard Node (%zu bytes/node, %.1lf MiB):\n", sizeof(*snodes),
+           (double)sizeof(*snodes) * length / (1 << 20));
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        snodes[count].key = keys[count];
+        rb_insert(&sroot, &snodes[count].rb, std_cmp);
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        found += !!rb_find(&sroot, (void *)keys[count], std_find);
+    stop = time_now();
+    report("find", start, stop, length);
+
+    start = time_now();
+    rb_for_each_entry(snode, &sroot, rb)
+        found += snode->key & 1;
+    stop = time_now();
+    report("traverse", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_delete(&sroot, rb_find(&sroot, (void *)keys[count], std_find));
+    stop = time_now();
+    report("delete", start, stop, length);
+
+    printf("Slim Node (%zu bytes/node, %.1lf MiB):\n", sizeof(*lnodes),
+           (double)sizeof(*lnodes) * length / (1 << 20));
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        lnodes[count].key = keys[count];
+        rbs_insert(&lroot, &lnodes[count].rb, slim_cmp);
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        found -= !!rbs_find(&lroot, (void *)keys[count], slim_find);
+    stop = time_now();
+    report("find", start, stop, length);
+
+    start = time_now();
+    rbs_for_each_entry(lnode, &iter, &lroot, rb)
+        found -= lnode->key & 1;
+    stop = time_now();
+    report("traverse", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rbs_delete(&lroot, (void *)keys[count], slim_find);
+    stop = time_now();
+    report("delete", start, stop, length);
+
+    free(keys);
+    free(snodes);
+    free(lnodes);
+
+    if (found || !RBS_EMPTY_ROOT(&lroot)) {
+        printf("Mismatch!\n");
+        return -EFAULT;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include "small.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_NODES  1000000
+
+struct small_node {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+#define rb_to_small(node) \
+    rb_entry(node, struct small_node, rb)
+
+static long small_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_small(a)->key < rb_to_small(b)->key ? -1 : 1;
+}
+
+static long small_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_small(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, double stop, unsigned long length)
+{
+    printf("\t%s: %lf ns/op\n", name, (stop - start) * 1e9 / length);
+}
+
+static int run(unsigned long size)
+{
+    unsigned long count, sets = TEST_NODES / size, total = sets * size, found = 0;
+    unsigned long set, seed = 0x9e3779b97f4a7c15UL;
+    struct rb_root_cached *roots;
+    struct small_node *nodes, *node;
+    struct rb_small *smalls;
+    double start, stop;
+
+    nodes = malloc(sizeof(*nodes) * total);
+    roots = malloc(sizeof(*roots) * sets);
+    smalls = malloc(sizeof(*smalls) * sets);
+    if (!nodes || !roots || !smalls) {
+        free(nodes);
+        free(roots);
+        free(smalls);
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < total; ++count)
+        nodes[count].key = next_rand(&seed);
+
+    /* fault the headers in here rather than in the timed loops */
+    memset(roots, 0xff, sizeof(*roots) * sets);
+    memset(smalls, 0xff, sizeof(*smalls) * sets);
+
+    for (set = 0; set < sets; ++set) {
+        roots[set] = RB_CACHED_INIT;
+        smalls[set] = RB_SMALL_INIT;
+    }
+
+    printf("Cached Rbtree (%lu sets of %lu):\n", sets, size);
+
+    start = time_now();
+    for (count = 0; count < total; ++count)
+        rb_cached_insert(&roots[count / size], &nodes[count].rb, small_cmp);
+    stop = time_now();
+    report("insert", start, stop, total);
+
+    start = time_now();
+    for (count = 0; count < total; ++count)
+        found += !!rb_cached_find(&roots[count / size], (void *)nodes[count].key, small_find);
+    stop = time_now();
+    report("find", start, stop, total);
+
+    start = time_now();
+    for (set = 0; set < sets; ++set) {
+        rb_cached_for_each_entry(node, &roots[set], rb)
+            found += node->key & 1;
+    }
+    stop = time_now();
+    report("iterate", start, stop, total);
+
+    start = time_now();
+    for (count = 0; count < total; ++count)
+        rb_cached_delete(&roots[count / size], &nodes[count].rb);
+    stop = time_now();
+    report("delete", start, stop, total);
+
+    printf("Small Hybrid (%lu sets of %lu, threshold %u):\n", sets, size, RB_SMALL_MAX);
+
+    start = time_now();
+    for (count = 0; count < total; ++count)
+        rb_small_insert(&smalls[count / size], &nodes[count].rb, small_cmp);
+    stop = time_now();
+    report("insert", start, stop, total);
+
+    start = time_now();
+    for (count = 0; count < total; ++count)
+        found -= !!rb_small_find(&smalls[count / size], (void *)nodes[count].key, small_find);
+    stop = time_now();
+    report("find", start, stop, total);
+
+    start = time_now();
+    for (set = 0; set < sets; ++set) {
+        rb_small_for_each_entry(node, &smalls[set], rb)
+            found -= node->key & 1;
+    }
+    stop = time_now();
+    report("iterate", start, stop, total);
+
+    start = time_now();
+    for (count = 0; count < total; ++count)
+        rb_small_delete(&smalls[count / size], &nodes[count].rb);
+    stop = time_now();
+    report("delete", start, stop, total);
+
+    free(nodes);
+    free(roots);
+    free(smalls);
+
+    return found ? -EFAULT : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long size;
+    int retval;
+
+    for (size = 4; size <= RB_SMALL_MAX * 4; size *= 2) {
+        if ((retval = run(size))) {
+            printf("Abort.\n");
+            return retval;
+        }
+    }
+
+    printf("Done.\n");
+    return 0;
+}
@@ -0,0 +1,196 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    1000000
+#define LOOKUP_OPS  1000000
+#define KEY_SIZE    96
+
+struct ptr_node {
+    struct rb_node rb;
+    const char *key;
+};
+
+struct str_node {
+    struct rb_node_str rb;
+};
+
+#define rb_to_ptr(node) \
+    rb_entry(node, struct ptr_node, rb)
+
+static const char *const words[] = {
+    "api", "assets", "blog", "cache", "docs", "download", "images", "index",
+    "lib", "login", "media", "news", "products", "search", "static", "user",
+};
+
+static const char *const roots[] = {
+    "/usr/lib/", "/usr/share/", "/usr/include/", "/var/log/",
+    "/home/alice/", "/home/bob/", "/etc/", "/opt/",
+};
+
+static long ptr_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return strcmp(rb_to_ptr(a)->key, rb_to_ptr(b)->key) < 0 ? -1 : 1;
+}
+
+static long ptr_find(const struct rb_node *node, const void *key)
+{
+    return strcmp(key, rb_to_ptr(node)->key);
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, double stop, unsigned long length)
+{
+    printf("\t%s: %lf ns/op\n", name, (stop - start) * 1e9 / length);
+}
+
+static void make_url(char *buff, unsigned long *seed)
+{
+    unsigned long rand = next_rand(seed);
+
+    snprintf(buff, KEY_SIZE, "https://www.site%lu.com/%s/%s/%lu.html",
+             rand % 1000, words[(rand >> 10) % 16], words[(rand >> 14) % 16],
+             (rand >> 18) % 100000);
+}
+
+static void make_path(char *buff, unsigned long *seed)
+{
+    unsigned long rand = next_rand(seed);
+
+    snprintf(buff, KEY_SIZE, "%s%s/%s%lu/file%lu.c",
+             roots[rand % 8], words[(rand >> 3) % 16], words[(rand >> 7) % 16],
+             (rand >> 11) % 100, (rand >> 18) % 10000);
+}
+
+static void make_word(char *buff, unsigned long *seed)
+{
+    unsigned long rand = next_rand(seed);
+    unsigned int count;
+
+    for (count = 0; count < 12; ++count, rand >>= 5)
+        buff[count] = 'a' + rand % 26;
+    buff[count] = '\0';
+}
+
+static int run(const char *name, char *keys, unsigned long length,
+               struct ptr_node *pnodes, struct str_node *snodes)
+{
+    unsigned long count, seed = 0x9e3779b97f4a7c15UL, found = 0;
+    double start, stop;
+    char *key;
+    RB_ROOT(proot);
+    RB_ROOT(sroot);
+
+    printf("%s Keys, Comparator Callback (%lu nodes):\n", name, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        pnodes[count].key = keys + count * KEY_SIZE;
+        rb_insert(&proot, &pnodes[count].rb, ptr_cmp);
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        found += !!rb_find(&proot, keys + next_rand(&seed) % length * KEY_SIZE, ptr_find);
+    stop = time_now();
+    report("find", start, stop, LOOKUP_OPS);
+
+    printf("%s Keys, Cached Prefix (%lu nodes):\n", name, length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count) {
+        key = keys + count * KEY_SIZE;
+        rb_str_init(&snodes[count].rb, key, strlen(key));
+        rb_str_insert(&sroot, &snodes[count].rb);
+    }
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count) {
+        key = keys + next_rand(&seed) % length * KEY_SIZE;
+        found -= !!rb_str_find(&sroot, key, strlen(key));
+    }
+    stop = time_now();
+    report("find", start, stop, LOOKUP_OPS);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count) {
+        key = keys + next_rand(&seed) % length * KEY_SIZE;
+        found += !rb_str_lower_bound(&sroot, key, strlen(key));
+    }
+    stop = time_now();
+    report("lower_bound", start, stop, LOOKUP_OPS);
+
+    return found ? -EFAULT : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count, length = TEST_LEN, seed = 1;
+    int retval = 0;
+    struct ptr_node *pnodes;
+    struct str_node *snodes;
+    char *keys;
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    /* keys live apart from the nodes, as they would in a real table */
+    keys = malloc(KEY_SIZE * length);
+    pnodes = malloc(sizeof(*pnodes) * length);
+    snodes = malloc(sizeof(*snodes) * length);
+    if (!keys || !pnodes || !snodes || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        make_url(keys + count * KEY_SIZE, &seed);
+    retval |= run("URL", keys, length, pnodes, snodes);
+
+    for (count = 0; count < length; ++count)
+        make_path(keys + count * KEY_SIZE, &seed);
+    retval |= run("Path", keys, length, pnodes, snodes);
+
+    for (count = 0; count < length; ++count)
+        make_word(keys + count * KEY_SIZE, &seed);
+    retval |= run("Word", keys, length, pnodes, snodes);
+
+    free(keys);
+    free(pnodes);
+    free(snodes);
+
+    if (retval) {
+        printf("Mismatch!\n");
+        return retval;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
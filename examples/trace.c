@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    1000000
+#define TEST_BURST  1000
+
+/*
+ * A session table as a service would keep it: new sessions arrive,
+ * lookups favour recent sessions, the oldest expire, and requests
+ * come in bursts separated by idle gaps. Every operation goes through
+ * the trace wrappers, so the file replays this exact interleaving.
+ */
+
+struct session {
+    struct rb_node rb;
+    unsigned long key;
+};
+
+#define rb_to_session(node) \
+    rb_entry(node, struct session, rb)
+
+static long session_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_session(a)->key < rb_to_session(b)->key ? -1 : 1;
+}
+
+static long session_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_session(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "rbtree.trace";
+    unsigned long count, length = TEST_LEN, seed = 0x9e3779b97f4a7c15UL;
+    unsigned long head = 0, tail = 0, rand, key, found = 0;
+    struct timespec idle = {0, 50000};
+    struct session *sessions;
+    static struct rb_trace trace;
+    RB_ROOT_CACHED(root);
+    int retval;
+
+    if (argc > 2)
+        length = strtoul(argv[2], NULL, 0);
+
+    sessions = malloc(sizeof(*sessions) * length);
+    if (!sessions || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    if ((retval = rb_trace_open(&trace, path))) {
+        printf("Cannot create %s: %d\n", path, retval);
+        return retval;
+    }
+
+    /* sessions[tail, head) are live, the oldest at tail */
+    for (count = 0; count < length; ++count) {
+        rand = next_rand(&seed);
+
+        if (head == tail || (rand % 10 < 3 && head < length)) {
+            if (head == length)
+                break;
+            sessions[head].key = next_rand(&seed);
+            rb_trace_cached_insert(&trace, &root, &sessions[head].rb,
+                                   session_cmp, sessions[head].key);
+            head++;
+        } else if (rand % 10 < 8) {
+            /* recent sessions are looked up far more often */
+            rand >>= 8;
+            key = sessions[head - 1 - rand % (rand % (head - tail) + 1)].key;
+            found += !!rb_trace_cached_find(&trace, &root, (void *)key, session_find, key);
+        } else {
+            rb_trace_cached_delete(&trace, &root, &sessions[tail].rb, sessions[tail].key);
+            tail++;
+        }
+
+        if (count % TEST_BURST == TEST_BURST - 1)
+            nanosleep(&idle, NULL);
+    }
+
+    if ((retval = rb_trace_close(&trace))) {
+        printf("Cannot write %s: %d\n", path, retval);
+        return retval;
+    }
+
+    printf("Recorded %lu operations (%lu live, %lu found) to %s.\n",
+           count, head - tail, found, path);
+    free(sessions);
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#define TEST_LEN    1000000
+#define LOOKUP_OPS  2000000
+#define PAYLOAD     64
+
+/* key stored after the payload, one cache line away from the links */
+struct cb_node {
+    struct rb_node rb;
+    char payload[PAYLOAD];
+    unsigned long key;
+} __attribute__((aligned(64)));
+
+struct u64_node {
+    struct rb_node_u64 rb;
+    char payload[PAYLOAD];
+} __attribute__((aligned(64)));
+
+#define rb_to_cb(node) \
+    rb_entry(node, struct cb_node, rb)
+
+static long cb_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+    return rb_to_cb(a)->key < rb_to_cb(b)->key ? -1 : 1;
+}
+
+static long cb_find(const struct rb_node *node, const void *key)
+{
+    unsigned long kn = rb_to_cb(node)->key, kk = (unsigned long)key;
+    return kk < kn ? -1 : kk > kn;
+}
+
+static unsigned long next_rand(unsigned long *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double start, double stop, unsigned long length)
+{
+    printf("\t%s: %lf ns/op\n", name, (stop - start) * 1e9 / length);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count, length = TEST_LEN, seed = 0x9e3779b97f4a7c15UL, found = 0, bounds = 0;
+    struct cb_node *cnodes;
+    struct u64_node *unodes;
+    double start, stop;
+    RB_ROOT(croot);
+    RB_ROOT(uroot);
+
+    if (argc > 1)
+        length = strtoul(argv[1], NULL, 0);
+
+    cnodes = aligned_alloc(64, sizeof(*cnodes) * length);
+    unodes = aligned_alloc(64, sizeof(*unodes) * length);
+    if (!cnodes || !unodes || !length) {
+        printf("Insufficient Memory!\n");
+        return -ENOMEM;
+    }
+
+    for (count = 0; count < length; ++count)
+        cnodes[count].key = unodes[count].rb.key = next_rand(&seed);
+
+    printf("Comparator Callback (%lu nodes):\n", length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_insert(&croot, &cnodes[count].rb, cb_cmp);
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        found += !!rb_find(&croot, (void *)cnodes[next_rand(&seed) % length].key, cb_find);
+    stop = time_now();
+    report("find", start, stop, LOOKUP_OPS);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_delete(&croot, &cnodes[count].rb);
+    stop = time_now();
+    report("delete", start, stop, length);
+
+    printf("Embedded U64 Key (%lu nodes):\n", length);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_u64_insert(&uroot, &unodes[count].rb);
+    stop = time_now();
+    report("insert", start, stop, length);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        found -= !!rb_u64_find(&uroot, unodes[next_rand(&seed) % length].rb.key);
+    stop = time_now();
+    report("find", start, stop, LOOKUP_OPS);
+
+    start = time_now();
+    for (count = 0; count < LOOKUP_OPS; ++count)
+        bounds += !!rb_u64_lower_bound(&uroot, next_rand(&seed));
+    stop = time_now();
+    report("lower_bound", start, stop, LOOKUP_OPS);
+
+    start = time_now();
+    for (count = 0; count < length; ++count)
+        rb_u64_delete(&uroot, &unodes[count].rb);
+    stop = time_now();
+    report("delete", start, stop, length);
+
+    free(cnodes);
+    free(unodes);
+
+    if (found || bounds > LOOKUP_OPS) {
+        printf("Mismatch!\n");
+        return -EFAULT;
+    }
+
+    printf("Done.\n");
+    return 0;
+}
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define ANALYZE_LINE_SHIFT  6
+#define ANALYZE_PAGE_SHIFT  12
+
+static int analyze_cmp(const void *a, const void *b)
+{
+    uintptr_t va = *(const uintptr_t *)a, vb = *(const uintptr_t *)b;
+    return (va > vb) - (va < vb);
+}
+
+/**
+ * analyze_spread - count the distinct cache lines and pages of the nodes.
+ * @report: report to fill.
+ * @lines: cache line number of every node, sorted in place.
+ */
+static void analyze_spread(struct rb_report *report, uintptr_t *lines)
+{
+    const unsigned int shift = ANALYZE_PAGE_SHIFT - ANALYZE_LINE_SHIFT;
+    unsigned long count;
+
+    qsort(lines, report->nodes, sizeof(*lines), analyze_cmp);
+
+    /* sorted by line is sorted by page as well */
+    report->lines = report->pages = 1;
+    for (count = 1; count < report->nodes; ++count) {
+        if (lines[count] == lines[count - 1])
+            continue;
+        report->lines++;
+        if (lines[count] >> shift != lines[count - 1] >> shift)
+            report->pages++;
+    }
+}
+
+/**
+ * rb_analyze - report the shape and memory spread of a rbtree.
+ * @root: rbtree to analyze.
+ * @report: report to fill.
+ *
+ * Walks the tree once in preorder, keeping the depth and black count
+ * of the current node as the iterator climbs, so the tree can be
+ * arbitrarily deep. Leaves are nodes without children, the black
+ * height is counted on the path to the first leaf and a search for a
+ * present key makes one comparison per level down to its node.
+ * Lines and pages are those holding the start of a node.
+ *
+ * Returns 0, or -ENOMEM when the spread cannot be counted.
+ */
+int rb_analyze(const struct rb_root *root, struct rb_report *report)
+{
+    unsigned long depth = 0, blacks = 0, reds = 0, leaves = 0, total = 0;
+    struct rb_node *node, *next, *walk;
+    uintptr_t *lines;
+
+    memset(report, 0, sizeof(*report));
+    if (!root->node)
+        return 0;
+
+    for (node = root->node; node; node = next) {
+        depth++;
+        blacks += node->color == RB_BLACK;
+        reds += node->color == RB_RED;
+        report->nodes++;
+        report->depths[depth < RB_REPORT_DEPTH ? depth - 1 : RB_REPORT_DEPTH - 1]++;
+        total += depth;
+
+        if (!node->left && !node->right) {
+            if (!leaves++) {
+                report->min_depth = depth;
+                report->black_height = blacks;
+            }
+            if (depth < report->min_depth)
+                report->min_depth = depth;
+            if (depth > report->max_depth)
+                report->max_depth = depth;
+            report->avg_depth += depth;
+        }
+
+        if (!(next = rb_pre_next(node)))
+            break;
+
+        /* climb back to the parent of the next node */
+        for (walk = node; walk != next->parent; walk = walk->parent) {
+            depth--;
+            blacks -= walk->color == RB_BLACK;
+        }
+    }
+
+    report->leaves = leaves;
+    report->avg_depth /= leaves;
+    report->red_ratio = (double)reds / report->nodes;
+    report->avg_compares = (double)total / report->nodes;
+
+    lines = malloc(sizeof(*lines) * report->nodes);
+    if (!lines)
+        return -ENOMEM;
+
+    total = 0;
+    rb_for_each(node, root)
+        lines[total++] = (uintptr_t)node >> ANALYZE_LINE_SHIFT;
+
+    analyze_spread(report, lines);
+    free(lines);
+
+    return 0;
+}
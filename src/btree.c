@@ -0,0 +1,636 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "btree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#define BT_ALIGN    64
+#define BT_LANES    (32 / sizeof(unsigned long))
+#define BT_MIN      (BT_ORDER / 2)
+
+#if BT_ORDER < 4 || BT_ORDER % 4
+# error "BT_ORDER must be a multiple of 4"
+#endif
+
+/*
+ * The default x86-64 target has no 64-bit vector compare, so the
+ * functions ranking pages are also built for AVX2 and picked once
+ * at load time.
+ */
+#if defined(__x86_64__) && !defined(__AVX2__)
+# define BT_SIMD __attribute__((target_clones("avx2", "default")))
+#else
+# define BT_SIMD
+#endif
+
+typedef unsigned long bt_vec_t __attribute__((vector_size(32)));
+
+struct bt_page {
+    unsigned long keys[BT_ORDER];
+    unsigned int count;
+};
+
+struct bt_inner {
+    struct bt_page page;
+    struct bt_page *child[BT_ORDER + 1];
+};
+
+struct bt_leaf {
+    struct bt_page page;
+    struct bt_node *entry[BT_ORDER];
+    struct bt_leaf *prev;
+    struct bt_leaf *next;
+};
+
+struct bt_path {
+    struct bt_inner *inner[BT_MAX_DEPTH];
+    unsigned int slot[BT_MAX_DEPTH];
+    struct bt_leaf *leaf;
+    unsigned int index;
+};
+
+#define page_inner(ptr) \
+    rb_entry(ptr, struct bt_inner, page)
+
+#define page_leaf(ptr) \
+    rb_entry(ptr, struct bt_leaf, page)
+
+/**
+ * page_rank - count the keys of a page below a key.
+ * @page: page to rank in.
+ * @key: key to rank.
+ * @upper: count keys equal to @key as well.
+ *
+ * All BT_ORDER slots are compared a vector at a time; unused slots
+ * hold ULONG_MAX, so only an upper rank needs to be clamped.
+ */
+static __always_inline unsigned int
+page_rank(const struct bt_page *page, unsigned long key, bool upper)
+{
+    bt_vec_t lane, pivot = (bt_vec_t){} + key, acc = {};
+    unsigned int index;
+
+    for (index = 0; index < BT_ORDER; index += BT_LANES) {
+        memcpy(&lane, page->keys + index, sizeof(lane));
+        acc -= (bt_vec_t)(upper ? lane <= pivot : lane < pivot);
+    }
+
+    for (index = 1; index < BT_LANES; ++index)
+        acc[0] += acc[index];
+
+    if (upper && acc[0] > page->count)
+        return page->count;
+
+    return acc[0];
+}
+
+static struct bt_page *page_alloc(size_t size)
+{
+    struct bt_page *page;
+
+    page = aligned_alloc(BT_ALIGN, (size + BT_ALIGN - 1) & ~(BT_ALIGN - 1UL));
+    if (!page)
+        return NULL;
+
+    memset(page->keys, 0xff, sizeof(page->keys));
+    page->count = 0;
+
+    return page;
+}
+
+static void page_destroy(struct bt_page *page, unsigned int height)
+{
+    unsigned int index;
+
+    if (height) {
+        for (index = 0; index <= page->count; ++index)
+            page_destroy(page_inner(page)->child[index], height - 1);
+    }
+
+    free(page);
+}
+
+/**
+ * path_descend - record the path to the rank of a key.
+ * @root: btree root to walk.
+ * @key: key to rank.
+ * @upper: stop after keys equal to @key instead of before them.
+ * @path: filled with the inner pages walked and the leaf slot.
+ */
+static __always_inline void
+path_descend(const struct bt_root *root, unsigned long key, bool upper, struct bt_path *path)
+{
+    struct bt_page *page = root->node;
+    unsigned int level;
+
+    for (level = 0; level < root->height; ++level) {
+        path->inner[level] = page_inner(page);
+        path->slot[level] = page_rank(page, key, upper);
+        page = page_inner(page)->child[path->slot[level]];
+    }
+
+    path->leaf = page_leaf(page);
+    path->index = page_rank(page, key, upper);
+}
+
+/**
+ * path_next_leaf - move a path to the first slot of the next leaf.
+ * @path: path to move.
+ * @height: number of inner levels.
+ */
+static void path_next_leaf(struct bt_path *path, unsigned int height)
+{
+    struct bt_page *page;
+    unsigned int level;
+
+    for (level = height; level--;) {
+        if (path->slot[level] < path->inner[level]->page.count)
+            break;
+    }
+
+    page = path->inner[level]->child[++path->slot[level]];
+    while (++level < height) {
+        path->inner[level] = page_inner(page);
+        path->slot[level] = 0;
+        page = page_inner(page)->child[0];
+    }
+
+    path->leaf = page_leaf(page);
+    path->index = 0;
+}
+
+static void leaf_insert(struct bt_leaf *leaf, unsigned int index, struct bt_node *node)
+{
+    unsigned int count = leaf->page.count - index;
+
+    memmove(leaf->page.keys + index + 1, leaf->page.keys + index, sizeof(*leaf->page.keys) * count);
+    memmove(leaf->entry + index + 1, leaf->entry + index, sizeof(*leaf->entry) * count);
+    leaf->page.keys[index] = node->key;
+    leaf->entry[index] = node;
+    leaf->page.count++;
+}
+
+static void leaf_remove(struct bt_leaf *leaf, unsigned int index)
+{
+    unsigned int count = --leaf->page.count - index;
+
+    memmove(leaf->page.keys + index, leaf->page.keys + index + 1, sizeof(*leaf->page.keys) * count);
+    memmove(leaf->entry + index, leaf->entry + index + 1, sizeof(*leaf->entry) * count);
+    leaf->page.keys[leaf->page.count] = ULONG_MAX;
+}
+
+static void inner_insert(struct bt_inner *inner, unsigned int slot,
+                         unsigned long key, struct bt_page *child)
+{
+    unsigned int count = inner->page.count - slot;
+
+    memmove(inner->page.keys + slot + 1, inner->page.keys + slot, sizeof(*inner->page.keys) * count);
+    memmove(inner->child + slot + 2, inner->child + slot + 1, sizeof(*inner->child) * count);
+    inner->page.keys[slot] = key;
+    inner->child[slot + 1] = child;
+    inner->page.count++;
+}
+
+static void inner_remove(struct bt_inner *inner, unsigned int slot)
+{
+    unsigned int count = --inner->page.count - slot;
+
+    memmove(inner->page.keys + slot, inner->page.keys + slot + 1, sizeof(*inner->page.keys) * count);
+    memmove(inner->child + slot + 1, inner->child + slot + 2, sizeof(*inner->child) * count);
+    inner->page.keys[inner->page.count] = ULONG_MAX;
+}
+
+/**
+ * leaf_split - insert into a full leaf by splitting it.
+ * @leaf: full leaf, keeps the lower half.
+ * @right: empty leaf, takes the upper half.
+ * @index: slot of the new entry.
+ * @node: new entry.
+ *
+ * Returns the separator key for the parent.
+ */
+static unsigned long leaf_split(struct bt_leaf *leaf, struct bt_leaf *right,
+                                unsigned int index, struct bt_node *node)
+{
+    unsigned int keep = (BT_ORDER + 1) / 2;
+
+    if (index < keep) {
+        right->page.count = BT_ORDER - keep + 1;
+        memcpy(right->page.keys, leaf->page.keys + keep - 1, sizeof(*right->page.keys) * right->page.count);
+        memcpy(right->entry, leaf->entry + keep - 1, sizeof(*right->entry) * right->page.count);
+        leaf->page.count = keep - 1;
+        memset(leaf->page.keys + keep - 1, 0xff, sizeof(*leaf->page.keys) * right->page.count);
+        leaf_insert(leaf, index, node);
+    } else {
+        right->page.count = BT_ORDER - keep;
+        memcpy(right->page.keys, leaf->page.keys + keep, sizeof(*right->page.keys) * right->page.count);
+        memcpy(right->entry, leaf->entry + keep, sizeof(*right->entry) * right->page.count);
+        leaf->page.count = keep;
+        memset(leaf->page.keys + keep, 0xff, sizeof(*leaf->page.keys) * right->page.count);
+        leaf_insert(right, index - keep, node);
+    }
+
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next)
+        leaf->next->prev = right;
+    leaf->next = right;
+
+    return right->page.keys[0];
+}
+
+/**
+ * inner_split - insert into a full inner page by splitting it.
+ * @inner: full inner page, keeps the lower half.
+ * @right: empty inner page, takes the upper half.
+ * @slot: child slot that was split below.
+ * @key: separator to insert, replaced by the one for the parent.
+ * @child: page to insert after @slot.
+ */
+static void inner_split(struct bt_inner *inner, struct bt_inner *right, unsigned int slot,
+                        unsigned long *key, struct bt_page *child)
+{
+    unsigned long keys[BT_ORDER + 1];
+    struct bt_page *childs[BT_ORDER + 2];
+    unsigned int keep = BT_ORDER / 2;
+
+    memcpy(keys, inner->page.keys, sizeof(*keys) * slot);
+    memcpy(keys + slot + 1, inner->page.keys + slot, sizeof(*keys) * (BT_ORDER - slot));
+    keys[slot] = *key;
+
+    memcpy(childs, inner->child, sizeof(*childs) * (slot + 1));
+    memcpy(childs + slot + 2, inner->child + slot + 1, sizeof(*childs) * (BT_ORDER - slot));
+    childs[slot + 1] = child;
+
+    inner->page.count = keep;
+    memcpy(inner->page.keys, keys, sizeof(*keys) * keep);
+    memset(inner->page.keys + keep, 0xff, sizeof(*keys) * (BT_ORDER - keep));
+    memcpy(inner->child, childs, sizeof(*childs) * (keep + 1));
+
+    right->page.count = BT_ORDER - keep;
+    memcpy(right->page.keys, keys + keep + 1, sizeof(*keys) * right->page.count);
+    memcpy(right->child, childs + keep + 1, sizeof(*childs) * (right->page.count + 1));
+
+    *key = keys[keep];
+}
+
+/**
+ * bt_insert - insert a node after all nodes with an equal key.
+ * @root: btree root to insert into.
+ * @node: new node to insert, with its key set.
+ *
+ * Returns -ENOMEM if a page cannot be allocated, in which case the
+ * tree is left untouched.
+ */
+BT_SIMD int bt_insert(struct bt_root *root, struct bt_node *node)
+{
+    struct bt_page *spare[BT_MAX_DEPTH + 1], *child;
+    unsigned int level, needed = 0, index;
+    struct bt_path path;
+    struct bt_inner *inner;
+    unsigned long key;
+
+    if (!root->node) {
+        root->node = page_alloc(sizeof(struct bt_leaf));
+        if (!root->node)
+            return -ENOMEM;
+        page_leaf(root->node)->prev = NULL;
+        page_leaf(root->node)->next = NULL;
+        root->height = 0;
+    }
+
+    path_descend(root, node->key, true, &path);
+    if (path.leaf->page.count < BT_ORDER) {
+        leaf_insert(path.leaf, path.index, node);
+        return 0;
+    }
+
+    /* allocate every split up front so failure changes nothing */
+    for (level = root->height; level--;) {
+        if (path.inner[level]->page.count < BT_ORDER)
+            break;
+        needed++;
+    }
+
+    if (needed == root->height && root->height == BT_MAX_DEPTH)
+        return -ENOMEM;
+
+    needed += 1 + (needed == root->height);
+    for (index = 0; index < needed; ++index) {
+        spare[index] = page_alloc(index ? sizeof(struct bt_inner) : sizeof(struct bt_leaf));
+        if (!spare[index]) {
+            while (index--)
+                free(spare[index]);
+            return -ENOMEM;
+        }
+    }
+
+    key = leaf_split(path.leaf, page_leaf(spare[0]), path.index, node);
+    child = spare[0];
+
+    for (index = 1, level = root->height; level--; ++index) {
+        inner = path.inner[level];
+        if (inner->page.count < BT_ORDER) {
+            inner_insert(inner, path.slot[level], key, child);
+            return 0;
+        }
+
+        inner_split(inner, page_inner(spare[index]), path.slot[level], &key, child);
+        child = spare[index];
+    }
+
+    /* the root was split as well, grow a level */
+    inner = page_inner(spare[index]);
+    inner->page.count = 1;
+    inner->page.keys[0] = key;
+    inner->child[0] = root->node;
+    inner->child[1] = child;
+    root->node = &inner->page;
+    root->height++;
+
+    return 0;
+}
+
+static void leaf_rebalance(struct bt_inner *parent, unsigned int slot)
+{
+    struct bt_leaf *leaf = page_leaf(parent->child[slot]), *sibling;
+
+    if (slot && parent->child[slot - 1]->count > BT_MIN) {
+        sibling = page_leaf(parent->child[slot - 1]);
+        leaf_insert(leaf, 0, sibling->entry[sibling->page.count - 1]);
+        leaf_remove(sibling, sibling->page.count - 1);
+        parent->page.keys[slot - 1] = leaf->page.keys[0];
+        return;
+    }
+
+    if (slot < parent->page.count && parent->child[slot + 1]->count > BT_MIN) {
+        sibling = page_leaf(parent->child[slot + 1]);
+        leaf_insert(leaf, leaf->page.count, sibling->entry[0]);
+        leaf_remove(sibling, 0);
+        parent->page.keys[slot] = sibling->page.keys[0];
+        return;
+    }
+
+    /* merge the right one of the pair into the left one */
+    if (slot)
+        leaf = page_leaf(parent->child[--slot]);
+    sibling = page_leaf(parent->child[slot + 1]);
+
+    memcpy(leaf->page.keys + leaf->page.count, sibling->page.keys,
+           sizeof(*leaf->page.keys) * sibling->page.count);
+    memcpy(leaf->entry + leaf->page.count, sibling->entry,
+           sizeof(*leaf->entry) * sibling->page.count);
+    leaf->page.count += sibling->page.count;
+
+    leaf->next = sibling->next;
+    if (sibling->next)
+        sibling->next->prev = leaf;
+
+    inner_remove(parent, slot);
+    free(sibling);
+}
+
+static void inner_rebalance(struct bt_inner *parent, unsigned int slot)
+{
+    struct bt_inner *inner = page_inner(parent->child[slot]), *sibling;
+
+    if (slot && parent->child[slot - 1]->count > BT_MIN) {
+        sibling = page_inner(parent->child[slot - 1]);
+        inner_insert(inner, 0, parent->page.keys[slot - 1], inner->child[0]);
+        inner->child[0] = sibling->child[sibling->page.count];
+        parent->page.keys[slot - 1] = sibling->page.keys[sibling->page.count - 1];
+        sibling->page.keys[--sibling->page.count] = ULONG_MAX;
+        return;
+    }
+
+    if (slot < parent->page.count && parent->child[slot + 1]->count > BT_MIN) {
+        sibling = page_inner(parent->child[slot + 1]);
+        inner_insert(inner, inner->page.count, parent->page.keys[slot], sibling->child[0]);
+        parent->page.keys[slot] = sibling->page.keys[0];
+        sibling->child[0] = sibling->child[1];
+        inner_remove(sibling, 0);
+        return;
+    }
+
+    if (slot)
+        inner = page_inner(parent->child[--slot]);
+    sibling = page_inner(parent->child[slot + 1]);
+
+    inner->page.keys[inner->page.count] = parent->page.keys[slot];
+    memcpy(inner->page.keys + inner->page.count + 1, sibling->page.keys,
+           sizeof(*inner->page.keys) * sibling->page.count);
+    memcpy(inner->child + inner->page.count + 1, sibling->child,
+           sizeof(*inner->child) * (sibling->page.count + 1));
+    inner->page.count += sibling->page.count + 1;
+
+    inner_remove(parent, slot);
+    free(sibling);
+}
+
+/**
+ * bt_delete - delete a node from a btree.
+ * @root: btree root to delete from.
+ * @node: node to delete, linked into @root.
+ */
+BT_SIMD void bt_delete(struct bt_root *root, struct bt_node *node)
+{
+    struct bt_path path;
+    struct bt_inner *inner;
+    unsigned int level;
+
+    path_descend(root, node->key, false, &path);
+
+    /* step over the nodes with an equal key ahead of this one */
+    for (;;) {
+        if (path.index == path.leaf->page.count)
+            path_next_leaf(&path, root->height);
+        if (path.leaf->entry[path.index] == node)
+            break;
+        path.index++;
+    }
+
+    leaf_remove(path.leaf, path.index);
+
+    for (level = root->height; level--;) {
+        inner = path.inner[level];
+        if (inner->child[path.slot[level]]->count >= BT_MIN)
+            break;
+
+        if (level == root->height - 1)
+            leaf_rebalance(inner, path.slot[level]);
+        else
+            inner_rebalance(inner, path.slot[level]);
+    }
+
+    if (root->height && !root->node->count) {
+        inner = page_inner(root->node);
+        root->node = inner->child[0];
+        root->height--;
+        free(inner);
+    } else if (!root->height && !root->node->count) {
+        free(root->node);
+        root->node = NULL;
+    }
+}
+
+/**
+ * bt_find - find the first node with a key.
+ * @root: btree root to search.
+ * @key: key to match.
+ */
+BT_SIMD struct bt_node *bt_find(const struct bt_root *root, unsigned long key)
+{
+    struct bt_page *page = root->node;
+    struct bt_leaf *leaf;
+    unsigned int level, index;
+
+    if (!page)
+        return NULL;
+
+    for (level = root->height; level; --level)
+        page = page_inner(page)->child[page_rank(page, key, false)];
+
+    leaf = page_leaf(page);
+    index = page_rank(page, key, false);
+
+    /* every key of this leaf is less, the next one starts above */
+    if (index == page->count) {
+        if (!(leaf = leaf->next))
+            return NULL;
+        index = 0;
+    }
+
+    return leaf->page.keys[index] == key ? leaf->entry[index] : NULL;
+}
+
+/**
+ * bt_destroy - release every page of a btree.
+ * @root: btree root to release, left empty.
+ *
+ * The nodes themselves belong to the caller and are not touched.
+ */
+void bt_destroy(struct bt_root *root)
+{
+    if (root->node)
+        page_destroy(root->node, root->height);
+
+    root->node = NULL;
+    root->height = 0;
+}
+
+/**
+ * bt_iter_first - start an iteration at the first node.
+ * @iter: iterator to start.
+ * @root: btree root to iterate.
+ */
+struct bt_node *bt_iter_first(struct bt_iter *iter, const struct bt_root *root)
+{
+    struct bt_page *page = root->node;
+    unsigned int level;
+
+    iter->leaf = NULL;
+    if (!page)
+        return NULL;
+
+    for (level = root->height; level; --level)
+        page = page_inner(page)->child[0];
+
+    iter->leaf = page_leaf(page);
+    iter->slot = 0;
+
+    return iter->leaf->entry[0];
+}
+
+/**
+ * bt_iter_last - start an iteration at the last node.
+ * @iter: iterator to start.
+ * @root: btree root to iterate.
+ */
+struct bt_node *bt_iter_last(struct bt_iter *iter, const struct bt_root *root)
+{
+    struct bt_page *page = root->node;
+    unsigned int level;
+
+    iter->leaf = NULL;
+    if (!page)
+        return NULL;
+
+    for (level = root->height; level; --level)
+        page = page_inner(page)->child[page->count];
+
+    iter->leaf = page_leaf(page);
+    iter->slot = page->count - 1;
+
+    return iter->leaf->entry[iter->slot];
+}
+
+/**
+ * bt_iter_lower_bound - start an iteration at the first key not less than @key.
+ * @iter: iterator to start.
+ * @root: btree root to iterate.
+ * @key: key to match.
+ */
+BT_SIMD struct bt_node *bt_iter_lower_bound(struct bt_iter *iter, const struct bt_root *root, unsigned long key)
+{
+    struct bt_page *page = root->node;
+    unsigned int level;
+
+    iter->leaf = NULL;
+    if (!page)
+        return NULL;
+
+    for (level = root->height; level; --level)
+        page = page_inner(page)->child[page_rank(page, key, false)];
+
+    iter->leaf = page_leaf(page);
+    iter->slot = page_rank(page, key, false);
+
+    if (iter->slot == page->count) {
+        if (!(iter->leaf = iter->leaf->next))
+            return NULL;
+        iter->slot = 0;
+    }
+
+    return iter->leaf->entry[iter->slot];
+}
+
+/**
+ * bt_iter_next - move an iterator to the next node.
+ * @iter: iterator to move.
+ */
+struct bt_node *bt_iter_next(struct bt_iter *iter)
+{
+    if (!iter->leaf)
+        return NULL;
+
+    if (++iter->slot == iter->leaf->page.count) {
+        if (!(iter->leaf = iter->leaf->next))
+            return NULL;
+        iter->slot = 0;
+    }
+
+    return iter->leaf->entry[iter->slot];
+}
+
+/**
+ * bt_iter_prev - move an iterator to the previous node.
+ * @iter: iterator to move.
+ */
+struct bt_node *bt_iter_prev(struct bt_iter *iter)
+{
+    if (!iter->leaf)
+        return NULL;
+
+    if (!iter->slot--) {
+        if (!(iter->leaf = iter->leaf->prev))
+            return NULL;
+        iter->slot = iter->leaf->page.count - 1;
+    }
+
+    return iter->leaf->entry[iter->slot];
+}
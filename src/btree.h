@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _BTREE_H_
+#define _BTREE_H_
+
+#include "rbtree.h"
+
+/*
+ * Fat-node ordered container (B+tree) over unsigned long keys.
+ *
+ * Every page holds up to BT_ORDER keys in one 64-byte aligned array,
+ * so a lookup touches about log(n) / log(BT_ORDER) pages instead of
+ * log2(n) nodes. The keys of a page are ranked with vector compares
+ * over the whole array; unused slots hold ULONG_MAX and never rank.
+ *
+ * Entries stay intrusive: the container embeds a struct bt_node
+ * whose key is set before insertion and left alone while linked.
+ * Pages are allocated by the tree, so insertion can fail. Equal keys
+ * are allowed and kept in insertion order.
+ */
+
+#ifndef BT_ORDER
+# define BT_ORDER 16
+#endif
+
+#define BT_MAX_DEPTH 16
+
+struct bt_page;
+struct bt_leaf;
+
+struct bt_node {
+    unsigned long key;
+};
+
+struct bt_root {
+    struct bt_page *node;
+    unsigned int height;
+};
+
+struct bt_iter {
+    struct bt_leaf *leaf;
+    unsigned int slot;
+};
+
+#define BT_STATIC \
+    {NULL, 0}
+
+#define BT_INIT \
+    (struct bt_root) BT_STATIC
+
+#define BT_ROOT(name) \
+    struct bt_root name = BT_INIT
+
+#define BT_EMPTY_ROOT(root) \
+    ((root)->node == NULL)
+
+/**
+ * bt_entry - get the struct for this entry.
+ * @ptr: the &struct bt_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the bt_node within the struct.
+ */
+#define bt_entry(ptr, type, member) \
+    rb_entry(ptr, type, member)
+
+/**
+ * bt_entry_safe - get the struct for this entry or null.
+ * @ptr: the &struct bt_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the bt_node within the struct.
+ */
+#define bt_entry_safe(ptr, type, member) \
+    rb_entry_safe(ptr, type, member)
+
+extern int bt_insert(struct bt_root *root, struct bt_node *node);
+extern void bt_delete(struct bt_root *root, struct bt_node *node);
+extern struct bt_node *bt_find(const struct bt_root *root, unsigned long key);
+extern void bt_destroy(struct bt_root *root);
+
+/* Sequential iteration - the cursor is invalidated by insert and delete */
+extern struct bt_node *bt_iter_first(struct bt_iter *iter, const struct bt_root *root);
+extern struct bt_node *bt_iter_last(struct bt_iter *iter, const struct bt_root *root);
+extern struct bt_node *bt_iter_lower_bound(struct bt_iter *iter, const struct bt_root *root, unsigned long key);
+extern struct bt_node *bt_iter_next(struct bt_iter *iter);
+extern struct bt_node *bt_iter_prev(struct bt_iter *iter);
+
+/**
+ * bt_for_each - iterate over a btree.
+ * @pos: the &struct bt_node to use as a loop cursor.
+ * @iter: the &struct bt_iter holding the position.
+ * @root: the root for your btree.
+ */
+#define bt_for_each(pos, iter, root) \
+    for (pos = bt_iter_first(iter, root); pos; pos = bt_iter_next(iter))
+
+/**
+ * bt_for_each_reverse - iterate over a btree backwards.
+ * @pos: the &struct bt_node to use as a loop cursor.
+ * @iter: the &struct bt_iter holding the position.
+ * @root: the root for your btree.
+ */
+#define bt_for_each_reverse(pos, iter, root) \
+    for (pos = bt_iter_last(iter, root); pos; pos = bt_iter_prev(iter))
+
+/**
+ * bt_for_each_from - iterate over a btree from the first key not less than @key.
+ * @pos: the &struct bt_node to use as a loop cursor.
+ * @iter: the &struct bt_iter holding the position.
+ * @root: the root for your btree.
+ * @key: key to start from.
+ */
+#define bt_for_each_from(pos, iter, root, key) \
+    for (pos = bt_iter_lower_bound(iter, root, key); pos; pos = bt_iter_next(iter))
+
+/**
+ * bt_for_each_entry - iterate over btree of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @iter: the &struct bt_iter holding the position.
+ * @root: the root for your btree.
+ * @member: the name of the bt_node within the struct.
+ */
+#define bt_for_each_entry(pos, iter, root, member) \
+    for (pos = bt_entry_safe(bt_iter_first(iter, root), typeof(*pos), member); \
+         pos; pos = bt_entry_safe(bt_iter_next(iter), typeof(*pos), member))
+
+/**
+ * bt_for_each_entry_reverse - iterate backwards over btree of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @iter: the &struct bt_iter holding the position.
+ * @root: the root for your btree.
+ * @member: the name of the bt_node within the struct.
+ */
+#define bt_for_each_entry_reverse(pos, iter, root, member) \
+    for (pos = bt_entry_safe(bt_iter_last(iter, root), typeof(*pos), member); \
+         pos; pos = bt_entry_safe(bt_iter_prev(iter), typeof(*pos), member))
+
+/**
+ * bt_for_each_entry_from - iterate over btree of given type from the first key not less than @key.
+ * @pos: the type * to use as a loop cursor.
+ * @iter: the &struct bt_iter holding the position.
+ * @root: the root for your btree.
+ * @key: key to start from.
+ * @member: the name of the bt_node within the struct.
+ */
+#define bt_for_each_entry_from(pos, iter, root, key, member) \
+    for (pos = bt_entry_safe(bt_iter_lower_bound(iter, root, key), typeof(*pos), member); \
+         pos; pos = bt_entry_safe(bt_iter_next(iter), typeof(*pos), member))
+
+#endif  /* _BTREE_H_ */
@@ -0,0 +1,243 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <pthread.h>
+
+#define BUILD_MAX_LEVEL     6
+#define BUILD_MAX_TASKS     (1U << BUILD_MAX_LEVEL)
+#define BUILD_MIN_PARALLEL  4096
+
+struct build_task {
+    struct rb_node **nodes;
+    unsigned long count;
+    struct rb_node *parent;
+    struct rb_node **link;
+    unsigned int depth;
+};
+
+struct build_worker {
+    pthread_t thread;
+    struct build_task *tasks;
+    unsigned int index, step, ntasks;
+    unsigned int height;
+    const struct rb_callbacks *callbacks;
+};
+
+/**
+ * build_height - depth of the deepest level of a balanced tree.
+ * @count: number of nodes in the tree.
+ */
+static unsigned int build_height(unsigned long count)
+{
+    unsigned int height = 0;
+
+    while (height < sizeof(count) * CHAR_BIT - 1 &&
+           (2UL << height) <= count)
+        height++;
+
+    return height;
+}
+
+/**
+ * build_subtree - wire sorted nodes into a balanced subtree.
+ * @nodes: sorted nodes of the subtree.
+ * @count: number of nodes.
+ * @parent: parent of the subtree root.
+ * @depth: depth of the subtree root.
+ * @height: depth of the deepest level of the whole tree.
+ * @callbacks: augmented callback function, or NULL.
+ *
+ * Every level above @height is full, so painting the deepest
+ * level red and everything else black keeps the black height
+ * equal on all paths.
+ */
+static struct rb_node *
+build_subtree(struct rb_node **nodes, unsigned long count, struct rb_node *parent,
+              unsigned int depth, unsigned int height, const struct rb_callbacks *callbacks)
+{
+    struct rb_node *node;
+    unsigned long mid;
+
+    if (!count)
+        return NULL;
+
+    mid = count / 2;
+    node = nodes[mid];
+
+    node->parent = parent;
+    node->color = (depth && depth == height) ? RB_RED : RB_BLACK;
+    node->left = build_subtree(nodes, mid, node, depth + 1, height, callbacks);
+    node->right = build_subtree(nodes + mid + 1, count - mid - 1, node, depth + 1, height, callbacks);
+
+    /* children are complete, compute this node only */
+    if (callbacks)
+        callbacks->propagate(node, parent);
+
+    return node;
+}
+
+/**
+ * build_top - wire the top levels and collect the subtrees below them.
+ * @nodes: sorted nodes of the subtree.
+ * @count: number of nodes.
+ * @parent: parent of the subtree root.
+ * @link: pointer to the link to the subtree root.
+ * @depth: depth of the subtree root.
+ * @level: depth at which subtrees are handed over as tasks.
+ * @height: depth of the deepest level of the whole tree.
+ * @tasks: task array to fill.
+ * @ntasks: number of collected tasks.
+ * @tops: top nodes in postorder.
+ * @ntops: number of collected top nodes.
+ */
+static void
+build_top(struct rb_node **nodes, unsigned long count, struct rb_node *parent,
+          struct rb_node **link, unsigned int depth, unsigned int level, unsigned int height,
+          struct build_task *tasks, unsigned int *ntasks, struct rb_node **tops, unsigned int *ntops)
+{
+    struct rb_node *node;
+    unsigned long mid;
+
+    if (depth == level || !count) {
+        tasks[*ntasks].nodes = nodes;
+        tasks[*ntasks].count = count;
+        tasks[*ntasks].parent = parent;
+        tasks[*ntasks].link = link;
+        tasks[*ntasks].depth = depth;
+        (*ntasks)++;
+        return;
+    }
+
+    mid = count / 2;
+    node = nodes[mid];
+
+    node->parent = parent;
+    node->color = (depth && depth == height) ? RB_RED : RB_BLACK;
+    *link = node;
+
+    build_top(nodes, mid, node, &node->left, depth + 1,
+              level, height, tasks, ntasks, tops, ntops);
+    build_top(nodes + mid + 1, count - mid - 1, node, &node->right, depth + 1,
+              level, height, tasks, ntasks, tops, ntops);
+
+    tops[(*ntops)++] = node;
+}
+
+static void *build_worker(void *pdata)
+{
+    struct build_worker *worker = pdata;
+    struct build_task *task;
+    unsigned int count;
+
+    for (count = worker->index; count < worker->ntasks; count += worker->step) {
+        task = &worker->tasks[count];
+        *task->link = build_subtree(task->nodes, task->count, task->parent,
+                                    task->depth, worker->height, worker->callbacks);
+    }
+
+    return NULL;
+}
+
+/**
+ * rb_build_augmented - augmented build a balanced rbtree from sorted nodes.
+ * @root: empty rbtree root to build into.
+ * @nodes: nodes sorted in ascending order.
+ * @count: number of nodes.
+ * @callbacks: augmented callback function.
+ */
+void rb_build_augmented(struct rb_root *root, struct rb_node **nodes, unsigned long count,
+                        const struct rb_callbacks *callbacks)
+{
+    root->node = build_subtree(nodes, count, NULL, 0, build_height(count), callbacks);
+}
+
+/**
+ * rb_build - build a balanced rbtree from sorted nodes.
+ * @root: empty rbtree root to build into.
+ * @nodes: nodes sorted in ascending order.
+ * @count: number of nodes.
+ */
+void rb_build(struct rb_root *root, struct rb_node **nodes, unsigned long count)
+{
+    rb_build_augmented(root, nodes, count, NULL);
+}
+
+/**
+ * rb_parallel_build_augmented - augmented build a balanced rbtree with threads.
+ * @root: empty rbtree root to build into.
+ * @nodes: nodes sorted in ascending order.
+ * @count: number of nodes.
+ * @threads: number of threads to use, including the caller.
+ * @callbacks: augmented callback function.
+ *
+ * The caller wires the top levels, then each thread wires whole
+ * independent subtrees below them. The result is identical to
+ * rb_build_augmented(). If a thread cannot be created, its share
+ * of the work is done by the caller.
+ */
+void rb_parallel_build_augmented(struct rb_root *root, struct rb_node **nodes, unsigned long count,
+                                 unsigned int threads, const struct rb_callbacks *callbacks)
+{
+    struct build_worker workers[BUILD_MAX_TASKS];
+    struct build_task tasks[BUILD_MAX_TASKS];
+    struct rb_node *tops[BUILD_MAX_TASKS];
+    unsigned int level, height, ntasks, ntops, index;
+
+    if (threads <= 1 || count < BUILD_MIN_PARALLEL) {
+        rb_build_augmented(root, nodes, count, callbacks);
+        return;
+    }
+
+    if (threads > BUILD_MAX_TASKS)
+        threads = BUILD_MAX_TASKS;
+
+    for (level = 0; (1U << level) < threads; ++level);
+    height = build_height(count);
+    ntasks = ntops = 0;
+
+    build_top(nodes, count, NULL, &root->node, 0, level, height,
+              tasks, &ntasks, tops, &ntops);
+
+    for (index = 0; index < threads; ++index) {
+        workers[index].tasks = tasks;
+        workers[index].index = index;
+        workers[index].step = threads;
+        workers[index].ntasks = ntasks;
+        workers[index].height = height;
+        workers[index].callbacks = callbacks;
+    }
+
+    for (index = 1; index < threads; ++index) {
+        if (pthread_create(&workers[index].thread, NULL, build_worker, &workers[index]))
+            break;
+    }
+
+    /* run the remaining workers on the calling thread */
+    for (level = index; level < threads; ++level)
+        build_worker(&workers[level]);
+    build_worker(&workers[0]);
+
+    while (--index)
+        pthread_join(workers[index].thread, NULL);
+
+    if (callbacks) {
+        for (index = 0; index < ntops; ++index)
+            callbacks->propagate(tops[index], tops[index]->parent);
+    }
+}
+
+/**
+ * rb_parallel_build - build a balanced rbtree with threads.
+ * @root: empty rbtree root to build into.
+ * @nodes: nodes sorted in ascending order.
+ * @count: number of nodes.
+ * @threads: number of threads to use, including the caller.
+ */
+void rb_parallel_build(struct rb_root *root, struct rb_node **nodes, unsigned long count,
+                       unsigned int threads)
+{
+    rb_parallel_build_augmented(root, nodes, count, threads, NULL);
+}
@@ -20,18 +20,21 @@ bool rb_debug_link_check(struct rb_node *parent, struct rb_node **link, struct r
 bool rb_debug_delete_check(struct rb_node *node)
 {
     if (unlikely(node->left == POISON_RBNODE1)) {
+        rb_probe2(delete__corrupt, node, 1);
         fprintf(stderr, "rb_delete corruption (%p) node->left should not be POISON_RBNODE1 (%p)\n",
         node, POISON_RBNODE1);
         return false;
     }
 
     if (unlikely(node->right == POISON_RBNODE2)) {
+        rb_probe2(delete__corrupt, node, 2);
         fprintf(stderr, "rb_delete corruption (%p) node->right should not be POISON_RBNODE2 (%p)\n",
         node, POISON_RBNODE2);
         return false;
     }
 
     if (unlikely(node->parent == POISON_RBNODE3)) {
+        rb_probe2(delete__corrupt, node, 3);
         fprintf(stderr, "rb_delete corruption (%p) node->parent should not be POISON_RBNODE3 (%p)\n",
         node, POISON_RBNODE3);
         return false;
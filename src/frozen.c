@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "frozen.h"
+#include <stdlib.h>
+#include <errno.h>
+
+#define FROZEN_ALIGN 64
+
+/**
+ * eytzinger_first - first index of an in-order walk.
+ * @count: number of entries.
+ */
+static unsigned long eytzinger_first(unsigned long count)
+{
+    unsigned long index = 1;
+
+    while ((index << 1) <= count)
+        index <<= 1;
+
+    return index;
+}
+
+/**
+ * eytzinger_next - next index of an in-order walk.
+ * @index: current index.
+ * @count: number of entries.
+ */
+static unsigned long eytzinger_next(unsigned long index, unsigned long count)
+{
+    if ((index << 1 | 1) <= count) {
+        index = index << 1 | 1;
+        while ((index << 1) <= count)
+            index <<= 1;
+        return index;
+    }
+
+    /* climb while coming from a right child */
+    while (index & 1)
+        index >>= 1;
+
+    return index >> 1;
+}
+
+/**
+ * rb_freeze - export a tree into a frozen Eytzinger snapshot.
+ * @frozen: the snapshot to fill.
+ * @root: rbtree to export.
+ * @key: returns the search key of a node, ascending in tree order.
+ *
+ * Returns -ENOMEM if the arrays cannot be allocated.
+ */
+int rb_freeze(struct rb_frozen *frozen, const struct rb_root *root, rb_key_t key)
+{
+    unsigned long count = 0, index, size;
+    struct rb_node *node;
+
+    rb_for_each(node, root)
+        count++;
+
+    /* entry zero is the "not found" sentinel */
+    size = ((count + 1) * sizeof(*frozen->keys) + FROZEN_ALIGN - 1) & ~(FROZEN_ALIGN - 1UL);
+    frozen->keys = aligned_alloc(FROZEN_ALIGN, size);
+    frozen->nodes = malloc((count + 1) * sizeof(*frozen->nodes));
+    if (!frozen->keys || !frozen->nodes) {
+        free(frozen->keys);
+        free(frozen->nodes);
+        return -ENOMEM;
+    }
+
+    frozen->count = count;
+    frozen->keys[0] = 0;
+    frozen->nodes[0] = NULL;
+
+    index = eytzinger_first(count);
+    rb_for_each(node, root) {
+        frozen->keys[index] = key(node);
+        frozen->nodes[index] = node;
+        index = eytzinger_next(index, count);
+    }
+
+    return 0;
+}
+
+/**
+ * rb_frozen_destroy - release a frozen snapshot.
+ * @frozen: the snapshot to release.
+ */
+void rb_frozen_destroy(struct rb_frozen *frozen)
+{
+    free(frozen->keys);
+    free(frozen->nodes);
+    frozen->keys = NULL;
+    frozen->nodes = NULL;
+    frozen->count = 0;
+}
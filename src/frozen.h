@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _FROZEN_H_
+#define _FROZEN_H_
+
+#include "rbtree.h"
+
+/*
+ * Frozen read-only snapshot of an rbtree.
+ *
+ * The in-order keys are stored in Eytzinger (breadth-first) order,
+ * next to a back-pointer to the node each key came from. A search
+ * descends the implicit tree without branches on the comparison
+ * result and prefetches the cache line holding the descendants
+ * RB_FROZEN_PREFETCH levels ahead.
+ *
+ * The snapshot does not follow later changes to the tree, and its
+ * nodes must stay alive as long as it is used.
+ */
+
+#ifndef RB_FROZEN_PREFETCH
+# define RB_FROZEN_PREFETCH 3
+#endif
+
+struct rb_frozen {
+    unsigned long *keys;
+    struct rb_node **nodes;
+    unsigned long count;
+};
+
+typedef unsigned long (*rb_key_t)(const struct rb_node *node);
+
+extern int rb_freeze(struct rb_frozen *frozen, const struct rb_root *root, rb_key_t key);
+extern void rb_frozen_destroy(struct rb_frozen *frozen);
+
+/**
+ * rb_frozen_lower - index of the first key not less than @key.
+ * @frozen: the frozen snapshot to search.
+ * @key: key to match.
+ *
+ * Returns zero if every key is less than @key.
+ */
+static inline unsigned long rb_frozen_lower(const struct rb_frozen *frozen, unsigned long key)
+{
+    unsigned long index = 1;
+
+    while (index <= frozen->count) {
+        __builtin_prefetch(frozen->keys + (index << RB_FROZEN_PREFETCH));
+        index = (index << 1) + (frozen->keys[index] < key);
+    }
+
+    /* undo the right turns taken after the last left turn */
+    return index >> __builtin_ffsl(~index);
+}
+
+/**
+ * rb_frozen_upper - index of the first key greater than @key.
+ * @frozen: the frozen snapshot to search.
+ * @key: key to match.
+ *
+ * Returns zero if no key is greater than @key.
+ */
+static inline unsigned long rb_frozen_upper(const struct rb_frozen *frozen, unsigned long key)
+{
+    unsigned long index = 1;
+
+    while (index <= frozen->count) {
+        __builtin_prefetch(frozen->keys + (index << RB_FROZEN_PREFETCH));
+        index = (index << 1) + (frozen->keys[index] <= key);
+    }
+
+    return index >> __builtin_ffsl(~index);
+}
+
+/**
+ * rb_frozen_lower_bound - find the first node whose key is not less than @key.
+ * @frozen: the frozen snapshot to search.
+ * @key: key to match.
+ */
+static inline struct rb_node *rb_frozen_lower_bound(const struct rb_frozen *frozen, unsigned long key)
+{
+    return frozen->nodes[rb_frozen_lower(frozen, key)];
+}
+
+/**
+ * rb_frozen_upper_bound - find the first node whose key is greater than @key.
+ * @frozen: the frozen snapshot to search.
+ * @key: key to match.
+ */
+static inline struct rb_node *rb_frozen_upper_bound(const struct rb_frozen *frozen, unsigned long key)
+{
+    return frozen->nodes[rb_frozen_upper(frozen, key)];
+}
+
+/**
+ * rb_frozen_find - find the first node whose key equals @key.
+ * @frozen: the frozen snapshot to search.
+ * @key: key to match.
+ */
+static inline struct rb_node *rb_frozen_find(const struct rb_frozen *frozen, unsigned long key)
+{
+    unsigned long index = rb_frozen_lower(frozen, key);
+    return frozen->keys[index] == key ? frozen->nodes[index] : NULL;
+}
+
+#endif  /* _FROZEN_H_ */
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "ingest.h"
+#include <stdlib.h>
+#include <errno.h>
+
+/**
+ * ingest_sort - stable bottom-up merge sort of a node array.
+ * @nodes: nodes to sort.
+ * @tmp: scratch array of the same length.
+ * @count: number of nodes.
+ * @cmp: operator defining the node order.
+ *
+ * Returns the array holding the sorted result. Stability keeps
+ * equal nodes in queue order, as sequential rb_insert() would.
+ */
+static struct rb_node **
+ingest_sort(struct rb_node **nodes, struct rb_node **tmp,
+            unsigned int count, rb_cmp_t cmp)
+{
+    struct rb_node **src = nodes, **dst = tmp, **swap;
+    unsigned int width, left, mid, right, a, b, index;
+
+    for (width = 1; width < count; width <<= 1) {
+        for (left = 0; left < count; left += width << 1) {
+            mid = left + width < count ? left + width : count;
+            right = mid + width < count ? mid + width : count;
+
+            a = left;
+            b = mid;
+            for (index = left; index < right; ++index) {
+                if (a < mid && (b >= right || cmp(src[b], src[a]) >= 0))
+                    dst[index] = src[a++];
+                else
+                    dst[index] = src[b++];
+            }
+        }
+
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    return src;
+}
+
+/**
+ * rb_ingest_init - initialize a shared ingest tree.
+ * @ingest: the ingest tree to initialize.
+ * @cmp: operator defining the node order.
+ */
+int rb_ingest_init(struct rb_ingest *ingest, rb_cmp_t cmp)
+{
+    ingest->cached = RB_CACHED_INIT;
+    ingest->cmp = cmp;
+    return -pthread_mutex_init(&ingest->lock, NULL);
+}
+
+/**
+ * rb_ingest_destroy - release a shared ingest tree.
+ * @ingest: the ingest tree to release.
+ */
+void rb_ingest_destroy(struct rb_ingest *ingest)
+{
+    pthread_mutex_destroy(&ingest->lock);
+}
+
+/**
+ * rb_ingest_buffer_init - initialize a producer local buffer.
+ * @buffer: the buffer to initialize.
+ * @ingest: the shared tree flushed into.
+ * @capacity: number of nodes queued before an automatic flush.
+ */
+int rb_ingest_buffer_init(struct rb_ingest_buffer *buffer, struct rb_ingest *ingest,
+                          unsigned int capacity)
+{
+    if (!capacity)
+        return -EINVAL;
+
+    buffer->nodes = malloc(sizeof(*buffer->nodes) * capacity * 2);
+    if (!buffer->nodes)
+        return -ENOMEM;
+
+    buffer->sort = buffer->nodes + capacity;
+    buffer->ingest = ingest;
+    buffer->capacity = capacity;
+    buffer->count = 0;
+
+    return 0;
+}
+
+/**
+ * rb_ingest_buffer_destroy - flush and release a producer local buffer.
+ * @buffer: the buffer to release.
+ */
+void rb_ingest_buffer_destroy(struct rb_ingest_buffer *buffer)
+{
+    rb_ingest_flush(buffer);
+    free(buffer->nodes);
+    buffer->nodes = NULL;
+}
+
+/**
+ * rb_ingest_flush - merge queued nodes into the shared tree.
+ * @buffer: producer local buffer.
+ */
+void rb_ingest_flush(struct rb_ingest_buffer *buffer)
+{
+    struct rb_ingest *ingest = buffer->ingest;
+    struct rb_node **nodes, *hint = NULL;
+    unsigned int count;
+
+    if (!buffer->count)
+        return;
+
+    nodes = ingest_sort(buffer->nodes, buffer->sort, buffer->count, ingest->cmp);
+
+    pthread_mutex_lock(&ingest->lock);
+    for (count = 0; count < buffer->count; ++count) {
+        rb_cached_insert_hint(&ingest->cached, nodes[count], hint, ingest->cmp);
+        hint = nodes[count];
+    }
+    pthread_mutex_unlock(&ingest->lock);
+
+    buffer->count = 0;
+}
+
+/**
+ * rb_ingest_find - find @key in the shared tree.
+ * @ingest: the shared tree.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ */
+struct rb_node *rb_ingest_find(struct rb_ingest *ingest, const void *key, rb_find_t cmp)
+{
+    struct rb_node *node;
+
+    pthread_mutex_lock(&ingest->lock);
+    node = rb_cached_find(&ingest->cached, key, cmp);
+    pthread_mutex_unlock(&ingest->lock);
+
+    return node;
+}
+
+/**
+ * rb_ingest_buffer_find - find @key with read-your-writes semantics.
+ * @buffer: producer local buffer, searched before the shared tree.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ */
+struct rb_node *rb_ingest_buffer_find(struct rb_ingest_buffer *buffer, const void *key, rb_find_t cmp)
+{
+    unsigned int count;
+
+    for (count = buffer->count; count--;) {
+        if (!cmp(buffer->nodes[count], key))
+            return buffer->nodes[count];
+    }
+
+    return rb_ingest_find(buffer->ingest, key, cmp);
+}
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+#include "rbtree.h"
+#include <pthread.h>
+
+/*
+ * Buffered ingest front end for a shared cached rbtree.
+ *
+ * Each producer thread appends nodes to its own buffer without
+ * locking. A flush sorts the buffer outside the lock, then merges
+ * it into the shared tree in one locked pass, inserting each node
+ * from the position of the previous one.
+ */
+
+struct rb_ingest {
+    pthread_mutex_t lock;
+    struct rb_root_cached cached;
+    rb_cmp_t cmp;
+};
+
+struct rb_ingest_buffer {
+    struct rb_ingest *ingest;
+    struct rb_node **nodes;
+    struct rb_node **sort;
+    unsigned int count;
+    unsigned int capacity;
+};
+
+extern int rb_ingest_init(struct rb_ingest *ingest, rb_cmp_t cmp);
+extern void rb_ingest_destroy(struct rb_ingest *ingest);
+extern int rb_ingest_buffer_init(struct rb_ingest_buffer *buffer, struct rb_ingest *ingest, unsigned int capacity);
+extern void rb_ingest_buffer_destroy(struct rb_ingest_buffer *buffer);
+extern void rb_ingest_flush(struct rb_ingest_buffer *buffer);
+extern struct rb_node *rb_ingest_find(struct rb_ingest *ingest, const void *key, rb_find_t cmp);
+extern struct rb_node *rb_ingest_buffer_find(struct rb_ingest_buffer *buffer, const void *key, rb_find_t cmp);
+
+/**
+ * rb_ingest_add - queue node for insertion into the shared tree.
+ * @buffer: producer local buffer.
+ * @node: new node to insert.
+ */
+static inline void rb_ingest_add(struct rb_ingest_buffer *buffer, struct rb_node *node)
+{
+    buffer->nodes[buffer->count++] = node;
+    if (unlikely(buffer->count == buffer->capacity))
+        rb_ingest_flush(buffer);
+}
+
+#endif  /* _INGEST_H_ */
@@ -0,0 +1,464 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "persist.h"
+
+static __always_inline void
+node_get(struct rbp_node *node)
+{
+    if (node)
+        __atomic_add_fetch(&node->refcount, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * node_put - drop a reference and free the node once unreachable.
+ * @node: node to release.
+ * @ops: allocator callbacks.
+ * @pdata: allocator private data.
+ */
+static void node_put(struct rbp_node *node, const struct rbp_ops *ops, void *pdata)
+{
+    struct rbp_node *left, *right;
+
+    while (node && !__atomic_sub_fetch(&node->refcount, 1, __ATOMIC_ACQ_REL)) {
+        left = node->left;
+        right = node->right;
+        ops->release(node, pdata);
+
+        /* recurse on one side, loop on the other */
+        node_put(left, ops, pdata);
+        node = right;
+    }
+}
+
+/**
+ * node_own - make the node behind @link private to the current version.
+ * @link: link inside a private node (or the root) to the node.
+ * @ops: allocator callbacks.
+ * @pdata: allocator private data.
+ *
+ * A node referenced once through a private link cannot be reached
+ * from any other version, so it is modified in place. Otherwise it
+ * is copied and the link is redirected to the copy.
+ */
+static struct rbp_node *
+node_own(struct rbp_node **link, const struct rbp_ops *ops, void *pdata)
+{
+    struct rbp_node *node = *link, *copy;
+
+    if (!node || __atomic_load_n(&node->refcount, __ATOMIC_ACQUIRE) == 1)
+        return node;
+
+    copy = ops->clone(node, pdata);
+    copy->left = node->left;
+    copy->right = node->right;
+    copy->color = node->color;
+    copy->refcount = 1;
+
+    node_get(copy->left);
+    node_get(copy->right);
+    *link = copy;
+
+    node_put(node, ops, pdata);
+    return copy;
+}
+
+/**
+ * child_change - replace old child by new one.
+ * @root: version root of node.
+ * @parent: parent to change child, or NULL for the root.
+ * @old: node to be replaced.
+ * @new: new node to insert.
+ */
+static __always_inline void
+child_change(struct rbp_root *root, struct rbp_node *parent,
+             struct rbp_node *old, struct rbp_node *new)
+{
+    if (!parent)
+        root->node = new;
+    else if (parent->left == old)
+        parent->left = new;
+    else
+        parent->right = new;
+}
+
+/**
+ * rbp_insert - insert node into a new version.
+ * @root: version to update, replaced by the new version.
+ * @node: new node to insert, owned by the tree afterwards.
+ * @cmp: operator defining the node order.
+ * @ops: allocator callbacks.
+ * @pdata: allocator private data.
+ */
+void rbp_insert(struct rbp_root *root, struct rbp_node *node, rbp_cmp_t cmp,
+                const struct rbp_ops *ops, void *pdata)
+{
+    struct rbp_node *stack[RBP_MAX_DEPTH];
+    struct rbp_node *parent, *gparent, *tmp, **link;
+    unsigned int depth = 0;
+
+    /* descend and make the path private */
+    link = &root->node;
+    while (node_own(link, ops, pdata)) {
+        parent = stack[depth++] = *link;
+        if (cmp(node, parent) < 0)
+            link = &parent->left;
+        else
+            link = &parent->right;
+    }
+
+    node->left = node->right = NULL;
+    node->color = RB_RED;
+    node->refcount = 1;
+    *link = node;
+
+    while (depth) {
+        parent = stack[depth - 1];
+        if (parent->color == RB_BLACK)
+            return;
+
+        /* a red parent is never the root */
+        gparent = stack[depth - 2];
+
+        if (parent == gparent->left) {
+            tmp = gparent->right;
+
+            /* Case 1 - node's uncle is red (color flips) */
+            if (tmp && tmp->color == RB_RED) {
+                tmp = node_own(&gparent->right, ops, pdata);
+                parent->color = tmp->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                depth -= 2;
+                continue;
+            }
+
+            /* Case 2 - left rotate at parent */
+            if (node == parent->right) {
+                parent->right = node->left;
+                node->left = parent;
+                gparent->left = node;
+                parent = node;
+            }
+
+            /* Case 3 - right rotate at gparent */
+            gparent->left = parent->right;
+            parent->right = gparent;
+        } else {
+            tmp = gparent->left;
+
+            /* Case 1 - color flips */
+            if (tmp && tmp->color == RB_RED) {
+                tmp = node_own(&gparent->left, ops, pdata);
+                parent->color = tmp->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                depth -= 2;
+                continue;
+            }
+
+            /* Case 2 - right rotate at parent */
+            if (node == parent->left) {
+                parent->left = node->right;
+                node->right = parent;
+                gparent->right = node;
+                parent = node;
+            }
+
+            /* Case 3 - left rotate at gparent */
+            gparent->right = parent->left;
+            parent->left = gparent;
+        }
+
+        parent->color = RB_BLACK;
+        gparent->color = RB_RED;
+        child_change(root, depth > 2 ? stack[depth - 3] : NULL, gparent, parent);
+        return;
+    }
+
+    node->color = RB_BLACK;
+}
+
+/**
+ * erase_fixup - balance a private path after removing a black node.
+ * @root: version root.
+ * @stack: private path from the root to @parent.
+ * @depth: number of nodes on the path.
+ * @node: black or NULL child of the last node missing one black.
+ * @ops: allocator callbacks.
+ * @pdata: allocator private data.
+ */
+static void erase_fixup(struct rbp_root *root, struct rbp_node **stack, unsigned int depth,
+                        struct rbp_node *node, const struct rbp_ops *ops, void *pdata)
+{
+    struct rbp_node *parent, *sibling, *tmp1, *tmp2;
+
+    while (depth) {
+        parent = stack[depth - 1];
+
+        if (node != parent->right) {
+            sibling = node_own(&parent->right, ops, pdata);
+
+            /* Case 1 - left rotate at parent */
+            if (sibling->color == RB_RED) {
+                parent->right = sibling->left;
+                sibling->left = parent;
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                child_change(root, depth > 1 ? stack[depth - 2] : NULL, parent, sibling);
+                stack[depth - 1] = sibling;
+                stack[depth++] = parent;
+                sibling = node_own(&parent->right, ops, pdata);
+            }
+
+            tmp2 = sibling->right;
+            if (!tmp2 || tmp2->color == RB_BLACK) {
+                tmp1 = sibling->left;
+
+                /* Case 2 - sibling color flip */
+                if (!tmp1 || tmp1->color == RB_BLACK) {
+                    sibling->color = RB_RED;
+                    if (parent->color == RB_RED) {
+                        parent->color = RB_BLACK;
+                        return;
+                    }
+                    node = parent;
+                    depth--;
+                    continue;
+                }
+
+                /* Case 3 - right rotate at sibling */
+                tmp1 = node_own(&sibling->left, ops, pdata);
+                sibling->left = tmp1->right;
+                tmp1->right = sibling;
+                tmp1->color = RB_BLACK;
+                sibling->color = RB_RED;
+                parent->right = tmp1;
+                sibling = tmp1;
+            }
+
+            /* Case 4 - left rotate at parent + color flips */
+            tmp2 = node_own(&sibling->right, ops, pdata);
+            parent->right = sibling->left;
+            sibling->left = parent;
+        } else {
+            sibling = node_own(&parent->left, ops, pdata);
+
+            /* Case 1 - right rotate at parent */
+            if (sibling->color == RB_RED) {
+                parent->left = sibling->right;
+                sibling->right = parent;
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                child_change(root, depth > 1 ? stack[depth - 2] : NULL, parent, sibling);
+                stack[depth - 1] = sibling;
+                stack[depth++] = parent;
+                sibling = node_own(&parent->left, ops, pdata);
+            }
+
+            tmp1 = sibling->left;
+            if (!tmp1 || tmp1->color == RB_BLACK) {
+                tmp2 = sibling->right;
+
+                /* Case 2 - sibling color flip */
+                if (!tmp2 || tmp2->color == RB_BLACK) {
+                    sibling->color = RB_RED;
+                    if (parent->color == RB_RED) {
+                        parent->color = RB_BLACK;
+                        return;
+                    }
+                    node = parent;
+                    depth--;
+                    continue;
+                }
+
+                /* Case 3 - left rotate at sibling */
+                tmp2 = node_own(&sibling->right, ops, pdata);
+                sibling->right = tmp2->left;
+                tmp2->left = sibling;
+                tmp2->color = RB_BLACK;
+                sibling->color = RB_RED;
+                parent->left = tmp2;
+                sibling = tmp2;
+            }
+
+            /* Case 4 - right rotate at parent + color flips */
+            tmp2 = node_own(&sibling->left, ops, pdata);
+            parent->left = sibling->right;
+            sibling->right = parent;
+        }
+
+        sibling->color = parent->color;
+        parent->color = RB_BLACK;
+        tmp2->color = RB_BLACK;
+        child_change(root, depth > 1 ? stack[depth - 2] : NULL, parent, sibling);
+        return;
+    }
+}
+
+/**
+ * rbp_delete - remove the node matching @key from a new version.
+ * @root: version to update, replaced by the new version.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ * @ops: allocator callbacks.
+ * @pdata: allocator private data.
+ *
+ * Returns true if a node was removed.
+ */
+bool rbp_delete(struct rbp_root *root, const void *key, rbp_find_t cmp,
+                const struct rbp_ops *ops, void *pdata)
+{
+    struct rbp_node *stack[RBP_MAX_DEPTH];
+    struct rbp_node *node, *parent, *successor, *child, **link;
+    unsigned int depth = 0, index;
+    bool color;
+    long ret;
+
+    /* only copy the path once the key is known to exist */
+    if (!rbp_find(root, key, cmp))
+        return false;
+
+    link = &root->node;
+    for (;;) {
+        node = stack[depth++] = node_own(link, ops, pdata);
+        ret = cmp(node, key);
+        if (ret < 0)
+            link = &node->left;
+        else if (ret > 0)
+            link = &node->right;
+        else
+            break;
+    }
+
+    index = depth - 1;
+    parent = index ? stack[index - 1] : NULL;
+
+    if (!node->left || !node->right) {
+        child = node->left ? node->left : node->right;
+        child_change(root, parent, node, child);
+        color = node->color;
+        depth = index;
+    } else {
+        /* make the path to the successor private */
+        successor = node_own(&node->right, ops, pdata);
+        stack[depth++] = successor;
+        while (successor->left) {
+            successor = node_own(&successor->left, ops, pdata);
+            stack[depth++] = successor;
+        }
+
+        child = successor->right;
+        color = successor->color;
+
+        if (stack[depth - 2] != node) {
+            stack[depth - 2]->left = child;
+            successor->right = node->right;
+        }
+
+        successor->left = node->left;
+        successor->color = node->color;
+        child_change(root, parent, node, successor);
+
+        /* successor takes the place of node on the path */
+        stack[index] = successor;
+        depth--;
+    }
+
+    node->left = node->right = NULL;
+    node_put(node, ops, pdata);
+
+    if (color == RB_RED)
+        return true;
+
+    if (child && child->color == RB_RED) {
+        child = node_own(depth ? (stack[depth - 1]->left == child ?
+                         &stack[depth - 1]->left : &stack[depth - 1]->right) :
+                         &root->node, ops, pdata);
+        child->color = RB_BLACK;
+        return true;
+    }
+
+    erase_fixup(root, stack, depth, child, ops, pdata);
+    return true;
+}
+
+/**
+ * rbp_find - find @key in version @root.
+ * @root: version want to search.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ */
+struct rbp_node *rbp_find(const struct rbp_root *root, const void *key, rbp_find_t cmp)
+{
+    struct rbp_node *node = root->node;
+    long ret;
+
+    while (node) {
+        ret = cmp(node, key);
+        if (ret < 0)
+            node = node->left;
+        else if (ret > 0)
+            node = node->right;
+        else
+            return node;
+    }
+
+    return NULL;
+}
+
+/**
+ * rbp_snapshot - take an O(1) snapshot of a version.
+ * @root: version to take.
+ * @snapshot: root receiving the snapshot.
+ */
+void rbp_snapshot(const struct rbp_root *root, struct rbp_root *snapshot)
+{
+    snapshot->node = root->node;
+    node_get(snapshot->node);
+}
+
+/**
+ * rbp_release - drop a version and free nodes no other version reaches.
+ * @root: version to release.
+ * @ops: allocator callbacks.
+ * @pdata: allocator private data.
+ */
+void rbp_release(struct rbp_root *root, const struct rbp_ops *ops, void *pdata)
+{
+    node_put(root->node, ops, pdata);
+    root->node = NULL;
+}
+
+static struct rbp_node *iter_push_left(struct rbp_iter *iter, struct rbp_node *node)
+{
+    while (node) {
+        iter->stack[iter->depth++] = node;
+        node = node->left;
+    }
+
+    return iter->depth ? iter->stack[iter->depth - 1] : NULL;
+}
+
+/**
+ * rbp_iter_first/next - Middle iteration (Sequential)
+ * NOTE: the iterator keeps the path on an explicit stack.
+ */
+struct rbp_node *rbp_iter_first(struct rbp_iter *iter, const struct rbp_root *root)
+{
+    iter->depth = 0;
+    return iter_push_left(iter, root->node);
+}
+
+struct rbp_node *rbp_iter_next(struct rbp_iter *iter)
+{
+    struct rbp_node *node;
+
+    if (!iter->depth)
+        return NULL;
+
+    node = iter->stack[--iter->depth];
+    return iter_push_left(iter, node->right);
+}
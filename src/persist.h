@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _PERSIST_H_
+#define _PERSIST_H_
+
+#include "rbtree.h"
+
+/*
+ * Persistent (path-copying) rbtree.
+ *
+ * Nodes are shared between versions, so they carry a reference
+ * count instead of a parent pointer. An update copies only the
+ * nodes it has to modify that are still reachable from another
+ * version; nodes owned by a single version are modified in place.
+ * Taking a snapshot only takes a reference to the root.
+ *
+ * Updates and snapshot acquisition on one root must be serialized
+ * by the caller. Reading and releasing a snapshot needs no locking.
+ */
+
+#define RBP_MAX_DEPTH (sizeof(long) * CHAR_BIT * 2)
+
+struct rbp_node {
+    struct rbp_node *left;
+    struct rbp_node *right;
+    unsigned long refcount;
+    bool color;
+};
+
+struct rbp_root {
+    struct rbp_node *node;
+};
+
+/**
+ * struct rbp_ops - node allocator callbacks.
+ * @clone: allocate a copy of the container of @node, never fails.
+ *         Links, color and reference count are set by the caller.
+ * @release: free the container of an unreachable node.
+ */
+struct rbp_ops {
+    struct rbp_node *(*clone)(const struct rbp_node *node, void *pdata);
+    void (*release)(struct rbp_node *node, void *pdata);
+};
+
+struct rbp_iter {
+    struct rbp_node *stack[RBP_MAX_DEPTH];
+    unsigned int depth;
+};
+
+#define RBP_STATIC \
+    {NULL}
+
+#define RBP_INIT \
+    (struct rbp_root) RBP_STATIC
+
+#define RBP_ROOT(name) \
+    struct rbp_root name = RBP_INIT
+
+#define RBP_EMPTY_ROOT(root) \
+    ((root)->node == NULL)
+
+/**
+ * rbp_entry - get the struct for this entry.
+ * @ptr: the &struct rbp_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbp_node within the struct.
+ */
+#define rbp_entry(ptr, type, member) \
+    rb_entry(ptr, type, member)
+
+/**
+ * rbp_entry_safe - get the struct for this entry or null.
+ * @ptr: the &struct rbp_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbp_node within the struct.
+ */
+#define rbp_entry_safe(ptr, type, member) \
+    rb_entry_safe(ptr, type, member)
+
+typedef long (*rbp_find_t)(const struct rbp_node *node, const void *key);
+typedef long (*rbp_cmp_t)(const struct rbp_node *nodea, const struct rbp_node *nodeb);
+
+extern void rbp_insert(struct rbp_root *root, struct rbp_node *node, rbp_cmp_t cmp, const struct rbp_ops *ops, void *pdata);
+extern bool rbp_delete(struct rbp_root *root, const void *key, rbp_find_t cmp, const struct rbp_ops *ops, void *pdata);
+extern struct rbp_node *rbp_find(const struct rbp_root *root, const void *key, rbp_find_t cmp);
+extern void rbp_snapshot(const struct rbp_root *root, struct rbp_root *snapshot);
+extern void rbp_release(struct rbp_root *root, const struct rbp_ops *ops, void *pdata);
+
+extern struct rbp_node *rbp_iter_first(struct rbp_iter *iter, const struct rbp_root *root);
+extern struct rbp_node *rbp_iter_next(struct rbp_iter *iter);
+
+/**
+ * rbp_for_each - iterate over a persistent rbtree version.
+ * @pos: the &struct rbp_node to use as a loop cursor.
+ * @iter: the &struct rbp_iter holding the iteration stack.
+ * @root: the version to iterate.
+ */
+#define rbp_for_each(pos, iter, root) \
+    for (pos = rbp_iter_first(iter, root); pos; pos = rbp_iter_next(iter))
+
+/**
+ * rbp_for_each_entry - iterate over a persistent rbtree version of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @iter: the &struct rbp_iter holding the iteration stack.
+ * @root: the version to iterate.
+ * @member: the name of the rbp_node within the struct.
+ */
+#define rbp_for_each_entry(pos, iter, root, member) \
+    for (pos = rbp_entry_safe(rbp_iter_first(iter, root), typeof(*pos), member); \
+         pos; pos = rbp_entry_safe(rbp_iter_next(iter), typeof(*pos), member))
+
+#endif  /* _PERSIST_H_ */
@@ -0,0 +1,346 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "pool.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#define POOL_SLAB_SIZE      (256UL << 10)
+#define POOL_HUGE_SIZE      (2UL << 20)
+
+struct rb_pool_slab {
+    struct rb_pool_slab *next;
+    size_t size;
+};
+
+struct rb_pool_cache {
+    struct rb_pool_cache *next, **pprev;
+    struct rb_pool *pool;
+    void *free;
+    unsigned int count;
+};
+
+#define object_next(object) \
+    (*(void **)(object))
+
+/**
+ * slab_map - map a new slab.
+ * @pool: the pool to map for.
+ *
+ * With RB_POOL_HUGEPAGE, explicit huge pages are tried first and
+ * transparent huge pages are requested if none are reserved. THP
+ * only backs huge page aligned ranges, so that mapping is made one
+ * huge page larger and trimmed to an aligned slab.
+ */
+static struct rb_pool_slab *slab_map(struct rb_pool *pool)
+{
+    struct rb_pool_slab *slab = MAP_FAILED;
+    size_t size = pool->slab_size, head, tail;
+    void *base;
+
+#ifdef MAP_HUGETLB
+    if (pool->flags & RB_POOL_HUGEPAGE)
+        slab = mmap(NULL, pool->slab_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if (slab == MAP_FAILED) {
+        if (pool->flags & RB_POOL_HUGEPAGE)
+            size += POOL_HUGE_SIZE;
+
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return NULL;
+
+        slab = base;
+        if (pool->flags & RB_POOL_HUGEPAGE) {
+            slab = (void *)(((uintptr_t)base + POOL_HUGE_SIZE - 1) & ~(POOL_HUGE_SIZE - 1));
+            head = (uintptr_t)slab - (uintptr_t)base;
+            tail = size - head - pool->slab_size;
+            if (head)
+                munmap(base, head);
+            if (tail)
+                munmap((char *)slab + pool->slab_size, tail);
+#ifdef MADV_HUGEPAGE
+            madvise(slab, pool->slab_size, MADV_HUGEPAGE);
+#endif
+        }
+    }
+
+    slab->size = pool->slab_size;
+    return slab;
+}
+
+/**
+ * pool_refill - take up to a batch of objects from the shared pool.
+ * @pool: the pool to take from.
+ * @cache: the thread cache to fill.
+ *
+ * Returns -ENOMEM if no object could be taken.
+ */
+static int pool_refill(struct rb_pool *pool, struct rb_pool_cache *cache)
+{
+    struct rb_pool_slab *slab;
+    bool carving = false;
+    void *object;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (cache->count < RB_POOL_BATCH) {
+        if (pool->free) {
+            object = pool->free;
+            pool->free = object_next(object);
+        } else if (cache->count && !carving) {
+            /* recycled objects first, they are likely still cached */
+            break;
+        } else {
+            /* carve lazily, untouched pages of a slab stay unbacked */
+            carving = true;
+            if ((size_t)(pool->end - pool->carve) < pool->size) {
+                if (cache->count || !(slab = slab_map(pool)))
+                    break;
+                slab->next = pool->slabs;
+                pool->slabs = slab;
+                pool->carve = (char *)(slab + 1);
+                pool->end = (char *)slab + slab->size;
+            }
+            object = pool->carve;
+            pool->carve += pool->size;
+        }
+
+        object_next(object) = cache->free;
+        cache->free = object;
+        cache->count++;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return cache->count ? 0 : -ENOMEM;
+}
+
+/**
+ * pool_drain - return objects of a thread cache to the shared pool.
+ * @pool: the pool to return to.
+ * @cache: the thread cache to drain.
+ * @keep: number of objects to keep in the cache.
+ */
+static void pool_drain(struct rb_pool *pool, struct rb_pool_cache *cache, unsigned int keep)
+{
+    void *first, *last;
+
+    if (cache->count <= keep)
+        return;
+
+    first = last = cache->free;
+    while (--cache->count > keep)
+        last = object_next(last);
+
+    cache->free = object_next(last);
+
+    pthread_mutex_lock(&pool->lock);
+    object_next(last) = pool->free;
+    pool->free = first;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * cache_release - return a thread cache when its thread exits.
+ * @pdata: the thread cache.
+ */
+static void cache_release(void *pdata)
+{
+    struct rb_pool_cache *cache = pdata;
+    struct rb_pool *pool = cache->pool;
+
+    pool_drain(pool, cache, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    if ((*cache->pprev = cache->next))
+        cache->next->pprev = cache->pprev;
+    pthread_mutex_unlock(&pool->lock);
+
+    free(cache);
+}
+
+/**
+ * pool_cache - get the cache of the calling thread.
+ * @pool: the pool to get the cache for.
+ */
+static struct rb_pool_cache *pool_cache(struct rb_pool *pool)
+{
+    struct rb_pool_cache *cache;
+
+    cache = pthread_getspecific(pool->key);
+    if (likely(cache))
+        return cache;
+
+    cache = malloc(sizeof(*cache));
+    if (!cache)
+        return NULL;
+
+    if (pthread_setspecific(pool->key, cache)) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->pool = pool;
+    cache->free = NULL;
+    cache->count = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    if ((cache->next = pool->caches))
+        cache->next->pprev = &cache->next;
+    cache->pprev = &pool->caches;
+    pool->caches = cache;
+    pthread_mutex_unlock(&pool->lock);
+
+    return cache;
+}
+
+/**
+ * rb_pool_init - initialize a pool of fixed-size objects.
+ * @pool: the pool to initialize.
+ * @size: size of each object.
+ * @flags: RB_POOL_* flags.
+ */
+int rb_pool_init(struct rb_pool *pool, size_t size, unsigned int flags)
+{
+    int retval;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (!size)
+        size = sizeof(void *);
+
+    pool->flags = flags;
+    pool->size = size;
+    pool->slab_size = flags & RB_POOL_HUGEPAGE ? POOL_HUGE_SIZE : POOL_SLAB_SIZE;
+    if (size > pool->slab_size - sizeof(struct rb_pool_slab))
+        return -EINVAL;
+
+    pool->slabs = NULL;
+    pool->caches = NULL;
+    pool->free = NULL;
+    pool->carve = pool->end = NULL;
+
+    if ((retval = pthread_key_create(&pool->key, cache_release)))
+        return -retval;
+
+    if ((retval = pthread_mutex_init(&pool->lock, NULL))) {
+        pthread_key_delete(pool->key);
+        return -retval;
+    }
+
+    return 0;
+}
+
+/**
+ * rb_pool_destroy - release a pool and every object allocated from it.
+ * @pool: the pool to release.
+ *
+ * No thread may use the pool or its objects afterwards.
+ */
+void rb_pool_destroy(struct rb_pool *pool)
+{
+    struct rb_pool_cache *cache;
+    struct rb_pool_slab *slab;
+
+    pthread_key_delete(pool->key);
+
+    while ((cache = pool->caches)) {
+        pool->caches = cache->next;
+        free(cache);
+    }
+
+    while ((slab = pool->slabs)) {
+        pool->slabs = slab->next;
+        munmap(slab, slab->size);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/**
+ * rb_pool_alloc - allocate an object from a pool.
+ * @pool: the pool to allocate from.
+ *
+ * Returns NULL if out of memory.
+ */
+void *rb_pool_alloc(struct rb_pool *pool)
+{
+    struct rb_pool_cache *cache;
+    void *object;
+
+    cache = pool_cache(pool);
+    if (unlikely(!cache))
+        return NULL;
+
+    if (unlikely(!cache->count) && pool_refill(pool, cache))
+        return NULL;
+
+    object = cache->free;
+    cache->free = object_next(object);
+    cache->count--;
+
+    return object;
+}
+
+/**
+ * rb_pool_free - return an object to a pool.
+ * @pool: the pool the object was allocated from.
+ * @object: the object to free.
+ */
+void rb_pool_free(struct rb_pool *pool, void *object)
+{
+    struct rb_pool_cache *cache;
+
+    cache = pool_cache(pool);
+    if (unlikely(!cache)) {
+        pthread_mutex_lock(&pool->lock);
+        object_next(object) = pool->free;
+        pool->free = object;
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+
+    object_next(object) = cache->free;
+    cache->free = object;
+
+    if (unlikely(++cache->count >= RB_POOL_BATCH * 2))
+        pool_drain(pool, cache, RB_POOL_BATCH);
+}
+
+/**
+ * rb_pool_free_tree - release every container of a tree to a pool.
+ * @pool: the pool the containers were allocated from.
+ * @root: the tree to release, left empty.
+ * @offset: offset of the rb_node within the container.
+ *
+ * Walks the tree in postorder, so no node is visited after its
+ * parent was freed, and hands the whole chain over with one lock.
+ */
+void rb_pool_free_tree(struct rb_pool *pool, struct rb_root *root, size_t offset)
+{
+    struct rb_node *node, *tmp;
+    void *first = NULL, *last = NULL, *object;
+
+    rb_post_for_each_safe(node, tmp, root) {
+        object = (char *)node - offset;
+        object_next(object) = first;
+        first = object;
+        if (!last)
+            last = object;
+    }
+
+    *root = RB_INIT;
+    if (!first)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    object_next(last) = pool->free;
+    pool->free = first;
+    pthread_mutex_unlock(&pool->lock);
+}
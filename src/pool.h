@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include "rbtree.h"
+#include <pthread.h>
+
+/*
+ * Slab allocator for fixed-size containers embedding an rb_node.
+ *
+ * Objects are carved from large slabs, so nodes of one tree stay
+ * close together in memory. Every thread allocates from and frees
+ * to its own cache, and only moves objects to or from the shared
+ * free list in batches of RB_POOL_BATCH.
+ *
+ * Objects are aligned to the size of a pointer; the first word of
+ * a free object is reused as the free list link.
+ */
+
+#ifndef RB_POOL_BATCH
+# define RB_POOL_BATCH 64
+#endif
+
+/* back slabs with huge pages, falling back to transparent huge pages */
+#define RB_POOL_HUGEPAGE    (1U << 0)
+
+struct rb_pool_slab;
+struct rb_pool_cache;
+
+struct rb_pool {
+    pthread_mutex_t lock;
+    pthread_key_t key;
+    struct rb_pool_slab *slabs;
+    struct rb_pool_cache *caches;
+    void *free;
+    char *carve, *end;
+    size_t size;
+    size_t slab_size;
+    unsigned int flags;
+};
+
+extern int rb_pool_init(struct rb_pool *pool, size_t size, unsigned int flags);
+extern void rb_pool_destroy(struct rb_pool *pool);
+extern void *rb_pool_alloc(struct rb_pool *pool);
+extern void rb_pool_free(struct rb_pool *pool, void *object);
+extern void rb_pool_free_tree(struct rb_pool *pool, struct rb_root *root, size_t offset);
+
+/**
+ * rb_pool_free_entries - release every container of a tree to the pool.
+ * @pool: the pool the containers were allocated from.
+ * @root: the tree to release, left empty.
+ * @type: the type of the struct the rb_node is embedded in.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_pool_free_entries(pool, root, type, member) \
+    rb_pool_free_tree(pool, root, offsetof(type, member))
+
+#endif  /* _POOL_H_ */
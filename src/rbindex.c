@@ -0,0 +1,227 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbindex.h"
+
+/**
+ * index_node - resolve a reference into the arena.
+ * @root: rbtree root of the arena.
+ * @ref: non-null reference.
+ */
+static __always_inline struct rbi_node *
+index_node(const struct rbi_root *root, uint32_t ref)
+{
+    return (struct rbi_node *)(root->base + (size_t)(ref - 1) * root->stride);
+}
+
+/**
+ * index_node_safe - resolve a reference into the arena or null.
+ * @root: rbtree root of the arena.
+ * @ref: reference to resolve.
+ */
+static __always_inline struct rbi_node *
+index_node_safe(const struct rbi_root *root, uint32_t ref)
+{
+    return ref ? index_node(root, ref) : NULL;
+}
+
+/**
+ * index_ref - get the reference of a node in the arena.
+ * @root: rbtree root of the arena.
+ * @node: node to get the reference of.
+ */
+static __always_inline uint32_t
+index_ref(const struct rbi_root *root, const struct rbi_node *node)
+{
+    return ((const char *)node - root->base) / root->stride + 1;
+}
+
+static __always_inline void
+index_set_parent(const struct rbi_root *root, uint32_t ref, uint32_t parent)
+{
+    struct rbi_node *node = index_node(root, ref);
+    node->parent = (node->parent & RBI_COLOR_MASK) | parent;
+}
+
+static __always_inline void
+index_set_color(const struct rbi_root *root, uint32_t ref, unsigned int color)
+{
+    struct rbi_node *node = index_node(root, ref);
+    node->parent = (node->parent & RBI_LINK_MASK) | ((uint32_t)color << RBI_COLOR_SHIFT);
+}
+
+#define CORE_ROOT           struct rbi_root
+#define CORE_NODE           uint32_t
+#define CORE_NIL            0
+#define CORE_CALLBACKS      void
+
+#define CORE_ROTATE(callbacks, node, successor)     ((void)0)
+#define CORE_COPY(callbacks, node, successor)       ((void)0)
+#define CORE_PROPAGATE(callbacks, node, stop)       ((void)0)
+
+#define core_parent(root, ref)                  (index_node(root, ref)->parent & RBI_LINK_MASK)
+#define core_child(root, ref, dir)              (index_node(root, ref)->child[dir])
+#define core_color(root, ref)                   (index_node(root, ref)->parent >> RBI_COLOR_SHIFT)
+#define core_set_parent(root, ref, value)       index_set_parent(root, ref, value)
+#define core_set_child(root, ref, dir, value)   (index_node(root, ref)->child[dir] = (value))
+#define core_set_color(root, ref, value)        index_set_color(root, ref, value)
+#define core_set_root(root, value)              ((root)->node = (value))
+
+#include "rbtree_core.h"
+
+/**
+ * rbi_insert - find the parent node and insert new node.
+ * @root: rbtree root of the arena.
+ * @node: new node to insert, located in the arena.
+ * @cmp: operator defining the node order.
+ */
+void rbi_insert(struct rbi_root *root, struct rbi_node *node, rbi_cmp_t cmp)
+{
+    uint32_t ref, parent = 0, *link = &root->node;
+    struct rbi_node *walk;
+
+    while (*link) {
+        parent = *link;
+        walk = index_node(root, parent);
+        if (cmp(node, walk) < 0)
+            link = &walk->left;
+        else
+            link = &walk->right;
+    }
+
+    ref = index_ref(root, node);
+    node->parent = parent;
+    node->left = node->right = 0;
+    *link = ref;
+
+    core_fixup(root, ref, NULL);
+}
+
+/**
+ * rbi_delete - delete node and fixup rbtree.
+ * @root: rbtree root of the arena.
+ * @node: node to delete.
+ */
+void rbi_delete(struct rbi_root *root, struct rbi_node *node)
+{
+    uint32_t rebalance;
+
+    if ((rebalance = core_remove(root, index_ref(root, node), NULL)))
+        core_erase(root, rebalance, NULL);
+
+    node->parent = node->left = node->right = 0;
+}
+
+/**
+ * rbi_find - find @key in tree @root.
+ * @root: rbtree want to search.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ */
+struct rbi_node *rbi_find(const struct rbi_root *root, const void *key, rbi_find_t cmp)
+{
+    uint32_t ref = root->node;
+    struct rbi_node *node;
+    long ret;
+
+    while (ref) {
+        node = index_node(root, ref);
+        ret = cmp(node, key);
+        if (ret == LONG_MIN)
+            return NULL;
+        else if (ret < 0)
+            ref = node->left;
+        else if (ret > 0)
+            ref = node->right;
+        else
+            return node;
+    }
+
+    return NULL;
+}
+
+struct rbi_node *rbi_first(const struct rbi_root *root)
+{
+    uint32_t ref = root->node;
+
+    if (!ref)
+        return NULL;
+
+    /* Get the leftmost node */
+    while (core_left(root, ref))
+        ref = core_left(root, ref);
+
+    return index_node(root, ref);
+}
+
+struct rbi_node *rbi_last(const struct rbi_root *root)
+{
+    uint32_t ref = root->node;
+
+    if (!ref)
+        return NULL;
+
+    /* Get the rightmost node */
+    while (core_right(root, ref))
+        ref = core_right(root, ref);
+
+    return index_node(root, ref);
+}
+
+struct rbi_node *rbi_prev(const struct rbi_root *root, const struct rbi_node *node)
+{
+    uint32_t ref, parent;
+
+    if (!node)
+        return NULL;
+
+    /*
+     * If there is a left-hand node, go down
+     * and then as far right as possible.
+     */
+    if ((ref = node->left)) {
+        while (core_right(root, ref))
+            ref = core_right(root, ref);
+        return index_node(root, ref);
+    }
+
+    /*
+     * No left-hand children. Go up till we find an ancestor
+     * which is a right-hand child of its parent.
+     */
+    ref = index_ref(root, node);
+    while ((parent = core_parent(root, ref)) && ref != core_right(root, parent))
+        ref = parent;
+
+    return index_node_safe(root, parent);
+}
+
+struct rbi_node *rbi_next(const struct rbi_root *root, const struct rbi_node *node)
+{
+    uint32_t ref, parent;
+
+    if (!node)
+        return NULL;
+
+    /*
+     * If there is a right-hand node, go down
+     * and then as far left as possible.
+     */
+    if ((ref = node->right)) {
+        while (core_left(root, ref))
+            ref = core_left(root, ref);
+        return index_node(root, ref);
+    }
+
+    /*
+     * No right-hand children. Go up till we find an ancestor
+     * which is a left-hand child of its parent.
+     */
+    ref = index_ref(root, node);
+    while ((parent = core_parent(root, ref)) && ref != core_left(root, parent))
+        ref = parent;
+
+    return index_node_safe(root, parent);
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _RBINDEX_H_
+#define _RBINDEX_H_
+
+#include "rbtree.h"
+#include <stdint.h>
+
+/*
+ * Index-linked rbtree for nodes living in one arena.
+ *
+ * Links are 32-bit references into a caller supplied array of
+ * containers instead of pointers, so a node takes 12 bytes. A
+ * reference is the array index plus one, zero being the null link.
+ * The top bit of the parent link holds the color, which limits an
+ * arena to RBI_MAX_NODES containers.
+ */
+
+#define RBI_COLOR_SHIFT 31
+#define RBI_COLOR_MASK  (1U << RBI_COLOR_SHIFT)
+#define RBI_LINK_MASK   (RBI_COLOR_MASK - 1)
+#define RBI_MAX_NODES   RBI_LINK_MASK
+
+struct rbi_node {
+    uint32_t parent;
+    union {
+        uint32_t child[2];
+        struct {
+            uint32_t left;
+            uint32_t right;
+        };
+    };
+};
+
+struct rbi_root {
+    char *base;
+    size_t stride;
+    uint32_t node;
+};
+
+#define RBI_STATIC(arena, member) \
+    {(char *)&(arena)->member, sizeof(*(arena)), 0}
+
+#define RBI_INIT(arena, member) \
+    (struct rbi_root) RBI_STATIC(arena, member)
+
+#define RBI_ROOT(name, arena, member) \
+    struct rbi_root name = RBI_INIT(arena, member)
+
+#define RBI_EMPTY_ROOT(root) \
+    ((root)->node == 0)
+
+/**
+ * rbi_entry - get the struct for this entry.
+ * @ptr: the &struct rbi_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbi_node within the struct.
+ */
+#define rbi_entry(ptr, type, member) \
+    rb_entry(ptr, type, member)
+
+/**
+ * rbi_entry_safe - get the struct for this entry or null.
+ * @ptr: the &struct rbi_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbi_node within the struct.
+ */
+#define rbi_entry_safe(ptr, type, member) \
+    rb_entry_safe(ptr, type, member)
+
+typedef long (*rbi_find_t)(const struct rbi_node *node, const void *key);
+typedef long (*rbi_cmp_t)(const struct rbi_node *nodea, const struct rbi_node *nodeb);
+
+extern void rbi_insert(struct rbi_root *root, struct rbi_node *node, rbi_cmp_t cmp);
+extern void rbi_delete(struct rbi_root *root, struct rbi_node *node);
+extern struct rbi_node *rbi_find(const struct rbi_root *root, const void *key, rbi_find_t cmp);
+
+/* Middle iteration (Sequential) - find logical next and previous nodes */
+extern struct rbi_node *rbi_first(const struct rbi_root *root);
+extern struct rbi_node *rbi_last(const struct rbi_root *root);
+extern struct rbi_node *rbi_prev(const struct rbi_root *root, const struct rbi_node *node);
+extern struct rbi_node *rbi_next(const struct rbi_root *root, const struct rbi_node *node);
+
+/**
+ * rbi_first_entry - get the first element from a rbtree.
+ * @root: the rbtree root to take the element from.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbi_node within the struct.
+ */
+#define rbi_first_entry(root, type, member) \
+    rbi_entry_safe(rbi_first(root), type, member)
+
+/**
+ * rbi_next_entry - get the next element in rbtree.
+ * @root: the rbtree root @pos belongs to.
+ * @pos: the type * to cursor.
+ * @member: the name of the rbi_node within the struct.
+ */
+#define rbi_next_entry(root, pos, member) \
+    rbi_entry_safe(rbi_next(root, &(pos)->member), typeof(*(pos)), member)
+
+/**
+ * rbi_for_each - iterate over a rbtree.
+ * @pos: the &struct rbi_node to use as a loop cursor.
+ * @root: the root for your rbtree.
+ */
+#define rbi_for_each(pos, root) \
+    for (pos = rbi_first(root); pos; pos = rbi_next(root, pos))
+
+/**
+ * rbi_for_each_entry - iterate over rbtree of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @root: the root for your rbtree.
+ * @member: the name of the rbi_node within the struct.
+ */
+#define rbi_for_each_entry(pos, root, member) \
+    for (pos = rbi_first_entry(root, typeof(*pos), member); \
+         pos; pos = rbi_next_entry(root, pos, member))
+
+#endif  /* _RBINDEX_H_ */
@@ -6,104 +6,63 @@
 
 #include "rbtree.h"
 
-/**
- * child_change - replace old child by new one.
- * @root: rbtree root of node.
- * @parent: parent to change child.
- * @old: node to be replaced.
- * @new: new node to insert.
- */
-static __always_inline void
-child_change(struct rb_root *root, struct rb_node *parent,
-             struct rb_node *old, struct rb_node *new)
-{
-    if (!parent)
-        root->node = new;
-    else if (parent->left == old)
-        parent->left = new;
-    else
-        parent->right = new;
-}
+#define CORE_ROOT           struct rb_root
+#define CORE_NODE           struct rb_node *
+#define CORE_NIL            NULL
+#define CORE_CALLBACKS      struct rb_callbacks
 
-/**
- * rotate_set - replace old child by new one.
- * @root: rbtree root of node.
- * @node: parent to change child.
- * @new: node to be replaced.
- * @child: managed child node.
- * @color: color after rotation.
- * @ccolor: color of child.
- * @callbacks: augmented callback function.
- */
-static __always_inline void
-rotate_set(struct rb_root *root, struct rb_node *node, struct rb_node *new,
-           struct rb_node *child, unsigned int color, unsigned int ccolor,
-           const struct rb_callbacks *callbacks)
-{
-    struct rb_node *parent = node->parent;
+#define CORE_ROTATE(callbacks, node, successor) \
+    (callbacks)->rotate(node, successor)
 
-    new->parent = node->parent;
-    node->parent = new;
+#define CORE_COPY(callbacks, node, successor) \
+    (callbacks)->copy(node, successor)
 
-    if (color != RB_NSET) {
-        new->color = node->color;
-        node->color = color;
-    }
+#define CORE_PROPAGATE(callbacks, node, stop) \
+    (callbacks)->propagate(node, stop)
 
-    if (child) {
-        if (ccolor != RB_NSET)
-            child->color = ccolor;
-        child->parent = node;
-    }
+#define core_parent(root, node)                 ((node)->parent)
+#define core_child(root, node, dir)             ((node)->child[dir])
+#define core_color(root, node)                  ((node)->color)
+#define core_set_parent(root, node, value)      ((node)->parent = (value))
+#define core_set_child(root, node, dir, value)  ((node)->child[dir] = (value))
+#define core_set_color(root, node, value)       ((node)->color = (value))
+#define core_set_root(root, value)          ((root)->node = (value))
 
-    child_change(root, parent, node, new);
-    callbacks->rotate(node, new);
-}
+#ifdef RB_STATS
+static __thread struct rb_stats stats;
+# define core_stat(field, value) (stats.field += (value))
+#endif
+
+#define core_probe(name, node, levels, rotations) \
+    rb_probe3(name, node, levels, rotations)
+
+#include "rbtree_core.h"
 
 /**
- * left_rotate - left rotation one node.
- * @root: rbtree root of node.
- * @node: node to rotation.
- * @color: color after rotation.
- * @ccolor: color of child.
- * @callbacks: augmented callback function.
+ * rb_stats_read - read the operation counts of the calling thread.
+ * @result: filled with the counts, all zero without RB_STATS.
+ *
+ * Returns whether the library keeps counts at all.
  */
-static __always_inline struct rb_node *
-left_rotate(struct rb_root *root, struct rb_node *node,
-            unsigned int color, unsigned int ccolor,
-            const struct rb_callbacks *callbacks)
+bool rb_stats_read(struct rb_stats *result)
 {
-    struct rb_node *child, *successor = node->right;
-
-    /* change left child */
-    child = node->right = successor->left;
-    successor->left = node;
-
-    rotate_set(root, node, successor, child, color, ccolor, callbacks);
-    return child;
+#ifdef RB_STATS
+    *result = stats;
+    return true;
+#else
+    memset(result, 0, sizeof(*result));
+    return false;
+#endif
 }
 
 /**
- * right_rotate - right rotation one node.
- * @root: rbtree root of node.
- * @node: node to rotation.
- * @color: color after rotation.
- * @ccolor: color of child.
- * @callbacks: augmented callback function.
+ * rb_stats_reset - zero the operation counts of the calling thread.
  */
-static __always_inline struct rb_node *
-right_rotate(struct rb_root *root, struct rb_node *node,
-             unsigned int color, unsigned int ccolor,
-             const struct rb_callbacks *callbacks)
+void rb_stats_reset(void)
 {
-    struct rb_node *child, *successor = node->left;
-
-    /* change right child */
-    child = node->left = successor->right;
-    successor->right = node;
-
-    rotate_set(root, node, successor, child, color, ccolor, callbacks);
-    return child;
+#ifdef RB_STATS
+    memset(&stats, 0, sizeof(stats));
+#endif
 }
 
 /**
@@ -115,110 +74,7 @@ right_rotate(struct rb_root *root, struct rb_node *node,
 void rb_fixup_augmented(struct rb_root *root, struct rb_node *node,
                         const struct rb_callbacks *callbacks)
 {
-    struct rb_node *parent, *gparent, *tmp;
-
-    while (root && node) {
-        parent = node->parent;
-
-        /*
-         * The inserted node is root. Either this is the
-         * first node, or we recursed at Case 1 below and
-         * are no longer violating 4).
-         */
-
-        if (unlikely(!parent)) {
-            node->color = RB_BLACK;
-            break;
-        }
-
-        /*
-         * If there is a black parent, we are done.
-         * Otherwise, take some corrective action as,
-         * per 4), we don't want a red root or two
-         * consecutive red nodes.
-         */
-
-        if (parent->color == RB_BLACK)
-            break;
-
-        gparent = parent->parent;
-        tmp = gparent->right;
-
-        if (tmp != parent) {
-            /*
-             * Case 1 - node's uncle is red (color flips).
-             *
-             *       G            g
-             *      / \          / \
-             *     p   t  -->   P   T
-             *    /            /
-             *   n            n
-             *
-             * However, since g's parent might be red, and
-             * 4) does not allow this, we need to recurse
-             * at g.
-             */
-
-            if (tmp && tmp->color == RB_RED) {
-                parent->color = tmp->color = RB_BLACK;
-                gparent->color = RB_RED;
-                node = gparent;
-                continue;
-            }
-
-            /*
-             * Case 2 - node's uncle is black and node is
-             * the parent's right child (left rotate at parent).
-             *
-             *      G             G
-             *     / \           / \
-             *    p   U  -->    n   U
-             *     \           /
-             *      n         p
-             *     /           \
-             *    c             C
-             *
-             * This still leaves us in violation of 4), the
-             * continuation into Case 3 will fix that.
-             */
-
-            if (node == parent->right)
-                left_rotate(root, parent, RB_NSET, RB_BLACK, callbacks);
-
-            /*
-             * Case 3 - node's uncle is black and node is
-             * the parent's left child (right rotate at gparent).
-             *
-             *        G           P
-             *       / \         / \
-             *      p   U  -->  n   g
-             *     / \             / \
-             *    n   s           S   U
-             */
-
-            right_rotate(root, gparent, RB_RED, RB_BLACK, callbacks);
-            break;
-        } else {
-            /* parent == gparent->right */
-            tmp = gparent->left;
-
-            /* Case 1 - color flips */
-            if (tmp && tmp->color == RB_RED) {
-                parent->color = tmp->color = RB_BLACK;
-                gparent->color = RB_RED;
-                node = gparent;
-                continue;
-            }
-
-            /* Case 2 - right rotate at parent */
-            if (node == parent->left)
-                right_rotate(root, parent, RB_NSET, RB_BLACK, callbacks);
-
-            /* Case 3 - left rotate at gparent */
-            left_rotate(root, gparent, RB_RED, RB_BLACK, callbacks);
-            break;
-        }
-    }
+    core_fixup(root, node, callbacks);
 }
 
 /**
@@ -230,149 +86,7 @@ void rb_fixup_augmented(struct rb_root *root, struct rb_node *node,
 void rb_erase_augmented(struct rb_root *root, struct rb_node *parent,
                         const struct rb_callbacks *callbacks)
 {
-    struct rb_node *tmp1, *tmp2, *sibling, *node = NULL;
-
-    while (root && parent) {
-        /*
-         * Loop invariants:
-         * - node is black (or NULL on first iteration)
-         * - node is not the root (parent is not NULL)
-         * - All leaf paths going through parent and node have a
-         *   black node count that is 1 lower than other leaf paths.
-         */
-
-        sibling = parent->right;
-        if (node != sibling) {
-            /*
-             * Case 1 - left rotate at parent
-             *
-             *     P               S
-             *    / \             / \
-             *   N   s    -->    p   Sr
-             *      / \         / \
-             *     Sl  Sr      N   Sl
-             */
-
-            if (sibling->color == RB_RED)
-                sibling = left_rotate(root, parent, RB_RED, RB_BLACK, callbacks);
-
-            tmp2 = sibling->right;
-            if (!tmp2 || tmp2->color == RB_BLACK) {
-                tmp1 = sibling->left;
-
-                /*
-                 * Case 2 - sibling color flip
-                 * (p could be either color here)
-                 *
-                 *    (p)           (p)
-                 *    / \           / \
-                 *   N   S    -->  N   s
-                 *      / \           / \
-                 *     Sl  Sr        Sl  Sr
-                 *
-                 * This leaves us violating 5) which
-                 * can be fixed by flipping p to black
-                 * if it was red, or by recursing at p.
-                 * p is red when coming from Case 1.
-                 */
-
-                if (!tmp1 || tmp1->color == RB_BLACK) {
-                    sibling->color = RB_RED;
-                    if (parent->color == RB_RED)
-                        parent->color = RB_BLACK;
-                    else {
-                        node = parent;
-                        parent = node->parent;
-                        if (parent)
-                            continue;
-                    }
-                    break;
-                }
-
-                /*
-                 * Case 3 - right rotate at sibling
-                 * (p could be either color here)
-                 *
-                 *   (p)           (p)
-                 *   / \           / \
-                 *  N   S    -->  N   sl
-                 *     / \             \
-                 *    sl  Sr            S
-                 *      \              / \
-                 *       t            T   Sr
-                 *
-                 * Note: p might be red, and then both
-                 * p and sl are red after rotation(which
-                 * breaks property 4). This is fixed in
-                 * Case 4 (in __rb_rotate_set_parents()
-                 *         which set sl the color of p
-                 *         and set p RB_BLACK)
-                 *
-                 *   (p)            (sl)
-                 *   / \            /  \
-                 *  N   sl   -->   P    S
-                 *       \        /      \
-                 *        S      N        Sr
-                 *         \
-                 *          Sr
-                 */
-
-                right_rotate(root, sibling, RB_NSET, RB_BLACK, callbacks);
-                tmp2 = sibling;
-            }
-
-            /*
-             * Case 4 - left rotate at parent + color flips
-             * (p and sl could be either color here.
-             *  After rotation, p becomes black, s acquires
-             *  p's color, and sl keeps its color)
-             *
-             *      (p)             (s)
-             *      / \             / \
-             *     N   S     -->   P   Sr
-             *        / \         / \
-             *      (sl) sr      N  (sl)
-             */
-
-            left_rotate(root, parent, RB_BLACK, RB_NSET, callbacks);
-            tmp2->color = RB_BLACK;
-            break;
-        } else {
-            sibling = parent->left;
-
-            /* Case 1 - right rotate at parent */
-            if (sibling->color == RB_RED)
-                sibling = right_rotate(root, parent, RB_RED, RB_BLACK, callbacks);
-
-            tmp1 = sibling->left;
-            if (!tmp1 || tmp1->color == RB_BLACK) {
-                tmp2 = sibling->right;
-
-                /* Case 2 - sibling color flip */
-                if (!tmp2 || tmp2->color == RB_BLACK) {
-                    sibling->color = RB_RED;
-                    if (parent->color == RB_RED)
-                        parent->color = RB_BLACK;
-                    else {
-                        node = parent;
-                        parent = node->parent;
-                        if (parent)
-                            continue;
-                    }
-                    break;
-                }
-
-                /* Case 3 - left rotate at sibling */
-                left_rotate(root, sibling, RB_NSET, RB_BLACK, callbacks);
-                tmp1 = sibling;
-            }
-
-            /* Case 4 - right rotate at parent + color flips */
-            right_rotate(root, parent, RB_BLACK, RB_NSET, callbacks);
-            tmp1->color = RB_BLACK;
-            break;
-        }
-    }
+    core_erase(root, parent, callbacks);
 }
 
 /**
@@ -384,121 +98,69 @@ void rb_erase_augmented(struct rb_root *root, struct rb_node *parent,
 struct rb_node *rb_remove_augmented(struct rb_root *root, struct rb_node *node,
                                     const struct rb_callbacks *callbacks)
 {
-    struct rb_node *parent = node->parent, *rebalance = NULL;
-    struct rb_node *child1 = node->left;
-    struct rb_node *child2 = node->right;
-
-    if (!child1 && !child2) {
-        /*
-         * Case 1: node to erase has no child.
-         *
-         *     (p)        (p)
-         *     / \          \
-         *   (n) (s)  ->    (s)
-         *
-         */
-
-        if (node->color == RB_BLACK)
-            rebalance = parent;
-        child_change(root, parent, node, NULL);
-    } else if (!child2) {
-        /*
-         * Case 1: node to erase only has left child.
-         *
-         *      (p)          (p)
-         *      / \          / \
-         *    (n) (s)  ->  (c) (s)
-         *    /
-         *  (c)
-         *
-         */
-
-        child1->color = node->color;
-        child1->parent = node->parent;
-        child_change(root, parent, node, child1);
-    } else if (!child1) {
-        /*
-         * Case 1: node to erase only has right child.
-         *
-         *    (p)          (p)
-         *    / \          / \
-         *  (n) (s)  ->  (c) (s)
-         *    \
-         *    (c)
-         */
-
-        child2->color = node->color;
-        child2->parent = node->parent;
-        child_change(root, parent, node, child2);
-    } else { /* child1 && child2 */
-        struct rb_node *tmp, *successor = child2;
-
-        child1 = child2->left;
-        if (!child1) {
-            /*
-             * Case 2: node's successor is its right child
-             *
-             *    (n)          (s)
-             *    / \          / \
-             *  (x) (s)  ->  (x) (c)
-             *        \
-             *        (c)
-             */
-
-            parent = successor;
-            tmp = successor->right;
-            callbacks->copy(node, successor);
-        } else {
-            /*
-             * Case 3: node's successor is leftmost under
-             * node's right child subtree
-             *
-             *    (n)          (s)
-             *    / \          / \
-             *  (x) (y)  ->  (x) (y)
-             *      /            /
-             *    (p)          (p)
-             *    /            /
-             *  (s)          (c)
-             *    \
-             *    (c)
-             */
-
-            do {
-                parent = successor;
-                successor = child1;
-                child1 = child1->left;
-            } while (child1);
-
-            tmp = successor->right;
-            parent->left = tmp;
-            successor->right = child2;
-            child2->parent = successor;
-
-            callbacks->copy(node, successor);
-            callbacks->propagate(parent, successor);
+    return core_remove(root, node, callbacks);
+}
+
+/**
+ * rb_relaxed_fixup_augmented - augmented balance one deferred insertion.
+ * @root: rbtree root of node.
+ * @node: node linked without balancing.
+ * @callbacks: augmented callback function.
+ *
+ * The tree may hold other red-red violations, so each step works on
+ * the topmost violation of the red chain above @node, where the
+ * grandparent is known to be black. Rotations leave the color of
+ * moved subtrees alone; a red subtree moved under a red node is
+ * another deferred insertion and is fixed by its own call. A color
+ * flip moves the violation to the grandparent, which is fixed before
+ * coming back to @node.
+ */
+void rb_relaxed_fixup_augmented(struct rb_root *root, struct rb_node *node,
+                                const struct rb_callbacks *callbacks)
+{
+    struct rb_node *walk, *top, *parent, *gparent, *tmp;
+    unsigned int dir;
+
+    for (;;) {
+        top = NULL;
+        for (walk = node; walk->color == RB_RED && walk->parent &&
+             walk->parent->color == RB_RED; walk = walk->parent)
+            top = walk;
+
+        if (!top)
+            break;
+
+        parent = top->parent;
+        gparent = parent->parent;
+
+        /* The red parent is root, paint it black */
+        if (unlikely(!gparent)) {
+            parent->color = RB_BLACK;
+            continue;
         }
 
-        child1 = node->left;
-        successor->left = child1;
-        child1->parent = successor;
+        dir = parent == gparent->right;
+        tmp = gparent->child[!dir];
 
-        child1 = node->parent;
-        child_change(root, child1, node, successor);
+        /* Case 1 - color flips */
+        if (tmp && tmp->color == RB_RED) {
+            core_stat(recolors, 1);
+            parent->color = tmp->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_relaxed_fixup_augmented(root, gparent, callbacks);
+            continue;
+        }
 
-        if (tmp) {
-            tmp->parent = parent;
-            tmp->color = RB_BLACK;
-        } else if (successor->color == RB_BLACK)
-            rebalance = parent;
+        /* Case 2 - rotate at parent */
+        if (top == parent->child[!dir])
+            core_rotate(root, parent, dir, RB_NSET, RB_NSET, callbacks);
 
-        successor->parent = child1;
-        successor->color = node->color;
-        parent = successor;
+        /* Case 3 - rotate at gparent */
+        core_rotate(root, gparent, !dir, RB_RED, RB_NSET, callbacks);
     }
 
-    callbacks->propagate(parent, NULL);
-    return rebalance;
+    if (!node->parent)
+        node->color = RB_BLACK;
 }
 
 static void dummy_rotate(struct rb_node *node, struct rb_node *successor) {}
@@ -521,6 +183,16 @@ void rb_fixup(struct rb_root *root, struct rb_node *node)
     rb_fixup_augmented(root, node, &dummy_callbacks);
 }
 
+/**
+ * rb_relaxed_fixup - balance one deferred insertion.
+ * @root: rbtree root of node.
+ * @node: red node linked without balancing.
+ */
+void rb_relaxed_fixup(struct rb_root *root, struct rb_node *node)
+{
+    rb_relaxed_fixup_augmented(root, node, &dummy_callbacks);
+}
+
 /**
  * rb_erase - balance after remove node.
  * @root: rbtree root of node.
@@ -558,9 +230,18 @@ void rb_replace(struct rb_root *root, struct rb_node *old, struct rb_node *new)
     if (old->right)
         old->right->parent = new;
 
-    child_change(root, parent, old, new);
+    core_child_change(root, parent, old, new);
 }
 
+/*
+ * With RB_BRANCHLESS the descents below step through child[] with
+ * the comparison as index. That saves the mispredicted branch per
+ * level on cache-resident trees, but it makes each load depend on
+ * the comparison, so a tree much larger than the cache is faster
+ * with the default branches, which let the core start fetching the
+ * predicted child before the comparison resolves.
+ */
+
 /**
  * rb_find - find @key in tree @root.
  * @root: rbtree want to search.
@@ -570,21 +251,38 @@ void rb_replace(struct rb_root *root, struct rb_node *old, struct rb_node *new)
 struct rb_node *rb_find(const struct rb_root *root, const void *key, rb_find_t cmp)
 {
     struct rb_node *node = root->node;
+    unsigned int depth = 0;
     long ret;
 
+    core_stat(descents, 1);
     while (node) {
+        core_stat(levels, 1);
+        core_stat(compares, 1);
+        depth++;
         ret = cmp(node, key);
-        if (ret == LONG_MIN)
-            return NULL;
-        else if (ret < 0)
+#ifdef RB_BRANCHLESS
+        if (unlikely(!ret))
+            break;
+        else if (ret == LONG_MIN) {
+            node = NULL;
+            break;
+        }
+        node = node->child[ret > 0];
+#else
+        if (ret == LONG_MIN) {
+            node = NULL;
+            break;
+        } else if (ret < 0)
             node = node->left;
         else if (ret > 0)
             node = node->right;
         else
-            return node;
+            break;
+#endif
     }
 
-    return NULL;
+    rb_probe3(find__return, root, node, depth);
+    return node;
 }
 
 /**
@@ -600,6 +298,7 @@ struct rb_node *rb_find_last(struct rb_root *root, const void *key, rb_find_t cm
 {
     long ret;
 
+    core_stat(descents, 1);
     *linkp = &root->node;
     if (unlikely(!**linkp)) {
         *parentp = NULL;
@@ -607,7 +306,16 @@ struct rb_node *rb_find_last(struct rb_root *root, const void *key, rb_find_t cm
     }
 
     do {
+        core_stat(levels, 1);
+        core_stat(compares, 1);
         ret = cmp((*parentp = **linkp), key);
+#ifdef RB_BRANCHLESS
+        if (unlikely(!ret))
+            return **linkp;
+        else if (ret == LONG_MIN)
+            return NULL;
+        *linkp = &(**linkp)->child[ret > 0];
+#else
         if (ret == LONG_MIN)
             return NULL;
         else if (ret < 0)
@@ -616,6 +324,7 @@ struct rb_node *rb_find_last(struct rb_root *root, const void *key, rb_find_t cm
             *linkp = &(**linkp)->right;
         else
             return **linkp;
+#endif
     } while (**linkp);
 
     return NULL;
@@ -639,6 +348,7 @@ struct rb_node **rb_parent(struct rb_root *root, struct rb_node **parentp,
     if (!leftmost)
         leftmost = &leftmost_none;
 
+    core_stat(descents, 1);
     link = &root->node;
     if (unlikely(!*link)) {
         *parentp = NULL;
@@ -646,13 +356,20 @@ struct rb_node **rb_parent(struct rb_root *root, struct rb_node **parentp,
     }
 
     do {
+        core_stat(levels, 1);
+        core_stat(compares, 1);
         retval = cmp(node, (*parentp = *link));
+#ifdef RB_BRANCHLESS
+        link = &(*link)->child[retval >= 0];
+        *leftmost &= retval < 0;
+#else
         if (retval < 0)
             link = &(*link)->left;
         else {
             link = &(*link)->right;
             *leftmost = false;
         }
+#endif
     } while (*link);
 
     return link;
@@ -676,6 +393,7 @@ struct rb_node **rb_parent_conflict(struct rb_root *root, struct rb_node **paren
     if (!leftmost)
         leftmost = &leftmost_none;
 
+    core_stat(descents, 1);
     link = &root->node;
     if (unlikely(!*link)) {
         *parentp = NULL;
@@ -683,7 +401,15 @@ struct rb_node **rb_parent_conflict(struct rb_root *root, struct rb_node **paren
     }
 
     do {
+        core_stat(levels, 1);
+        core_stat(compares, 1);
         retval = cmp(node, (*parentp = *link));
+#ifdef RB_BRANCHLESS
+        if (unlikely(!retval))
+            return NULL;
+        link = &(*link)->child[retval > 0];
+        *leftmost &= retval < 0;
+#else
         if (retval < 0)
             link = &(*link)->left;
         else if (retval > 0) {
@@ -691,11 +417,75 @@ struct rb_node **rb_parent_conflict(struct rb_root *root, struct rb_node **paren
             *leftmost = false;
         } else
             return NULL;
+#endif
     } while (*link);
 
     return link;
 }
 
+/**
+ * rb_parent_hint - find the parent node starting from a nearby node.
+ * @root: rbtree want to search.
+ * @parentp: pointer used to modify the parent node pointer.
+ * @node: new node to insert.
+ * @hint: node ordered before or equal to @node, or NULL.
+ * @cmp: operator defining the node order.
+ * @leftmost: return whether it is the leftmost node.
+ *
+ * Finger search: climbs from @hint to the lowest ancestor whose
+ * subtree spans @node, comparing only at ancestors entered from
+ * their left child, the ones bounding the subtree from above, and
+ * descends from there. A hint right before @node, as in ascending
+ * inserts, costs no comparison at all when it has no right child.
+ * The climb still follows parent links up the right spine above
+ * the hint, up to the root for the rightmost node.
+ */
+struct rb_node **rb_parent_hint(struct rb_root *root, struct rb_node **parentp, struct rb_node *node,
+                                struct rb_node *hint, rb_cmp_t cmp, bool *leftmost)
+{
+    struct rb_node *parent, *walk, **link;
+
+    if (!hint)
+        return rb_parent(root, parentp, node, cmp, leftmost);
+
+    if (leftmost)
+        *leftmost = false;
+
+    core_stat(descents, 1);
+    for (walk = hint; (parent = walk->parent); walk = parent) {
+        core_stat(climbs, 1);
+        if (walk != parent->left)
+            continue;
+
+        /* @parent is the upper bound of the subtree under @hint */
+        core_stat(compares, 1);
+        if (cmp(node, parent) < 0)
+            break;
+        hint = parent;
+    }
+
+    /* @node is ordered after @hint and before its upper bound */
+    core_stat(levels, 1);
+    *parentp = hint;
+    link = &hint->right;
+
+    while ((walk = *link)) {
+        core_stat(levels, 1);
+        core_stat(compares, 1);
+        *parentp = walk;
+#ifdef RB_BRANCHLESS
+        link = &walk->child[cmp(node, walk) >= 0];
+#else
+        if (cmp(node, walk) < 0)
+            link = &walk->left;
+        else
+            link = &walk->right;
+#endif
+    }
+
+    return link;
+}
+
 struct rb_node *rb_left_far(const struct rb_node *node)
 {
     /* Go left as we can */
@@ -792,8 +582,10 @@ struct rb_node *rb_prev(const struct rb_node *node)
      * No left-hand children. Go up till we find an ancestor
      * which is a right-hand child of its parent.
      */
-    while ((parent = node->parent) && node != parent->right)
+    while ((parent = node->parent) && node != parent->right) {
+        core_stat(climbs, 1);
         node = parent;
+    }
 
     return parent;
 }
@@ -818,8 +610,10 @@ struct rb_node *rb_next(const struct rb_node *node)
      * No right-hand children. Go up till we find an ancestor
      * which is a left-hand child of its parent.
      */
-    while ((parent = node->parent) && node != parent->left)
+    while ((parent = node->parent) && node != parent->left) {
+        core_stat(climbs, 1);
         node = parent;
+    }
 
     return parent;
 }
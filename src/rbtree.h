@@ -9,15 +9,31 @@
 #include <stddef.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #define RB_RED      (0)
 #define RB_BLACK    (1)
 #define RB_NSET     (2)
 
+#define RB_LEFT     (0)
+#define RB_RIGHT    (1)
+
+/*
+ * The children are also reachable as child[RB_LEFT] and
+ * child[RB_RIGHT], so a descent can step with child[cmp > 0]
+ * instead of branching on the comparison, and the rebalancing
+ * code handles both mirrored cases with one direction index.
+ */
 struct rb_node {
     struct rb_node *parent;
-    struct rb_node *left;
-    struct rb_node *right;
+    union {
+        struct rb_node *child[2];
+        struct {
+            struct rb_node *left;
+            struct rb_node *right;
+        };
+    };
     bool color;
 };
 
@@ -30,6 +46,92 @@ struct rb_root_cached {
     struct rb_node *leftmost;
 };
 
+/* a node of a relaxed tree, which knows its slot in the pending ring */
+struct rb_relaxed_node {
+    struct rb_node node;
+    unsigned long pending;
+};
+
+/*
+ * A relaxed tree links inserts at once and queues their red-red
+ * violations in the pending ring, to be fixed by rb_rebalance_pending().
+ * Deletes are not deferred: one that has to restore the black height
+ * first settles every pending violation, and then rebalances as usual.
+ */
+struct rb_relaxed {
+    struct rb_root root;
+    struct rb_relaxed_node **pending;
+    unsigned long head;
+    unsigned long used;
+    unsigned long count;
+    unsigned long capacity;
+    unsigned long nodes;
+};
+
+/*
+ * Keyed node for the common u64 case: the key sits right after the
+ * links, so a descent reads one object per level and compares in
+ * registers instead of calling back into the container. Keeping the
+ * containers 64-byte aligned puts each such object on one cache line.
+ */
+struct rb_node_u64 {
+    struct rb_node node;
+    uint64_t key;
+};
+
+/*
+ * String-keyed node: the first eight bytes of the key are cached
+ * big-endian and zero padded, so most levels are decided by one
+ * integer compare without following the key pointer. Keys sharing
+ * a fixed lead of eight bytes or more, such as a URL scheme, tie on
+ * every prefix and should have it stripped before insertion.
+ */
+struct rb_node_str {
+    struct rb_node node;
+    uint64_t prefix;
+    const char *key;
+    size_t length;
+};
+
+/*
+ * Operation counts of the calling thread, kept by the out-of-line
+ * routines of a library built with RB_STATS. A descent is one call
+ * of rb_find or the rb_parent family, levels are the nodes it
+ * visited and climbs the parent steps taken by rb_next/rb_prev.
+ */
+struct rb_stats {
+    unsigned long rotations;
+    unsigned long recolors;
+    unsigned long descents;
+    unsigned long levels;
+    unsigned long compares;
+    unsigned long climbs;
+};
+
+#ifndef RB_REPORT_DEPTH
+# define RB_REPORT_DEPTH 128
+#endif
+
+/*
+ * Shape and memory spread of a tree, filled by rb_analyze. Depths
+ * count the root as 1, depths[] holds the nodes of each level with
+ * deeper ones folded into the last slot, and avg_compares is the
+ * mean node depth, the comparator calls of a successful search.
+ */
+struct rb_report {
+    unsigned long nodes;
+    unsigned long leaves;
+    unsigned int min_depth;
+    unsigned int max_depth;
+    double avg_depth;
+    unsigned long depths[RB_REPORT_DEPTH];
+    unsigned int black_height;
+    double red_ratio;
+    double avg_compares;
+    unsigned long lines;
+    unsigned long pages;
+};
+
 struct rb_callbacks {
     void (*rotate)(struct rb_node *node, struct rb_node *successor);
     void (*copy)(struct rb_node *node, struct rb_node *successor);
@@ -54,6 +156,11 @@ struct rb_callbacks {
 #define RB_ROOT_CACHED(name) \
     struct rb_root_cached name = RB_CACHED_INIT
 
+#define RB_REBALANCE_ALL ULONG_MAX
+
+#define RB_LAYOUT_VEB       (0)
+#define RB_LAYOUT_BLOCKED   (1)
+
 #define RB_EMPTY_ROOT(root) \
     ((root)->node == NULL)
 
@@ -93,6 +200,66 @@ struct rb_callbacks {
 # define unlikely(x) __builtin_expect(!!(x), 0)
 #endif
 
+/*
+ * Static tracepoints under the "rbtree" provider.
+ *
+ * Built with RB_USDT every probe is a single nop plus a .note.stapsdt
+ * entry describing where its arguments live, which bpftrace, perf and
+ * systemtap patch into a trap only while attached. <sys/sdt.h> is used
+ * when the toolchain has it; otherwise the same note is emitted here
+ * on x86-64 and arm64. Probes carry no semaphore, so the arguments are
+ * always computed, which for the values passed below costs a register
+ * at most. Without RB_USDT the probes compile away.
+ */
+
+#if defined(RB_USDT) && defined(__has_include)
+# if __has_include(<sys/sdt.h>)
+#  include <sys/sdt.h>
+#  define rb_probe1(name, a) DTRACE_PROBE1(rbtree, name, a)
+#  define rb_probe2(name, a, b) DTRACE_PROBE2(rbtree, name, a, b)
+#  define rb_probe3(name, a, b, c) DTRACE_PROBE3(rbtree, name, a, b, c)
+# elif defined(__x86_64__) || defined(__aarch64__)
+#  define rb_probe_note(name, args, ...) __asm__ __volatile__ (     \
+    "990: nop\n"                                                    \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                   \
+    ".balign 4\n"                                                   \
+    ".4byte 992f-991f, 994f-993f, 3\n"                              \
+    "991: .asciz \"stapsdt\"\n"                                     \
+    "992: .balign 4\n"                                              \
+    "993: .8byte 990b\n"                                            \
+    ".8byte _.stapsdt.base\n"                                       \
+    ".8byte 0\n"                                                    \
+    ".asciz \"rbtree\"\n"                                           \
+    ".asciz \"" #name "\"\n"                                        \
+    ".asciz \"" args "\"\n"                                         \
+    "994: .balign 4\n"                                              \
+    ".popsection\n"                                                 \
+    ".ifndef _.stapsdt.base\n"                                      \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n"                                        \
+    ".hidden _.stapsdt.base\n"                                      \
+    "_.stapsdt.base: .space 1\n"                                    \
+    ".size _.stapsdt.base, 1\n"                                     \
+    ".popsection\n"                                                 \
+    ".endif\n"                                                      \
+    :: __VA_ARGS__                                                  \
+)
+#  define rb_probe1(name, arg1) rb_probe_note(name, "8@%[a1]",       \
+    [a1] "nor" ((unsigned long)(arg1)))
+#  define rb_probe2(name, arg1, arg2) rb_probe_note(name, "8@%[a1] 8@%[a2]", \
+    [a1] "nor" ((unsigned long)(arg1)), [a2] "nor" ((unsigned long)(arg2)))
+#  define rb_probe3(name, arg1, arg2, arg3) rb_probe_note(name, "8@%[a1] 8@%[a2] 8@%[a3]", \
+    [a1] "nor" ((unsigned long)(arg1)), [a2] "nor" ((unsigned long)(arg2)), \
+    [a3] "nor" ((unsigned long)(arg3)))
+# endif
+#endif
+
+#ifndef rb_probe1
+# define rb_probe1(name, a) ((void)(a))
+# define rb_probe2(name, a, b) ((void)(a), (void)(b))
+# define rb_probe3(name, a, b, c) ((void)(a), (void)(b), (void)(c))
+#endif
+
 #ifndef POISON_OFFSET
 # define POISON_OFFSET 0
 #endif
@@ -108,11 +275,14 @@ extern bool rb_debug_delete_check(struct rb_node *node);
 
 typedef long (*rb_find_t)(const struct rb_node *node, const void *key);
 typedef long (*rb_cmp_t)(const struct rb_node *nodea, const struct rb_node *nodeb);
+typedef void (*rb_relocate_t)(void *old, void *new, void *pdata);
 
 extern void rb_fixup_augmented(struct rb_root *root, struct rb_node *node, const struct rb_callbacks *callbacks);
 extern void rb_erase_augmented(struct rb_root *root, struct rb_node *parent, const struct rb_callbacks *callbacks);
 extern struct rb_node *rb_remove_augmented(struct rb_root *root, struct rb_node *node, const struct rb_callbacks *callbacks);
+extern void rb_relaxed_fixup_augmented(struct rb_root *root, struct rb_node *node, const struct rb_callbacks *callbacks);
 extern void rb_fixup(struct rb_root *root, struct rb_node *node);
+extern void rb_relaxed_fixup(struct rb_root *root, struct rb_node *node);
 extern void rb_erase(struct rb_root *root, struct rb_node *parent);
 extern struct rb_node *rb_remove(struct rb_root *root, struct rb_node *node);
 extern void rb_replace(struct rb_root *root, struct rb_node *old, struct rb_node *new);
@@ -120,6 +290,23 @@ extern struct rb_node *rb_find(const struct rb_root *root, const void *key, rb_f
 extern struct rb_node *rb_find_last(struct rb_root *root, const void *key, rb_find_t cmp, struct rb_node **parentp, struct rb_node ***linkp);
 extern struct rb_node **rb_parent(struct rb_root *root, struct rb_node **parentp, struct rb_node *node, rb_cmp_t cmp, bool *leftmost);
 extern struct rb_node **rb_parent_conflict(struct rb_root *root, struct rb_node **parentp, struct rb_node *node, rb_cmp_t cmp, bool *leftmost);
+extern struct rb_node **rb_parent_hint(struct rb_root *root, struct rb_node **parentp, struct rb_node *node, struct rb_node *hint, rb_cmp_t cmp, bool *leftmost);
+
+extern bool rb_stats_read(struct rb_stats *stats);
+extern void rb_stats_reset(void);
+
+extern void rb_relaxed_init(struct rb_relaxed *relaxed, struct rb_relaxed_node **pending, unsigned long capacity);
+extern void rb_relaxed_insert(struct rb_relaxed *relaxed, struct rb_relaxed_node *node, rb_cmp_t cmp);
+extern void rb_relaxed_delete(struct rb_relaxed *relaxed, struct rb_relaxed_node *node);
+extern unsigned long rb_rebalance_pending(struct rb_relaxed *relaxed, unsigned long budget);
+extern unsigned int rb_relaxed_height_bound(const struct rb_relaxed *relaxed);
+
+extern void rb_build_augmented(struct rb_root *root, struct rb_node **nodes, unsigned long count, const struct rb_callbacks *callbacks);
+extern void rb_build(struct rb_root *root, struct rb_node **nodes, unsigned long count);
+extern void rb_parallel_build_augmented(struct rb_root *root, struct rb_node **nodes, unsigned long count, unsigned int threads, const struct rb_callbacks *callbacks);
+extern void rb_parallel_build(struct rb_root *root, struct rb_node **nodes, unsigned long count, unsigned int threads);
+extern int rb_relayout(struct rb_root *root, void *arena, size_t node_size, size_t offset, unsigned int layout, rb_relocate_t relocate, void *pdata);
+extern int rb_analyze(const struct rb_root *root, struct rb_report *report);
 
 #define rb_cached_erase_augmented(cached, parent, callbacks) rb_erase_augmented(&(cached)->root, parent, callbacks)
 #define rb_cached_remove_augmented(cached, node, callbacks) rb_remove_augmented(&(cached)->root, node, callbacks)
@@ -129,6 +316,7 @@ extern struct rb_node **rb_parent_conflict(struct rb_root *root, struct rb_node
 #define rb_cached_find_last(cached, key, cmp, parentp, linkp) rb_find_last(&(cached)->root, key, cmp, parentp, linkp)
 #define rb_cached_parent(cached, parentp, node, cmp, leftmost) rb_parent(&(cached)->root, parentp, node, cmp, leftmost)
 #define rb_cached_parent_conflict(cached, parentp, node, cmp, leftmost) rb_parent_conflict(&(cached)->root, parentp, node, cmp, leftmost)
+#define rb_cached_parent_hint(cached, parentp, node, hint, cmp, leftmost) rb_parent_hint(&(cached)->root, parentp, node, hint, cmp, leftmost)
 
 extern struct rb_node *rb_left_far(const struct rb_node *node);
 extern struct rb_node *rb_right_far(const struct rb_node *node);
@@ -522,8 +710,10 @@ static inline void rb_insert(struct rb_root *root, struct rb_node *node, rb_cmp_
 {
     struct rb_node *parent, **link;
 
+    rb_probe2(insert__entry, root, node);
     link = rb_parent(root, &parent, node, cmp, NULL);
     rb_insert_node(root, parent, link, node);
+    rb_probe2(insert__return, root, node);
 }
 
 /**
@@ -544,6 +734,22 @@ static inline bool rb_insert_conflict(struct rb_root *root, struct rb_node *node
     return false;
 }
 
+/**
+ * rb_insert_hint - find the parent node from a nearby node and insert new node.
+ * @root: rbtree root of node.
+ * @node: new node to insert.
+ * @hint: node ordered before or equal to @node, or NULL.
+ * @cmp: operator defining the node order.
+ */
+static inline void rb_insert_hint(struct rb_root *root, struct rb_node *node,
+                                  struct rb_node *hint, rb_cmp_t cmp)
+{
+    struct rb_node *parent, **link;
+
+    link = rb_parent_hint(root, &parent, node, hint, cmp, NULL);
+    rb_insert_node(root, parent, link, node);
+}
+
 /**
  * rb_delete - delete node and fixup rbtree.
  * @root: rbtree root of node.
@@ -642,6 +848,254 @@ static inline void rb_delete_augmented(struct rb_root *root, struct rb_node *nod
     node->parent = POISON_RBNODE3;
 }
 
+/**
+ * rb_u64_node - get the keyed node of a linked rb_node.
+ * @ptr: the &struct rb_node pointer.
+ */
+#define rb_u64_node(ptr) \
+    rb_entry(ptr, struct rb_node_u64, node)
+
+/**
+ * rb_u64_node_safe - get the keyed node of a linked rb_node or null.
+ * @ptr: the &struct rb_node pointer.
+ */
+#define rb_u64_node_safe(ptr) \
+    rb_entry_safe(ptr, struct rb_node_u64, node)
+
+/**
+ * rb_u64_insert - insert a keyed node after all nodes with an equal key.
+ * @root: rbtree root of node.
+ * @node: new node to insert, with its key set.
+ */
+static inline void rb_u64_insert(struct rb_root *root, struct rb_node_u64 *node)
+{
+    struct rb_node *parent = NULL, **link = &root->node;
+    uint64_t key = node->key;
+
+    /* the turn indexes child[] rather than branching */
+    while (*link) {
+        parent = *link;
+        link = &parent->child[key >= rb_u64_node(parent)->key];
+    }
+
+    rb_insert_node(root, parent, link, &node->node);
+}
+
+/**
+ * rb_u64_find - find a keyed node with a key.
+ * @root: rbtree root of node.
+ * @key: key to match.
+ */
+static inline struct rb_node_u64 *rb_u64_find(const struct rb_root *root, uint64_t key)
+{
+    struct rb_node *node = root->node;
+    uint64_t walk;
+
+    while (node) {
+        walk = rb_u64_node(node)->key;
+        if (key == walk)
+            return rb_u64_node(node);
+        node = key < walk ? node->left : node->right;
+    }
+
+    return NULL;
+}
+
+/**
+ * rb_u64_lower_bound - find the first keyed node not less than @key.
+ * @root: rbtree root of node.
+ * @key: key to match.
+ */
+static inline struct rb_node_u64 *rb_u64_lower_bound(const struct rb_root *root, uint64_t key)
+{
+    struct rb_node *node = root->node, *match = NULL;
+    bool right;
+
+    while (node) {
+        right = rb_u64_node(node)->key < key;
+        match = right ? match : node;
+        node = node->child[right];
+    }
+
+    return rb_u64_node_safe(match);
+}
+
+/**
+ * rb_u64_upper_bound - find the first keyed node greater than @key.
+ * @root: rbtree root of node.
+ * @key: key to match.
+ */
+static inline struct rb_node_u64 *rb_u64_upper_bound(const struct rb_root *root, uint64_t key)
+{
+    struct rb_node *node = root->node, *match = NULL;
+    bool right;
+
+    while (node) {
+        right = rb_u64_node(node)->key <= key;
+        match = right ? match : node;
+        node = node->child[right];
+    }
+
+    return rb_u64_node_safe(match);
+}
+
+/**
+ * rb_u64_delete - delete a keyed node and fixup rbtree.
+ * @root: rbtree root of node.
+ * @node: node to delete.
+ */
+static inline void rb_u64_delete(struct rb_root *root, struct rb_node_u64 *node)
+{
+    rb_delete(root, &node->node);
+}
+
+/**
+ * rb_str_node - get the string-keyed node of a linked rb_node.
+ * @ptr: the &struct rb_node pointer.
+ */
+#define rb_str_node(ptr) \
+    rb_entry(ptr, struct rb_node_str, node)
+
+/**
+ * rb_str_node_safe - get the string-keyed node of a linked rb_node or null.
+ * @ptr: the &struct rb_node pointer.
+ */
+#define rb_str_node_safe(ptr) \
+    rb_entry_safe(ptr, struct rb_node_str, node)
+
+/**
+ * rb_str_prefix - get the cached prefix of a string key.
+ * @key: key bytes.
+ * @length: number of bytes in @key.
+ */
+static inline uint64_t rb_str_prefix(const char *key, size_t length)
+{
+    uint64_t prefix = 0;
+
+    memcpy(&prefix, key, length < sizeof(prefix) ? length : sizeof(prefix));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    prefix = __builtin_bswap64(prefix);
+#endif
+
+    return prefix;
+}
+
+/**
+ * rb_str_init - set the key of a string-keyed node.
+ * @node: node to set up, not linked.
+ * @key: key bytes, referenced for as long as @node is linked.
+ * @length: number of bytes in @key.
+ */
+static inline void rb_str_init(struct rb_node_str *node, const char *key, size_t length)
+{
+    node->prefix = rb_str_prefix(key, length);
+    node->key = key;
+    node->length = length;
+}
+
+/**
+ * rb_str_compare - compare a key with a string-keyed node.
+ * @node: node to compare with.
+ * @prefix: cached prefix of @key.
+ * @key: key bytes.
+ * @length: number of bytes in @key.
+ *
+ * Returns the sign of @key minus the key of @node; the key bytes are
+ * only read when the prefixes tie.
+ */
+static inline int rb_str_compare(const struct rb_node_str *node, uint64_t prefix,
+                                 const char *key, size_t length)
+{
+    size_t common;
+    int retval;
+
+    if (likely(prefix != node->prefix))
+        return prefix < node->prefix ? -1 : 1;
+
+    /* equal prefixes mean equal leading bytes, up to eight of them */
+    common = length < node->length ? length : node->length;
+    if (common > sizeof(prefix) &&
+        (retval = memcmp(key + sizeof(prefix), node->key + sizeof(prefix),
+                         common - sizeof(prefix))))
+        return retval;
+
+    return length < node->length ? -1 : length > node->length;
+}
+
+/**
+ * rb_str_insert - insert a string-keyed node after all nodes with an equal key.
+ * @root: rbtree root of node.
+ * @node: new node to insert, set up by rb_str_init().
+ */
+static inline void rb_str_insert(struct rb_root *root, struct rb_node_str *node)
+{
+    struct rb_node *parent = NULL, **link = &root->node;
+
+    while (*link) {
+        parent = *link;
+        if (rb_str_compare(rb_str_node(parent), node->prefix, node->key, node->length) < 0)
+            link = &parent->left;
+        else
+            link = &parent->right;
+    }
+
+    rb_insert_node(root, parent, link, &node->node);
+}
+
+/**
+ * rb_str_find - find a string-keyed node with a key.
+ * @root: rbtree root of node.
+ * @key: key bytes.
+ * @length: number of bytes in @key.
+ */
+static inline struct rb_node_str *rb_str_find(const struct rb_root *root, const char *key, size_t length)
+{
+    uint64_t prefix = rb_str_prefix(key, length);
+    struct rb_node *node = root->node;
+    int retval;
+
+    while (node) {
+        retval = rb_str_compare(rb_str_node(node), prefix, key, length);
+        if (!retval)
+            return rb_str_node(node);
+        node = retval < 0 ? node->left : node->right;
+    }
+
+    return NULL;
+}
+
+/**
+ * rb_str_lower_bound - find the first string-keyed node not less than @key.
+ * @root: rbtree root of node.
+ * @key: key bytes.
+ * @length: number of bytes in @key.
+ */
+static inline struct rb_node_str *rb_str_lower_bound(const struct rb_root *root, const char *key, size_t length)
+{
+    uint64_t prefix = rb_str_prefix(key, length);
+    struct rb_node *node = root->node, *match = NULL;
+
+    while (node) {
+        if (rb_str_compare(rb_str_node(node), prefix, key, length) <= 0) {
+            match = node;
+            node = node->left;
+        } else
+            node = node->right;
+    }
+
+    return rb_str_node_safe(match);
+}
+
+/**
+ * rb_str_delete - delete a string-keyed node and fixup rbtree.
+ * @root: rbtree root of node.
+ * @node: node to delete.
+ */
+static inline void rb_str_delete(struct rb_root *root, struct rb_node_str *node)
+{
+    rb_delete(root, &node->node);
+}
+
 /**
  * rb_cached_first - get the first rb_node from a cached rbtree.
  * @cached: the rbtree root to take the rb_node from.
@@ -787,8 +1241,10 @@ static inline void rb_cached_insert(struct rb_root_cached *cached, struct rb_nod
     struct rb_node *parent, **link;
     bool leftmost = true;
 
+    rb_probe2(insert__entry, &cached->root, node);
     link = rb_cached_parent(cached, &parent, node, cmp, &leftmost);
     rb_cached_insert_node(cached, parent, link, node, leftmost);
+    rb_probe2(insert__return, &cached->root, node);
 }
 
 /**
@@ -810,6 +1266,23 @@ static inline bool rb_cached_insert_conflict(struct rb_root_cached *cached, stru
     return false;
 }
 
+/**
+ * rb_cached_insert_hint - find the parent node from a nearby node and insert new cached node.
+ * @cached: rbtree cached root of node.
+ * @node: new node to insert.
+ * @hint: node ordered before or equal to @node, or NULL.
+ * @cmp: operator defining the node order.
+ */
+static inline void rb_cached_insert_hint(struct rb_root_cached *cached, struct rb_node *node,
+                                         struct rb_node *hint, rb_cmp_t cmp)
+{
+    struct rb_node *parent, **link;
+    bool leftmost = true;
+
+    link = rb_cached_parent_hint(cached, &parent, node, hint, cmp, &leftmost);
+    rb_cached_insert_node(cached, parent, link, node, leftmost);
+}
+
 /**
  * rb_cached_delete - delete cached node and fixup rbtree.
  * @cached: rbtree cached root of node.
@@ -915,6 +1388,68 @@ static inline struct rb_node *rb_cached_delete_augmented(struct rb_root_cached *
     return leftmost;
 }
 
+/**
+ * rb_cached_build - build a balanced cached rbtree from sorted nodes.
+ * @cached: empty rbtree cached root to build into.
+ * @nodes: nodes sorted in ascending order.
+ * @count: number of nodes.
+ */
+static inline void rb_cached_build(struct rb_root_cached *cached, struct rb_node **nodes,
+                                   unsigned long count)
+{
+    cached->leftmost = count ? nodes[0] : NULL;
+    rb_build(&cached->root, nodes, count);
+}
+
+/**
+ * rb_cached_parallel_build - build a balanced cached rbtree with threads.
+ * @cached: empty rbtree cached root to build into.
+ * @nodes: nodes sorted in ascending order.
+ * @count: number of nodes.
+ * @threads: number of threads to use, including the caller.
+ */
+static inline void rb_cached_parallel_build(struct rb_root_cached *cached, struct rb_node **nodes,
+                                            unsigned long count, unsigned int threads)
+{
+    cached->leftmost = count ? nodes[0] : NULL;
+    rb_parallel_build(&cached->root, nodes, count, threads);
+}
+
+/**
+ * rb_cached_relayout - copy a cached tree into an arena in cache friendly order.
+ * @cached: rbtree cached root, relinked to the copies.
+ * @arena: memory for one container per node, @node_size apart.
+ * @node_size: size of each container.
+ * @offset: offset of the rb_node within the container.
+ * @layout: RB_LAYOUT_VEB or RB_LAYOUT_BLOCKED.
+ * @relocate: called with the old and new container of every node, or NULL.
+ * @pdata: private data passed to @relocate.
+ */
+static inline int rb_cached_relayout(struct rb_root_cached *cached, void *arena, size_t node_size, size_t offset,
+                                     unsigned int layout, rb_relocate_t relocate, void *pdata)
+{
+    int retval;
+
+    retval = rb_relayout(&cached->root, arena, node_size, offset, layout, relocate, pdata);
+    if (!retval)
+        cached->leftmost = rb_first(&cached->root);
+
+    return retval;
+}
+
+/**
+ * rb_relayout_entries - copy a tree of given type into an arena.
+ * @root: rbtree root, relinked to the copies.
+ * @arena: array of containers, one per node.
+ * @type: the type of the struct the rb_node is embedded in.
+ * @member: the name of the rb_node within the struct.
+ * @layout: RB_LAYOUT_VEB or RB_LAYOUT_BLOCKED.
+ * @relocate: called with the old and new container of every node, or NULL.
+ * @pdata: private data passed to @relocate.
+ */
+#define rb_relayout_entries(root, arena, type, member, layout, relocate, pdata) \
+    rb_relayout(root, arena, sizeof(type), offsetof(type, member), layout, relocate, pdata)
+
 /**
  * rb_cached_replace - replace old cached node by new cached one.
  * @root: rbtree root of node.
@@ -0,0 +1,525 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2021-2022 John Sanpe <sanpeqf@gmail.com>
+ *          -- Based on Linux's rbtree :)
+ */
+
+/*
+ * Rebalancing core shared by the rbtree variants.
+ *
+ * This file has no include guard; it is included once by each tree
+ * implementation, which first describes its node layout:
+ *
+ *   CORE_ROOT        tree root type
+ *   CORE_NODE        node handle type (a pointer or an index)
+ *   CORE_NIL         handle of a missing node, false in conditions
+ *   CORE_CALLBACKS   augmented callback type
+ *   CORE_ROTATE(callbacks, node, successor)
+ *   CORE_COPY(callbacks, node, successor)
+ *   CORE_PROPAGATE(callbacks, node, stop)
+ *
+ * and the accessors core_{parent,color}(root, node),
+ * core_child(root, node, dir), core_set_{parent,color}(root, node,
+ * value), core_set_child(root, node, dir, value) and
+ * core_set_root(root, node), where dir is RB_LEFT or RB_RIGHT.
+ * An includer keeping operation counts also defines
+ * core_stat(field, value) for the fields of struct rb_stats, and one
+ * exporting tracepoints core_probe(name, node, levels, rotations).
+ *
+ * The mirrored halves of the rebalancing cases are written once in
+ * terms of a direction index, which halves the code on the hot path.
+ */
+
+typedef CORE_NODE core_node_t;
+
+#ifndef core_stat
+# define core_stat(field, value) ((void)0)
+#endif
+
+#ifndef core_probe
+# define core_probe(name, node, levels, rotations) \
+    ((void)(node), (void)(levels), (void)(rotations))
+#endif
+
+#define core_left(root, node)               core_child(root, node, RB_LEFT)
+#define core_right(root, node)              core_child(root, node, RB_RIGHT)
+#define core_set_left(root, node, value)    core_set_child(root, node, RB_LEFT, value)
+#define core_set_right(root, node, value)   core_set_child(root, node, RB_RIGHT, value)
+
+/**
+ * core_child_change - replace old child by new one.
+ * @root: rbtree root of node.
+ * @parent: parent to change child.
+ * @old: node to be replaced.
+ * @new: new node to insert.
+ */
+static __always_inline void
+core_child_change(CORE_ROOT *root, core_node_t parent,
+                  core_node_t old, core_node_t new)
+{
+    if (!parent)
+        core_set_root(root, new);
+    else
+        core_set_child(root, parent, core_right(root, parent) == old, new);
+}
+
+/**
+ * core_rotate_set - replace old child by new one.
+ * @root: rbtree root of node.
+ * @node: parent to change child.
+ * @new: node to be replaced.
+ * @child: managed child node.
+ * @color: color after rotation.
+ * @ccolor: color of child.
+ * @callbacks: augmented callback function.
+ */
+static __always_inline void
+core_rotate_set(CORE_ROOT *root, core_node_t node, core_node_t new,
+                core_node_t child, unsigned int color, unsigned int ccolor,
+                const CORE_CALLBACKS *callbacks)
+{
+    core_node_t parent = core_parent(root, node);
+
+    core_set_parent(root, new, parent);
+    core_set_parent(root, node, new);
+
+    if (color != RB_NSET) {
+        core_set_color(root, new, core_color(root, node));
+        core_set_color(root, node, color);
+    }
+
+    if (child) {
+        if (ccolor != RB_NSET)
+            core_set_color(root, child, ccolor);
+        core_set_parent(root, child, node);
+    }
+
+    core_child_change(root, parent, node, new);
+    CORE_ROTATE(callbacks, node, new);
+}
+
+/**
+ * core_rotate - rotate one node towards a direction.
+ * @root: rbtree root of node.
+ * @node: node to rotation.
+ * @dir: RB_LEFT for a left rotation, RB_RIGHT for a right one.
+ * @color: color after rotation.
+ * @ccolor: color of child.
+ * @callbacks: augmented callback function.
+ */
+static __always_inline core_node_t
+core_rotate(CORE_ROOT *root, core_node_t node, unsigned int dir,
+            unsigned int color, unsigned int ccolor,
+            const CORE_CALLBACKS *callbacks)
+{
+    core_node_t child, successor = core_child(root, node, !dir);
+
+    core_stat(rotations, 1);
+
+    /* change the inner child of successor */
+    child = core_child(root, successor, dir);
+    core_set_child(root, node, !dir, child);
+    core_set_child(root, successor, dir, node);
+
+    core_rotate_set(root, node, successor, child, color, ccolor, callbacks);
+    return child;
+}
+
+/**
+ * core_left_rotate - left rotation one node.
+ * @root: rbtree root of node.
+ * @node: node to rotation.
+ * @color: color after rotation.
+ * @ccolor: color of child.
+ * @callbacks: augmented callback function.
+ */
+static __always_inline core_node_t
+core_left_rotate(CORE_ROOT *root, core_node_t node,
+                 unsigned int color, unsigned int ccolor,
+                 const CORE_CALLBACKS *callbacks)
+{
+    return core_rotate(root, node, RB_LEFT, color, ccolor, callbacks);
+}
+
+/**
+ * core_right_rotate - right rotation one node.
+ * @root: rbtree root of node.
+ * @node: node to rotation.
+ * @color: color after rotation.
+ * @ccolor: color of child.
+ * @callbacks: augmented callback function.
+ */
+static __always_inline core_node_t
+core_right_rotate(CORE_ROOT *root, core_node_t node,
+                  unsigned int color, unsigned int ccolor,
+                  const CORE_CALLBACKS *callbacks)
+{
+    return core_rotate(root, node, RB_RIGHT, color, ccolor, callbacks);
+}
+
+/**
+ * core_fixup - balance after insert node.
+ * @root: rbtree root of node.
+ * @node: new inserted node.
+ * @callbacks: augmented callback function.
+ */
+static __always_inline void
+core_fixup(CORE_ROOT *root, core_node_t node, const CORE_CALLBACKS *callbacks)
+{
+    core_node_t parent, gparent, tmp;
+    unsigned int dir, levels = 0;
+
+    while (root && node) {
+        parent = core_parent(root, node);
+
+        /*
+         * The inserted node is root. Either this is the
+         * first node, or we recursed at Case 1 below and
+         * are no longer violating 4).
+         */
+
+        if (unlikely(!parent)) {
+            core_set_color(root, node, RB_BLACK);
+            break;
+        }
+
+        /*
+         * If there is a black parent, we are done.
+         * Otherwise, take some corrective action as,
+         * per 4), we don't want a red root or two
+         * consecutive red nodes.
+         */
+
+        if (core_color(root, parent) == RB_BLACK)
+            break;
+
+        /*
+         * The pictures show parent as the left child of
+         * gparent, dir selects the mirrored case as well.
+         */
+
+        gparent = core_parent(root, parent);
+        dir = core_right(root, gparent) == parent;
+        tmp = core_child(root, gparent, !dir);
+
+        /*
+         * Case 1 - node's uncle is red (color flips).
+         *
+         *       G            g
+         *      / \          / \
+         *     p   t  -->   P   T
+         *    /            /
+         *   n            n
+         *
+         * However, since g's parent might be red, and
+         * 4) does not allow this, we need to recurse
+         * at g.
+         */
+
+        if (tmp && core_color(root, tmp) == RB_RED) {
+            core_stat(recolors, 1);
+            core_set_color(root, parent, RB_BLACK);
+            core_set_color(root, tmp, RB_BLACK);
+            core_set_color(root, gparent, RB_RED);
+            node = gparent;
+            levels++;
+            continue;
+        }
+
+        /*
+         * Case 2 - node's uncle is black and node is
+         * the parent's inner child (rotate at parent).
+         *
+         *      G             G
+         *     / \           / \
+         *    p   U  -->    n   U
+         *     \           /
+         *      n         p
+         *     /           \
+         *    c             C
+         *
+         * This still leaves us in violation of 4), the
+         * continuation into Case 3 will fix that.
+         */
+
+        core_probe(fixup__rotate, gparent, levels,
+                   node == core_child(root, parent, !dir) ? 2 : 1);
+
+        if (node == core_child(root, parent, !dir))
+            core_rotate(root, parent, dir, RB_NSET, RB_BLACK, callbacks);
+
+        /*
+         * Case 3 - node's uncle is black and node is
+         * the parent's outer child (rotate at gparent).
+         *
+         *        G           P
+         *       / \         / \
+         *      p   U  -->  n   g
+         *     / \             / \
+         *    n   s           S   U
+         */
+
+        core_rotate(root, gparent, !dir, RB_RED, RB_BLACK, callbacks);
+        break;
+    }
+}
+
+/**
+ * core_erase - balance after remove node.
+ * @root: rbtree root of node.
+ * @parent: parent of removed node.
+ * @callbacks: augmented callback function.
+ */
+static __always_inline void
+core_erase(CORE_ROOT *root, core_node_t parent, const CORE_CALLBACKS *callbacks)
+{
+    core_node_t tmp1, tmp2, sibling, node = CORE_NIL;
+    unsigned int dir, levels = 0, rotations = 0;
+
+    while (root && parent) {
+        /*
+         * Loop invariants:
+         * - node is black (or NULL on first iteration)
+         * - node is not the root (parent is not NULL)
+         * - All leaf paths going through parent and node have a
+         *   black node count that is 1 lower than other leaf paths.
+         *
+         * The pictures show node as the left child of parent,
+         * dir selects the mirrored case as well.
+         */
+
+        dir = core_right(root, parent) == node;
+        sibling = core_child(root, parent, !dir);
+
+        /*
+         * Case 1 - rotate at parent
+         *
+         *     P               S
+         *    / \             / \
+         *   N   s    -->    p   Sr
+         *      / \         / \
+         *     Sl  Sr      N   Sl
+         */
+
+        if (core_color(root, sibling) == RB_RED) {
+            sibling = core_rotate(root, parent, dir, RB_RED, RB_BLACK, callbacks);
+            rotations++;
+        }
+
+        tmp2 = core_child(root, sibling, !dir);
+        if (!tmp2 || core_color(root, tmp2) == RB_BLACK) {
+            tmp1 = core_child(root, sibling, dir);
+
+            /*
+             * Case 2 - sibling color flip
+             * (p could be either color here)
+             *
+             *    (p)           (p)
+             *    / \           / \
+             *   N   S    -->  N   s
+             *      / \           / \
+             *     Sl  Sr        Sl  Sr
+             *
+             * This leaves us violating 5) which
+             * can be fixed by flipping p to black
+             * if it was red, or by recursing at p.
+             * p is red when coming from Case 1.
+             */
+
+            if (!tmp1 || core_color(root, tmp1) == RB_BLACK) {
+                core_stat(recolors, 1);
+                core_set_color(root, sibling, RB_RED);
+                if (core_color(root, parent) == RB_RED)
+                    core_set_color(root, parent, RB_BLACK);
+                else {
+                    node = parent;
+                    parent = core_parent(root, node);
+                    levels++;
+                    if (parent)
+                        continue;
+                }
+                break;
+            }
+
+            /*
+             * Case 3 - rotate at sibling
+             * (p could be either color here)
+             *
+             *   (p)           (p)
+             *   / \           / \
+             *  N   S    -->  N   sl
+             *     / \             \
+             *    sl  Sr            S
+             *      \              / \
+             *       t            T   Sr
+             *
+             * Note: p might be red, and then both
+             * p and sl are red after rotation(which
+             * breaks property 4). This is fixed in
+             * Case 4 (in __rb_rotate_set_parents()
+             *         which set sl the color of p
+             *         and set p RB_BLACK)
+             *
+             *   (p)            (sl)
+             *   / \            /  \
+             *  N   sl   -->   P    S
+             *       \        /      \
+             *        S      N        Sr
+             *         \
+             *          Sr
+             */
+
+            core_rotate(root, sibling, !dir, RB_NSET, RB_BLACK, callbacks);
+            tmp2 = sibling;
+            rotations++;
+        }
+
+        /*
+         * Case 4 - rotate at parent + color flips
+         * (p and sl could be either color here.
+         *  After rotation, p becomes black, s acquires
+         *  p's color, and sl keeps its color)
+         *
+         *      (p)             (s)
+         *      / \             / \
+         *     N   S     -->   P   Sr
+         *        / \         / \
+         *      (sl) sr      N  (sl)
+         */
+
+        core_rotate(root, parent, dir, RB_BLACK, RB_NSET, callbacks);
+        core_set_color(root, tmp2, RB_BLACK);
+        rotations++;
+        break;
+    }
+
+    core_probe(erase__cascade, parent ? parent : node, levels, rotations);
+}
+
+/**
+ * core_remove - remove node form rbtree.
+ * @root: rbtree root of node.
+ * @node: node to remove.
+ * @callbacks: augmented callback function.
+ *
+ * Returns the node to rebalance from, or CORE_NIL.
+ */
+static __always_inline core_node_t
+core_remove(CORE_ROOT *root, core_node_t node, const CORE_CALLBACKS *callbacks)
+{
+    core_node_t parent = core_parent(root, node), rebalance = CORE_NIL;
+    core_node_t child1 = core_left(root, node);
+    core_node_t child2 = core_right(root, node);
+
+    if (!child1 && !child2) {
+        /*
+         * Case 1: node to erase has no child.
+         *
+         *     (p)        (p)
+         *     / \          \
+         *   (n) (s)  ->    (s)
+         *
+         */
+
+        if (core_color(root, node) == RB_BLACK)
+            rebalance = parent;
+        core_child_change(root, parent, node, CORE_NIL);
+    } else if (!child2) {
+        /*
+         * Case 1: node to erase only has left child.
+         *
+         *      (p)          (p)
+         *      / \          / \
+         *    (n) (s)  ->  (c) (s)
+         *    /
+         *  (c)
+         *
+         */
+
+        core_set_color(root, child1, core_color(root, node));
+        core_set_parent(root, child1, parent);
+        core_child_change(root, parent, node, child1);
+    } else if (!child1) {
+        /*
+         * Case 1: node to erase only has right child.
+         *
+         *    (p)          (p)
+         *    / \          / \
+         *  (n) (s)  ->  (c) (s)
+         *    \
+         *    (c)
+         */
+
+        core_set_color(root, child2, core_color(root, node));
+        core_set_parent(root, child2, parent);
+        core_child_change(root, parent, node, child2);
+    } else { /* child1 && child2 */
+        core_node_t tmp, successor = child2;
+
+        child1 = core_left(root, child2);
+        if (!child1) {
+            /*
+             * Case 2: node's successor is its right child
+             *
+             *    (n)          (s)
+             *    / \          / \
+             *  (x) (s)  ->  (x) (c)
+             *        \
+             *        (c)
+             */
+
+            parent = successor;
+            tmp = core_right(root, successor);
+            CORE_COPY(callbacks, node, successor);
+        } else {
+            /*
+             * Case 3: node's successor is leftmost under
+             * node's right child subtree
+             *
+             *    (n)          (s)
+             *    / \          / \
+             *  (x) (y)  ->  (x) (y)
+             *      /            /
+             *    (p)          (p)
+             *    /            /
+             *  (s)          (c)
+             *    \
+             *    (c)
+             */
+
+            do {
+                parent = successor;
+                successor = child1;
+                child1 = core_left(root, child1);
+            } while (child1);
+
+            tmp = core_right(root, successor);
+            core_set_left(root, parent, tmp);
+            core_set_right(root, successor, child2);
+            core_set_parent(root, child2, successor);
+
+            CORE_COPY(callbacks, node, successor);
+            CORE_PROPAGATE(callbacks, parent, successor);
+        }
+
+        child1 = core_left(root, node);
+        core_set_left(root, successor, child1);
+        core_set_parent(root, child1, successor);
+
+        child1 = core_parent(root, node);
+        core_child_change(root, child1, node, successor);
+
+        if (tmp) {
+            core_set_parent(root, tmp, parent);
+            core_set_color(root, tmp, RB_BLACK);
+        } else if (core_color(root, successor) == RB_BLACK)
+            rebalance = parent;
+
+        core_set_parent(root, successor, child1);
+        core_set_color(root, successor, core_color(root, node));
+        parent = successor;
+    }
+
+    CORE_PROPAGATE(callbacks, parent, CORE_NIL);
+    return rebalance;
+}
@@ -0,0 +1,221 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+
+#define pending_entry(relaxed, index) \
+    ((relaxed)->pending[((relaxed)->head + (index)) % (relaxed)->capacity])
+
+/**
+ * pending_trim - drop the holes at both ends of the pending ring.
+ * @relaxed: relaxed rbtree root.
+ *
+ * Every slot is dropped once, and afterwards the ring is either empty
+ * or starts and ends with a live entry.
+ */
+static void pending_trim(struct rb_relaxed *relaxed)
+{
+    while (relaxed->used && !pending_entry(relaxed, 0)) {
+        relaxed->head = (relaxed->head + 1) % relaxed->capacity;
+        relaxed->used--;
+    }
+
+    while (relaxed->used && !pending_entry(relaxed, relaxed->used - 1))
+        relaxed->used--;
+}
+
+/**
+ * pending_push - record a deferred insertion as the newest.
+ * @relaxed: relaxed rbtree root.
+ * @node: node to record.
+ */
+static void pending_push(struct rb_relaxed *relaxed, struct rb_relaxed_node *node)
+{
+    unsigned long slot = (relaxed->head + relaxed->used) % relaxed->capacity;
+
+    relaxed->pending[slot] = node;
+    node->pending = slot + 1;
+    relaxed->used++;
+    relaxed->count++;
+}
+
+/**
+ * pending_remove - forget a deferred insertion.
+ * @relaxed: relaxed rbtree root.
+ * @node: node to forget.
+ *
+ * The node knows its slot, which is left as a hole rather than
+ * refilled, so the ring stays ordered oldest first.
+ */
+static bool pending_remove(struct rb_relaxed *relaxed, struct rb_relaxed_node *node)
+{
+    if (!node->pending)
+        return false;
+
+    relaxed->pending[node->pending - 1] = NULL;
+    node->pending = 0;
+    relaxed->count--;
+    pending_trim(relaxed);
+
+    return true;
+}
+
+/**
+ * pending_pop - take the oldest deferred insertion.
+ * @relaxed: relaxed rbtree root.
+ *
+ * The oldest insertions sit highest in a chain of red nodes, so
+ * fixing them first keeps every fixup short.
+ */
+static struct rb_node *pending_pop(struct rb_relaxed *relaxed)
+{
+    struct rb_relaxed_node *node = pending_entry(relaxed, 0);
+
+    pending_entry(relaxed, 0) = NULL;
+    node->pending = 0;
+    relaxed->count--;
+    pending_trim(relaxed);
+
+    return &node->node;
+}
+
+/**
+ * remove_is_local - check whether removing node needs no balancing.
+ * @node: node to remove.
+ *
+ * rb_remove() relies on a balanced tree only when it recolors a
+ * child to restore the black height or asks for a rebalance. Any
+ * other removal is safe while insertions are still pending.
+ */
+static bool remove_is_local(struct rb_node *node)
+{
+    struct rb_node *successor;
+
+    if (!node->left && !node->right)
+        return node->color == RB_RED;
+
+    if (!node->left || !node->right)
+        return true;
+
+    successor = rb_left_far(node->right);
+    if (successor->right)
+        return successor->color == RB_BLACK;
+
+    return successor->color == RB_RED;
+}
+
+/**
+ * rb_relaxed_init - initialize a relaxed rbtree.
+ * @relaxed: relaxed rbtree root.
+ * @pending: array recording deferred insertions.
+ * @capacity: number of entries in @pending.
+ */
+void rb_relaxed_init(struct rb_relaxed *relaxed, struct rb_relaxed_node **pending,
+                     unsigned long capacity)
+{
+    relaxed->root = RB_INIT;
+    relaxed->pending = pending;
+    relaxed->capacity = capacity;
+    relaxed->head = 0;
+    relaxed->used = 0;
+    relaxed->count = 0;
+    relaxed->nodes = 0;
+}
+
+/**
+ * rb_relaxed_insert - link new node and defer balancing.
+ * @relaxed: relaxed rbtree root.
+ * @node: new node to insert.
+ * @cmp: operator defining the node order.
+ *
+ * Only a red parent is a violation. When the pending array is full
+ * the oldest deferred insertion is balanced to make room. Nodes of a
+ * relaxed tree must all be linked through here, which clears the
+ * pending slot they carry.
+ */
+void rb_relaxed_insert(struct rb_relaxed *relaxed, struct rb_relaxed_node *node, rb_cmp_t cmp)
+{
+    struct rb_node *parent, **link;
+
+    link = rb_parent(&relaxed->root, &parent, &node->node, cmp, NULL);
+    rb_link(parent, link, &node->node);
+    node->pending = 0;
+    relaxed->nodes++;
+
+    if (!parent)
+        node->node.color = RB_BLACK;
+    else if (parent->color == RB_RED) {
+        if (unlikely(!relaxed->capacity)) {
+            rb_relaxed_fixup(&relaxed->root, &node->node);
+            return;
+        }
+
+        /* holes count against the capacity until they reach an end */
+        if (relaxed->used == relaxed->capacity)
+            rb_relaxed_fixup(&relaxed->root, pending_pop(relaxed));
+
+        pending_push(relaxed, node);
+    }
+}
+
+/**
+ * rb_relaxed_delete - unlink node, balancing only if unavoidable.
+ * @relaxed: relaxed rbtree root.
+ * @node: node to delete.
+ *
+ * A removal that has to restore the black height cannot run while
+ * red-red violations are pending, so the whole ring is settled
+ * first; the deficit is not queued like an insertion. Each such
+ * delete therefore ends the deferral of the inserts before it.
+ */
+void rb_relaxed_delete(struct rb_relaxed *relaxed, struct rb_relaxed_node *node)
+{
+    bool pending;
+
+    if (relaxed->count) {
+        /* a successor taking the place of a pending node would inherit its violation */
+        pending = pending_remove(relaxed, node);
+        if ((pending && node->node.left && node->node.right) || !remove_is_local(&node->node))
+            rb_rebalance_pending(relaxed, RB_REBALANCE_ALL);
+    }
+
+    rb_delete(&relaxed->root, &node->node);
+    relaxed->nodes--;
+}
+
+/**
+ * rb_rebalance_pending - balance deferred insertions.
+ * @relaxed: relaxed rbtree root.
+ * @budget: maximum number of deferred insertions to balance.
+ *
+ * Returns the number of insertions still pending.
+ */
+unsigned long rb_rebalance_pending(struct rb_relaxed *relaxed, unsigned long budget)
+{
+    while (relaxed->count && budget--)
+        rb_relaxed_fixup(&relaxed->root, pending_pop(relaxed));
+
+    return relaxed->count;
+}
+
+/**
+ * rb_relaxed_height_bound - upper bound of the tree height.
+ * @relaxed: relaxed rbtree root.
+ *
+ * A balanced tree is at most 2 * log2(n + 1) high, and every pending
+ * violation adds at most one red node to a path.
+ */
+unsigned int rb_relaxed_height_bound(const struct rb_relaxed *relaxed)
+{
+    unsigned long nodes = relaxed->nodes + 1;
+    unsigned int bits = 0;
+
+    while (nodes) {
+        nodes >>= 1;
+        bits++;
+    }
+
+    return 2 * bits + relaxed->count;
+}
@@ -0,0 +1,206 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "rbtree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define RELAYOUT_BLOCK_SIZE 4096
+
+struct relayout_state {
+    struct rb_node **order;
+    unsigned long count;
+};
+
+/**
+ * relayout_height - number of levels of a subtree.
+ * @node: subtree root.
+ */
+static unsigned int relayout_height(const struct rb_node *node)
+{
+    unsigned int left, right;
+
+    if (!node)
+        return 0;
+
+    left = relayout_height(node->left);
+    right = relayout_height(node->right);
+
+    return (left > right ? left : right) + 1;
+}
+
+static void veb_emit(struct relayout_state *state, struct rb_node *node, unsigned int height);
+
+/**
+ * veb_frontier - lay out the subtrees hanging below a top tree.
+ * @state: layout in progress.
+ * @node: node of the top tree.
+ * @depth: levels left to the frontier.
+ * @height: levels of each bottom tree.
+ */
+static void veb_frontier(struct relayout_state *state, struct rb_node *node,
+                         unsigned int depth, unsigned int height)
+{
+    if (!node)
+        return;
+
+    if (!depth) {
+        veb_emit(state, node, height);
+        return;
+    }
+
+    veb_frontier(state, node->left, depth - 1, height);
+    veb_frontier(state, node->right, depth - 1, height);
+}
+
+/**
+ * veb_emit - lay out a subtree in van Emde Boas order.
+ * @state: layout in progress.
+ * @node: subtree root.
+ * @height: levels of the subtree to lay out.
+ *
+ * The top half of the levels is laid out first, followed by every
+ * bottom subtree, each recursively, so any root-to-leaf path touches
+ * O(log_B n) blocks whatever the block size B is.
+ */
+static void veb_emit(struct relayout_state *state, struct rb_node *node, unsigned int height)
+{
+    unsigned int top;
+
+    if (!node)
+        return;
+
+    if (height == 1) {
+        state->order[state->count++] = node;
+        return;
+    }
+
+    top = height / 2;
+    veb_emit(state, node, top);
+    veb_frontier(state, node, top, height - top);
+}
+
+/**
+ * blocked_emit - lay out a tree in breadth-first blocked order.
+ * @state: layout in progress.
+ * @roots: queue of block roots, as long as the tree.
+ * @node: tree root.
+ * @height: levels of each block.
+ *
+ * The tree is cut into subtrees of @height levels that fill about
+ * one page. Blocks are laid out breadth-first, and the nodes inside
+ * each block breadth-first as well.
+ */
+static void blocked_emit(struct relayout_state *state, struct rb_node **roots,
+                         struct rb_node *node, unsigned int height)
+{
+    unsigned long head = 0, tail = 0, begin, end, index;
+    struct rb_node **order = state->order, *walk;
+    unsigned int level;
+
+    roots[tail++] = node;
+    while (head < tail) {
+        begin = state->count;
+        order[state->count++] = roots[head++];
+
+        for (level = 1; level <= height; ++level) {
+            end = state->count;
+            for (index = begin; index < end; ++index) {
+                walk = order[index];
+                /* children of the last level start new blocks */
+                if (level == height) {
+                    if (walk->left)
+                        roots[tail++] = walk->left;
+                    if (walk->right)
+                        roots[tail++] = walk->right;
+                } else {
+                    if (walk->left)
+                        order[state->count++] = walk->left;
+                    if (walk->right)
+                        order[state->count++] = walk->right;
+                }
+            }
+            begin = end;
+        }
+    }
+}
+
+/**
+ * rb_relayout - copy a tree into an arena in cache friendly order.
+ * @root: rbtree root, relinked to the copies.
+ * @arena: memory for one container per node, @node_size apart.
+ * @node_size: size of each container.
+ * @offset: offset of the rb_node within the container.
+ * @layout: RB_LAYOUT_VEB or RB_LAYOUT_BLOCKED.
+ * @relocate: called with the old and new container of every node, or NULL.
+ * @pdata: private data passed to @relocate.
+ *
+ * Every container is copied whole, so augmented data moves along.
+ * Once @relocate is called the tree only references the copies; the
+ * old containers keep their payload but not their links, and can be
+ * freed. Returns -ENOMEM if the order array cannot be allocated, in
+ * which case the tree is left untouched.
+ */
+int rb_relayout(struct rb_root *root, void *arena, size_t node_size, size_t offset,
+                unsigned int layout, rb_relocate_t relocate, void *pdata)
+{
+    struct relayout_state state = {};
+    struct rb_node *node, **roots = NULL;
+    unsigned long count = 0, index;
+    unsigned int height, blocks;
+    char *base = arena;
+
+    rb_for_each(node, root)
+        count++;
+
+    if (!count)
+        return 0;
+
+    state.order = malloc(sizeof(*state.order) * count);
+    if (layout == RB_LAYOUT_BLOCKED)
+        roots = malloc(sizeof(*roots) * count);
+
+    if (!state.order || (layout == RB_LAYOUT_BLOCKED && !roots)) {
+        free(state.order);
+        free(roots);
+        return -ENOMEM;
+    }
+
+    if (layout == RB_LAYOUT_BLOCKED) {
+        blocks = RELAYOUT_BLOCK_SIZE / node_size + 1;
+        for (height = 1; (2U << height) <= blocks; ++height);
+        blocked_emit(&state, roots, root->node, height);
+        free(roots);
+    } else
+        veb_emit(&state, root->node, relayout_height(root->node));
+
+    for (index = 0; index < count; ++index)
+        memcpy(base + index * node_size, (char *)state.order[index] - offset, node_size);
+
+    /* old parent links are no longer needed, reuse them as forwarding */
+    for (index = 0; index < count; ++index)
+        state.order[index]->parent = (struct rb_node *)(base + index * node_size + offset);
+
+    for (index = 0; index < count; ++index) {
+        node = (struct rb_node *)(base + index * node_size + offset);
+        if (node->parent)
+            node->parent = node->parent->parent;
+        if (node->left)
+            node->left = node->left->parent;
+        if (node->right)
+            node->right = node->right->parent;
+    }
+
+    root->node = root->node->parent;
+
+    if (relocate) {
+        for (index = 0; index < count; ++index)
+            relocate((char *)state.order[index] - offset, base + index * node_size, pdata);
+    }
+
+    free(state.order);
+    return 0;
+}
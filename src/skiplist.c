@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "skiplist.h"
+#include <stdint.h>
+
+#define SL_MARK 1UL
+
+static __always_inline bool is_marked(struct sl_node *node)
+{
+    return (uintptr_t)node & SL_MARK;
+}
+
+static __always_inline struct sl_node *marked(struct sl_node *node)
+{
+    return (struct sl_node *)((uintptr_t)node | SL_MARK);
+}
+
+static __always_inline struct sl_node *unmarked(struct sl_node *node)
+{
+    return (struct sl_node *)((uintptr_t)node & ~SL_MARK);
+}
+
+static __always_inline struct sl_node *load_next(const struct sl_node *node, unsigned int level)
+{
+    return __atomic_load_n(&node->next[level], __ATOMIC_ACQUIRE);
+}
+
+static __always_inline bool
+cas_next(struct sl_node *node, unsigned int level, struct sl_node *old, struct sl_node *new)
+{
+    return __atomic_compare_exchange_n(&node->next[level], &old, new, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * sl_random_level - pick a level with probability 1/4 per extra level.
+ * @max: highest level the node has room for.
+ */
+unsigned int sl_random_level(unsigned int max)
+{
+    static __thread unsigned long seed;
+    unsigned int level = 1;
+    unsigned long value;
+
+    if (unlikely(!seed))
+        seed = (uintptr_t)&seed | 1;
+
+    if (max > SL_MAX_LEVEL)
+        max = SL_MAX_LEVEL;
+
+    /* xorshift64 */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    for (value = seed; (value & 3) == 0 && level < max; value >>= 2)
+        level++;
+
+    return level;
+}
+
+/**
+ * search - find the neighbours of @node on every level.
+ * @root: skip list to search.
+ * @node: node whose position is searched.
+ * @cmp: operator defining the node order.
+ * @preds: last node before @node on each level.
+ * @succs: first node not before @node on each level.
+ *
+ * Unlinks marked nodes met on the way. Returns true if a node
+ * equal to @node is linked on the bottom level.
+ */
+static bool search(struct sl_root *root, struct sl_node *node, sl_cmp_t cmp,
+                   struct sl_node **preds, struct sl_node **succs)
+{
+    struct sl_node *pred, *curr, *succ;
+    unsigned int level;
+
+retry:
+    pred = &root->head;
+    for (level = SL_MAX_LEVEL; level--;) {
+        curr = unmarked(load_next(pred, level));
+        while (curr) {
+            succ = load_next(curr, level);
+            if (is_marked(succ)) {
+                if (!cas_next(pred, level, curr, unmarked(succ)))
+                    goto retry;
+                curr = unmarked(succ);
+                continue;
+            }
+
+            if (cmp(node, curr) <= 0)
+                break;
+
+            pred = curr;
+            curr = succ;
+        }
+
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+
+    return succs[0] && !cmp(node, succs[0]);
+}
+
+/**
+ * sl_insert - insert node into skip list.
+ * @root: skip list root.
+ * @node: new node to insert, its level set by sl_node_init().
+ * @cmp: operator defining the node order.
+ *
+ * Returns false if an equal node is already in the list.
+ */
+bool sl_insert(struct sl_root *root, struct sl_node *node, sl_cmp_t cmp)
+{
+    struct sl_node *preds[SL_MAX_LEVEL], *succs[SL_MAX_LEVEL];
+    struct sl_node *succ, *old;
+    unsigned int level = node->level, count;
+
+    for (;;) {
+        if (search(root, node, cmp, preds, succs))
+            return false;
+
+        for (count = 0; count < level; ++count)
+            __atomic_store_n(&node->next[count], succs[count], __ATOMIC_RELAXED);
+
+        /* linking the bottom level makes the node visible */
+        if (cas_next(preds[0], 0, succs[0], node))
+            break;
+    }
+
+    for (count = 1; count < level; ++count) {
+        for (;;) {
+            succ = succs[count];
+            old = load_next(node, count);
+
+            /* deleted while linking upper levels */
+            if (is_marked(old))
+                return true;
+
+            if (old != succ && !cas_next(node, count, old, succ))
+                return true;
+
+            if (cas_next(preds[count], count, succ, node)) {
+                /* deleted right after linking, unlink it again */
+                if (is_marked(load_next(node, count))) {
+                    search(root, node, cmp, preds, succs);
+                    return true;
+                }
+                break;
+            }
+
+            search(root, node, cmp, preds, succs);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * sl_delete - delete node from skip list.
+ * @root: skip list root.
+ * @node: node to delete.
+ * @cmp: operator defining the node order.
+ *
+ * Returns false if the node was deleted concurrently by another thread.
+ */
+bool sl_delete(struct sl_root *root, struct sl_node *node, sl_cmp_t cmp)
+{
+    struct sl_node *preds[SL_MAX_LEVEL], *succs[SL_MAX_LEVEL];
+    struct sl_node *succ;
+    unsigned int level;
+
+    for (level = node->level; --level;) {
+        succ = load_next(node, level);
+        while (!is_marked(succ)) {
+            cas_next(node, level, succ, marked(succ));
+            succ = load_next(node, level);
+        }
+    }
+
+    /* marking the bottom level decides the winner */
+    succ = load_next(node, 0);
+    for (;;) {
+        if (is_marked(succ))
+            return false;
+
+        if (cas_next(node, 0, succ, marked(succ)))
+            break;
+
+        succ = load_next(node, 0);
+    }
+
+    /* unlink physically */
+    search(root, node, cmp, preds, succs);
+    return true;
+}
+
+/**
+ * sl_find - find @key in skip list @root.
+ * @root: skip list want to search.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ *
+ * Never writes and never restarts, so it completes in a bounded
+ * number of steps for a given list.
+ */
+struct sl_node *sl_find(struct sl_root *root, const void *key, sl_find_t cmp)
+{
+    struct sl_node *pred, *curr, *succ;
+    unsigned int level;
+    long ret = 1;
+
+    pred = &root->head;
+    curr = NULL;
+
+    for (level = SL_MAX_LEVEL; level--;) {
+        curr = unmarked(load_next(pred, level));
+        while (curr) {
+            succ = load_next(curr, level);
+            if (is_marked(succ)) {
+                curr = unmarked(succ);
+                continue;
+            }
+
+            ret = cmp(curr, key);
+            if (ret <= 0)
+                break;
+
+            pred = curr;
+            curr = succ;
+        }
+    }
+
+    if (curr && !ret && !is_marked(load_next(curr, 0)))
+        return curr;
+
+    return NULL;
+}
+
+/**
+ * sl_first/next - Sequential iteration
+ * NOTE: concurrent updates may or may not be observed.
+ */
+struct sl_node *sl_first(struct sl_root *root)
+{
+    return sl_next(&root->head);
+}
+
+struct sl_node *sl_next(const struct sl_node *node)
+{
+    struct sl_node *succ;
+
+    node = unmarked(load_next(node, 0));
+    while (node && is_marked(succ = load_next(node, 0)))
+        node = unmarked(succ);
+
+    return (struct sl_node *)node;
+}
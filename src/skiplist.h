@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _SKIPLIST_H_
+#define _SKIPLIST_H_
+
+#include "rbtree.h"
+
+/*
+ * Lock-free ordered set (skip list).
+ *
+ * Insert and delete use CAS on marked next pointers; lookups and
+ * iteration never write and never retry. A deleted node may still
+ * be traversed by concurrent readers, so it must not be freed or
+ * reinserted before all operations that started earlier finished.
+ *
+ * The caller sizes every tower. A node with level L costs
+ * SL_NODE_SIZE(L) bytes, 8 + 8 * L on 64-bit, and with one extra
+ * level in four nodes the average is about 1.33 levels, so exact
+ * towers take some 19 bytes per node where a full one would take
+ * SL_NODE_SIZE(SL_MAX_LEVEL) = 136. Either allocate each node with
+ * its own level from sl_random_level(), the sl_node last in the
+ * container, or embed a fixed tower with SL_NODE() and draw levels
+ * up to its height. sl_node_init() sets the level before insertion.
+ */
+
+#ifndef SL_MAX_LEVEL
+# define SL_MAX_LEVEL 16
+#endif
+
+struct sl_node {
+    unsigned int level;
+    struct sl_node *next[];
+};
+
+#define SL_NODE_SIZE(levels) \
+    (sizeof(struct sl_node) + sizeof(struct sl_node *) * (levels))
+
+/**
+ * SL_NODE - embed an sl_node with room for a fixed tower.
+ * @name: member name of the sl_node.
+ * @levels: highest level the member can take.
+ */
+#define SL_NODE(name, levels) \
+    union { \
+        struct sl_node name; \
+        struct { \
+            unsigned int level; \
+            struct sl_node *next[levels]; \
+        } name##_tower; \
+    }
+
+struct sl_root {
+    SL_NODE(head, SL_MAX_LEVEL);
+};
+
+#define SL_STATIC \
+    {{.head_tower = {SL_MAX_LEVEL, {NULL}}}}
+
+#define SL_INIT \
+    (struct sl_root) SL_STATIC
+
+#define SL_ROOT(name) \
+    struct sl_root name = SL_INIT
+
+#define SL_EMPTY_ROOT(root) \
+    (sl_first(root) == NULL)
+
+/**
+ * sl_entry - get the struct for this entry.
+ * @ptr: the &struct sl_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_entry(ptr, type, member) \
+    rb_entry(ptr, type, member)
+
+/**
+ * sl_entry_safe - get the struct for this entry or null.
+ * @ptr: the &struct sl_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_entry_safe(ptr, type, member) \
+    rb_entry_safe(ptr, type, member)
+
+/**
+ * sl_node_init - set the level of a node before insertion.
+ * @node: node to initialize, with room for @level links.
+ * @level: number of levels to link the node on, 1 to SL_MAX_LEVEL.
+ */
+static inline void sl_node_init(struct sl_node *node, unsigned int level)
+{
+    node->level = level;
+}
+
+typedef long (*sl_find_t)(const struct sl_node *node, const void *key);
+typedef long (*sl_cmp_t)(const struct sl_node *nodea, const struct sl_node *nodeb);
+
+extern unsigned int sl_random_level(unsigned int max);
+extern bool sl_insert(struct sl_root *root, struct sl_node *node, sl_cmp_t cmp);
+extern bool sl_delete(struct sl_root *root, struct sl_node *node, sl_cmp_t cmp);
+extern struct sl_node *sl_find(struct sl_root *root, const void *key, sl_find_t cmp);
+
+/* Sequential iteration - deleted nodes are skipped */
+extern struct sl_node *sl_first(struct sl_root *root);
+extern struct sl_node *sl_next(const struct sl_node *node);
+
+/**
+ * sl_first_entry - get the first element from a skip list.
+ * @ptr: the skip list root to take the element from.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_first_entry(ptr, type, member) \
+    sl_entry_safe(sl_first(ptr), type, member)
+
+/**
+ * sl_next_entry - get the next element in skip list.
+ * @pos: the type * to cursor.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_next_entry(pos, member) \
+    sl_entry_safe(sl_next(&(pos)->member), typeof(*(pos)), member)
+
+/**
+ * sl_for_each - iterate over a skip list.
+ * @pos: the &struct sl_node to use as a loop cursor.
+ * @root: the root for your skip list.
+ */
+#define sl_for_each(pos, root) \
+    for (pos = sl_first(root); pos; pos = sl_next(pos))
+
+/**
+ * sl_for_each_from - iterate over a skip list from the current point.
+ * @pos: the &struct sl_node to use as a loop cursor.
+ */
+#define sl_for_each_from(pos) \
+    for (; pos; pos = sl_next(pos))
+
+/**
+ * sl_for_each_continue - continue iteration over a skip list.
+ * @pos: the &struct sl_node to use as a loop cursor.
+ */
+#define sl_for_each_continue(pos) \
+    for (pos = sl_next(pos); pos; pos = sl_next(pos))
+
+/**
+ * sl_for_each_entry - iterate over skip list of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @root: the root for your skip list.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_for_each_entry(pos, root, member) \
+    for (pos = sl_first_entry(root, typeof(*pos), member); \
+         pos; pos = sl_next_entry(pos, member))
+
+/**
+ * sl_for_each_entry_from - iterate over skip list of given type from the current point.
+ * @pos: the type * to use as a loop cursor.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_for_each_entry_from(pos, member) \
+    for (; pos; pos = sl_next_entry(pos, member))
+
+/**
+ * sl_for_each_entry_continue - continue iteration over skip list of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @member: the name of the sl_node within the struct.
+ */
+#define sl_for_each_entry_continue(pos, member) \
+    for (pos = sl_next_entry(pos, member); \
+         pos; pos = sl_next_entry(pos, member))
+
+#endif  /* _SKIPLIST_H_ */
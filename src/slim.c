@@ -0,0 +1,332 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ *          -- Top-down algorithms after Julienne Walker's tutorial
+ */
+
+#include "slim.h"
+#include <stdint.h>
+
+#define SLIM_COLOR 1UL
+
+static __always_inline struct rbs_node *
+slim_child(const struct rbs_node *node, unsigned int dir)
+{
+    if (dir)
+        return node->right;
+    return (struct rbs_node *)((uintptr_t)node->left & ~SLIM_COLOR);
+}
+
+static __always_inline void
+slim_set_child(struct rbs_node *node, unsigned int dir, struct rbs_node *child)
+{
+    if (dir)
+        node->right = child;
+    else
+        node->left = (struct rbs_node *)((uintptr_t)child | ((uintptr_t)node->left & SLIM_COLOR));
+}
+
+static __always_inline void
+slim_set_color(struct rbs_node *node, unsigned int color)
+{
+    node->left = (struct rbs_node *)(((uintptr_t)node->left & ~SLIM_COLOR) | color);
+}
+
+static __always_inline bool
+slim_is_red(const struct rbs_node *node)
+{
+    return node && ((uintptr_t)node->left & SLIM_COLOR) == RB_RED;
+}
+
+/**
+ * slim_single - single rotation.
+ * @node: node to rotation.
+ * @dir: side @node moves to.
+ *
+ * Returns the new subtree root, painted black over a red @node.
+ */
+static struct rbs_node *slim_single(struct rbs_node *node, unsigned int dir)
+{
+    struct rbs_node *successor = slim_child(node, !dir);
+
+    slim_set_child(node, !dir, slim_child(successor, dir));
+    slim_set_child(successor, dir, node);
+
+    slim_set_color(node, RB_RED);
+    slim_set_color(successor, RB_BLACK);
+
+    return successor;
+}
+
+/**
+ * slim_double - double rotation.
+ * @node: node to rotation.
+ * @dir: side @node moves to.
+ */
+static struct rbs_node *slim_double(struct rbs_node *node, unsigned int dir)
+{
+    slim_set_child(node, !dir, slim_single(slim_child(node, !dir), !dir));
+    return slim_single(node, dir);
+}
+
+/**
+ * rbs_insert - insert node into a slim rbtree.
+ * @root: rbtree root.
+ * @node: new node to insert.
+ * @cmp: operator defining the node order.
+ *
+ * Splits 4-nodes on the way down, so the new node can be linked
+ * without revisiting its ancestors.
+ */
+void rbs_insert(struct rbs_root *root, struct rbs_node *node, rbs_cmp_t cmp)
+{
+    struct rbs_node head, *gparent, *tparent, *parent, *walk;
+    unsigned int dir = 0, last = 0, dir2;
+
+    node->left = node->right = NULL;
+
+    if (unlikely(!root->node)) {
+        slim_set_color(node, RB_BLACK);
+        root->node = node;
+        return;
+    }
+
+    head.left = (struct rbs_node *)SLIM_COLOR;
+    head.right = root->node;
+
+    tparent = &head;
+    gparent = parent = NULL;
+    walk = root->node;
+
+    for (;;) {
+        if (!walk) {
+            /* link new red node at the bottom */
+            walk = node;
+            slim_set_child(parent, dir, walk);
+        } else if (slim_is_red(slim_child(walk, 0)) && slim_is_red(walk->right)) {
+            /* color flip */
+            slim_set_color(walk, RB_RED);
+            slim_set_color(slim_child(walk, 0), RB_BLACK);
+            slim_set_color(walk->right, RB_BLACK);
+        }
+
+        /* fix red violation */
+        if (slim_is_red(walk) && slim_is_red(parent)) {
+            dir2 = tparent->right == gparent;
+            if (walk == slim_child(parent, last))
+                slim_set_child(tparent, dir2, slim_single(gparent, !last));
+            else
+                slim_set_child(tparent, dir2, slim_double(gparent, !last));
+        }
+
+        if (walk == node)
+            break;
+
+        last = dir;
+        dir = cmp(node, walk) >= 0;
+
+        if (gparent)
+            tparent = gparent;
+        gparent = parent;
+        parent = walk;
+        walk = slim_child(walk, dir);
+    }
+
+    root->node = head.right;
+    slim_set_color(root->node, RB_BLACK);
+}
+
+/**
+ * rbs_delete - delete a node matching @key from a slim rbtree.
+ * @root: rbtree root.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ *
+ * Pushes a red node down the search path, so the in-order
+ * predecessor found at the bottom can be unlinked directly and
+ * takes the place of the matching node. Returns the node removed
+ * from the tree, or NULL if none matched.
+ */
+struct rbs_node *rbs_delete(struct rbs_root *root, const void *key, rbs_find_t cmp)
+{
+    struct rbs_node head, *gparent, *parent, *walk, *sibling, *top;
+    struct rbs_node *found = NULL, *fparent = NULL;
+    unsigned int dir = 1, last, dir2, fdir = 0;
+    long ret;
+
+    if (unlikely(!root->node))
+        return NULL;
+
+    head.left = (struct rbs_node *)SLIM_COLOR;
+    head.right = root->node;
+
+    walk = &head;
+    gparent = parent = NULL;
+
+    while (slim_child(walk, dir)) {
+        last = dir;
+        gparent = parent;
+        parent = walk;
+        walk = slim_child(walk, dir);
+
+        ret = cmp(walk, key);
+        dir = ret > 0;
+        if (!ret) {
+            found = walk;
+            fparent = parent;
+            fdir = last;
+        }
+
+        if (slim_is_red(walk) || slim_is_red(slim_child(walk, dir)))
+            continue;
+
+        /* push the red node down */
+        if (slim_is_red(slim_child(walk, !dir))) {
+            top = slim_single(walk, dir);
+            slim_set_child(parent, last, top);
+            if (walk == found) {
+                fparent = top;
+                fdir = dir;
+            }
+            parent = top;
+        } else if ((sibling = slim_child(parent, !last))) {
+            if (!slim_is_red(slim_child(sibling, !last)) &&
+                !slim_is_red(slim_child(sibling, last))) {
+                /* color flip */
+                slim_set_color(parent, RB_BLACK);
+                slim_set_color(sibling, RB_RED);
+                slim_set_color(walk, RB_RED);
+            } else {
+                dir2 = gparent->right == parent;
+                if (slim_is_red(slim_child(sibling, last)))
+                    top = slim_double(parent, last);
+                else
+                    top = slim_single(parent, last);
+                slim_set_child(gparent, dir2, top);
+
+                /* ensure correct coloring */
+                slim_set_color(walk, RB_RED);
+                slim_set_color(top, RB_RED);
+                slim_set_color(slim_child(top, 0), RB_BLACK);
+                slim_set_color(top->right, RB_BLACK);
+
+                if (parent == found) {
+                    fparent = top;
+                    fdir = last;
+                }
+            }
+        }
+    }
+
+    if (found) {
+        /* walk has at most one child, unlink it */
+        slim_set_child(parent, parent->right == walk,
+                       slim_child(walk, !slim_child(walk, 0)));
+
+        /* the predecessor takes the place and color of the match */
+        if (walk != found) {
+            walk->left = found->left;
+            walk->right = found->right;
+            slim_set_child(fparent, fdir, walk);
+        }
+    }
+
+    root->node = head.right;
+    if (root->node)
+        slim_set_color(root->node, RB_BLACK);
+
+    return found;
+}
+
+/**
+ * rbs_find - find @key in tree @root.
+ * @root: rbtree want to search.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ */
+struct rbs_node *rbs_find(const struct rbs_root *root, const void *key, rbs_find_t cmp)
+{
+    struct rbs_node *node = root->node;
+    long ret;
+
+    while (node) {
+        ret = cmp(node, key);
+        if (ret == LONG_MIN)
+            return NULL;
+        else if (ret < 0)
+            node = slim_child(node, 0);
+        else if (ret > 0)
+            node = node->right;
+        else
+            return node;
+    }
+
+    return NULL;
+}
+
+static struct rbs_node *iter_push_left(struct rbs_iter *iter, struct rbs_node *node)
+{
+    while (node) {
+        iter->stack[iter->depth++] = node;
+        node = slim_child(node, 0);
+    }
+
+    return iter->depth ? iter->stack[iter->depth - 1] : NULL;
+}
+
+static struct rbs_node *iter_push_deep(struct rbs_iter *iter, struct rbs_node *node)
+{
+    while (node) {
+        iter->stack[iter->depth++] = node;
+        node = slim_child(node, 0) ? : node->right;
+    }
+
+    return iter->depth ? iter->stack[iter->depth - 1] : NULL;
+}
+
+/**
+ * rbs_iter_first/next - Middle iteration (Sequential)
+ * NOTE: the iterator keeps the path on an explicit stack.
+ */
+struct rbs_node *rbs_iter_first(struct rbs_iter *iter, const struct rbs_root *root)
+{
+    iter->depth = 0;
+    return iter_push_left(iter, root->node);
+}
+
+struct rbs_node *rbs_iter_next(struct rbs_iter *iter)
+{
+    struct rbs_node *node;
+
+    if (!iter->depth)
+        return NULL;
+
+    node = iter->stack[--iter->depth];
+    return iter_push_left(iter, node->right);
+}
+
+/**
+ * rbs_iter_post_first/next - Postorder iteration (Depth-first)
+ * NOTE: a visited node is never read again, so it may be freed.
+ */
+struct rbs_node *rbs_iter_post_first(struct rbs_iter *iter, const struct rbs_root *root)
+{
+    iter->depth = 0;
+    return iter_push_deep(iter, root->node);
+}
+
+struct rbs_node *rbs_iter_post_next(struct rbs_iter *iter)
+{
+    struct rbs_node *node, *parent;
+
+    if (!iter->depth || !--iter->depth)
+        return NULL;
+
+    node = iter->stack[iter->depth];
+    parent = iter->stack[iter->depth - 1];
+
+    if (node == slim_child(parent, 0) && parent->right)
+        return iter_push_deep(iter, parent->right);
+
+    return parent;
+}
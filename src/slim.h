@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _SLIM_H_
+#define _SLIM_H_
+
+#include "rbtree.h"
+
+/*
+ * Parent-pointer-free rbtree.
+ *
+ * A node is two child pointers, with the color tagged into the low
+ * bit of the left one. Without parent pointers there is no bottom-up
+ * fixup: insertion and deletion rebalance top-down in one pass from
+ * the root, and iterators keep the path on an explicit stack, which
+ * the height bound of 2 * log2(n + 1) keeps small.
+ *
+ * Nodes must be at least 2-byte aligned and are only read through
+ * the functions below.
+ */
+
+#define RBS_MAX_DEPTH (sizeof(long) * CHAR_BIT * 2)
+
+struct rbs_node {
+    struct rbs_node *left;
+    struct rbs_node *right;
+};
+
+struct rbs_root {
+    struct rbs_node *node;
+};
+
+struct rbs_iter {
+    struct rbs_node *stack[RBS_MAX_DEPTH];
+    unsigned int depth;
+};
+
+#define RBS_STATIC \
+    {NULL}
+
+#define RBS_INIT \
+    (struct rbs_root) RBS_STATIC
+
+#define RBS_ROOT(name) \
+    struct rbs_root name = RBS_INIT
+
+#define RBS_EMPTY_ROOT(root) \
+    ((root)->node == NULL)
+
+/**
+ * rbs_entry - get the struct for this entry.
+ * @ptr: the &struct rbs_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbs_node within the struct.
+ */
+#define rbs_entry(ptr, type, member) \
+    rb_entry(ptr, type, member)
+
+/**
+ * rbs_entry_safe - get the struct for this entry or null.
+ * @ptr: the &struct rbs_node pointer.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rbs_node within the struct.
+ */
+#define rbs_entry_safe(ptr, type, member) \
+    rb_entry_safe(ptr, type, member)
+
+typedef long (*rbs_find_t)(const struct rbs_node *node, const void *key);
+typedef long (*rbs_cmp_t)(const struct rbs_node *nodea, const struct rbs_node *nodeb);
+
+extern void rbs_insert(struct rbs_root *root, struct rbs_node *node, rbs_cmp_t cmp);
+extern struct rbs_node *rbs_delete(struct rbs_root *root, const void *key, rbs_find_t cmp);
+extern struct rbs_node *rbs_find(const struct rbs_root *root, const void *key, rbs_find_t cmp);
+
+/* Middle iteration (Sequential) - path kept on the iterator stack */
+extern struct rbs_node *rbs_iter_first(struct rbs_iter *iter, const struct rbs_root *root);
+extern struct rbs_node *rbs_iter_next(struct rbs_iter *iter);
+
+/* Postorder iteration (Depth-first) - nodes may be freed while iterating */
+extern struct rbs_node *rbs_iter_post_first(struct rbs_iter *iter, const struct rbs_root *root);
+extern struct rbs_node *rbs_iter_post_next(struct rbs_iter *iter);
+
+/**
+ * rbs_for_each - iterate over a slim rbtree.
+ * @pos: the &struct rbs_node to use as a loop cursor.
+ * @iter: the &struct rbs_iter holding the iteration stack.
+ * @root: the root for your rbtree.
+ */
+#define rbs_for_each(pos, iter, root) \
+    for (pos = rbs_iter_first(iter, root); pos; pos = rbs_iter_next(iter))
+
+/**
+ * rbs_for_each_entry - iterate over slim rbtree of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @iter: the &struct rbs_iter holding the iteration stack.
+ * @root: the root for your rbtree.
+ * @member: the name of the rbs_node within the struct.
+ */
+#define rbs_for_each_entry(pos, iter, root, member) \
+    for (pos = rbs_entry_safe(rbs_iter_first(iter, root), typeof(*pos), member); \
+         pos; pos = rbs_entry_safe(rbs_iter_next(iter), typeof(*pos), member))
+
+/**
+ * rbs_post_for_each_entry - postorder iterate over slim rbtree of given type.
+ * @pos: the type * to use as a loop cursor, may be freed in the loop body.
+ * @iter: the &struct rbs_iter holding the iteration stack.
+ * @root: the root for your rbtree.
+ * @member: the name of the rbs_node within the struct.
+ */
+#define rbs_post_for_each_entry(pos, iter, root, member) \
+    for (pos = rbs_entry_safe(rbs_iter_post_first(iter, root), typeof(*pos), member); \
+         pos; pos = rbs_entry_safe(rbs_iter_post_next(iter), typeof(*pos), member))
+
+#endif  /* _SLIM_H_ */
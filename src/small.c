@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "small.h"
+#include <string.h>
+
+#define SMALL_DEMOTE (RB_SMALL_MAX / 2)
+
+/**
+ * small_index - find the array slot of a node.
+ * @small: small set in array mode.
+ * @node: node in the set.
+ */
+static unsigned int small_index(const struct rb_small *small, const struct rb_node *node)
+{
+    unsigned int index;
+
+    for (index = 0; index < small->count; ++index) {
+        if (small->array[index] == node)
+            break;
+    }
+
+    return index;
+}
+
+/**
+ * small_promote - convert a full array into a cached rbtree.
+ * @small: small set in array mode.
+ * @index: slot for @node.
+ * @node: node that does not fit the array.
+ */
+static void small_promote(struct rb_small *small, unsigned int index, struct rb_node *node)
+{
+    struct rb_node *nodes[RB_SMALL_MAX + 1];
+
+    memcpy(nodes, small->array, sizeof(*nodes) * index);
+    memcpy(nodes + index + 1, small->array + index, sizeof(*nodes) * (small->count - index));
+    nodes[index] = node;
+
+    rb_build(&small->cached.root, nodes, small->count + 1);
+    small->cached.leftmost = nodes[0];
+    small->tree = true;
+}
+
+/**
+ * small_demote - convert a cached rbtree back into an array.
+ * @small: small set in tree mode, holding SMALL_DEMOTE nodes.
+ */
+static void small_demote(struct rb_small *small)
+{
+    struct rb_node *nodes[SMALL_DEMOTE], *walk;
+    unsigned int index = 0;
+
+    /* the array overlays the root, so gather the nodes aside first */
+    rb_cached_for_each(walk, &small->cached)
+        nodes[index++] = walk;
+
+    memcpy(small->array, nodes, sizeof(*nodes) * index);
+    small->tree = false;
+}
+
+/**
+ * rb_small_insert - insert a node after all nodes with an equal key.
+ * @small: small set to insert into.
+ * @node: new node to insert.
+ * @cmp: operator defining the node order.
+ */
+void rb_small_insert(struct rb_small *small, struct rb_node *node, rb_cmp_t cmp)
+{
+    unsigned int low = 0, high = small->count, mid;
+
+    if (small->tree) {
+        rb_cached_insert(&small->cached, node, cmp);
+        small->count++;
+        return;
+    }
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (cmp(node, small->array[mid]) < 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    if (small->count == RB_SMALL_MAX)
+        small_promote(small, low, node);
+    else {
+        memmove(small->array + low + 1, small->array + low,
+                sizeof(*small->array) * (small->count - low));
+        small->array[low] = node;
+    }
+
+    small->count++;
+}
+
+/**
+ * rb_small_delete - delete a node from a small set.
+ * @small: small set to delete from.
+ * @node: node to delete.
+ */
+void rb_small_delete(struct rb_small *small, struct rb_node *node)
+{
+    unsigned int index;
+
+    if (small->tree) {
+        rb_cached_delete(&small->cached, node);
+        if (--small->count == SMALL_DEMOTE)
+            small_demote(small);
+        return;
+    }
+
+    index = small_index(small, node);
+    memmove(small->array + index, small->array + index + 1,
+            sizeof(*small->array) * (small->count - index - 1));
+    small->count--;
+}
+
+/**
+ * rb_small_find - find a node with a key.
+ * @small: small set to search.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ */
+struct rb_node *rb_small_find(const struct rb_small *small, const void *key, rb_find_t cmp)
+{
+    unsigned int low = 0, high = small->count, mid;
+    long ret;
+
+    if (small->tree)
+        return rb_cached_find(&small->cached, key, cmp);
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        ret = cmp(small->array[mid], key);
+        if (ret == LONG_MIN)
+            return NULL;
+        else if (ret < 0)
+            high = mid;
+        else if (ret > 0)
+            low = mid + 1;
+        else
+            return small->array[mid];
+    }
+
+    return NULL;
+}
+
+/**
+ * rb_small_first - get the first node of a small set.
+ * @small: small set to take the node from.
+ */
+struct rb_node *rb_small_first(const struct rb_small *small)
+{
+    if (small->tree)
+        return rb_cached_first(&small->cached);
+
+    return small->count ? small->array[0] : NULL;
+}
+
+/**
+ * rb_small_last - get the last node of a small set.
+ * @small: small set to take the node from.
+ */
+struct rb_node *rb_small_last(const struct rb_small *small)
+{
+    if (small->tree)
+        return rb_last(&small->cached.root);
+
+    return small->count ? small->array[small->count - 1] : NULL;
+}
+
+/**
+ * rb_small_next - get the next node of a small set.
+ * @small: small set @node belongs to.
+ * @node: node to step from.
+ */
+struct rb_node *rb_small_next(const struct rb_small *small, const struct rb_node *node)
+{
+    unsigned int index;
+
+    if (small->tree)
+        return rb_next(node);
+
+    index = small_index(small, node) + 1;
+    return index < small->count ? small->array[index] : NULL;
+}
+
+/**
+ * rb_small_prev - get the previous node of a small set.
+ * @small: small set @node belongs to.
+ * @node: node to step from.
+ */
+struct rb_node *rb_small_prev(const struct rb_small *small, const struct rb_node *node)
+{
+    unsigned int index;
+
+    if (small->tree)
+        return rb_prev(node);
+
+    index = small_index(small, node);
+    return index ? small->array[index - 1] : NULL;
+}
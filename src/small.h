@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _SMALL_H_
+#define _SMALL_H_
+
+#include "rbtree.h"
+
+/*
+ * Small-size hybrid container.
+ *
+ * Up to RB_SMALL_MAX nodes are kept in a sorted pointer array that
+ * is binary searched, and the rb_node links are left unused. One
+ * more node promotes the set to a cached rbtree with a linear build;
+ * once it shrinks to RB_SMALL_MAX / 2 nodes it is demoted back to
+ * the array. The gap between the two keeps a set hovering around the
+ * threshold from converting on every operation.
+ *
+ * In array mode rb_small_next() and rb_small_prev() locate their
+ * node by scanning the array, which is cheaper than following links
+ * at these sizes.
+ */
+
+#ifndef RB_SMALL_MAX
+# define RB_SMALL_MAX 16
+#endif
+
+struct rb_small {
+    union {
+        struct rb_node *array[RB_SMALL_MAX];
+        struct rb_root_cached cached;
+    };
+    unsigned int count;
+    bool tree;
+};
+
+#define RB_SMALL_STATIC \
+    {{{NULL}}, 0, false}
+
+#define RB_SMALL_INIT \
+    (struct rb_small) RB_SMALL_STATIC
+
+#define RB_SMALL(name) \
+    struct rb_small name = RB_SMALL_INIT
+
+#define RB_EMPTY_SMALL(small) \
+    ((small)->count == 0)
+
+extern void rb_small_insert(struct rb_small *small, struct rb_node *node, rb_cmp_t cmp);
+extern void rb_small_delete(struct rb_small *small, struct rb_node *node);
+extern struct rb_node *rb_small_find(const struct rb_small *small, const void *key, rb_find_t cmp);
+
+/* Sequential iteration - identical in both modes */
+extern struct rb_node *rb_small_first(const struct rb_small *small);
+extern struct rb_node *rb_small_last(const struct rb_small *small);
+extern struct rb_node *rb_small_next(const struct rb_small *small, const struct rb_node *node);
+extern struct rb_node *rb_small_prev(const struct rb_small *small, const struct rb_node *node);
+
+/**
+ * rb_small_first_entry - get the first element from a small set.
+ * @small: the small set to take the element from.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_small_first_entry(small, type, member) \
+    rb_entry_safe(rb_small_first(small), type, member)
+
+/**
+ * rb_small_last_entry - get the last element from a small set.
+ * @small: the small set to take the element from.
+ * @type: the type of the struct this is embedded in.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_small_last_entry(small, type, member) \
+    rb_entry_safe(rb_small_last(small), type, member)
+
+/**
+ * rb_small_next_entry - get the next element in a small set.
+ * @small: the small set @pos belongs to.
+ * @pos: the type * to cursor.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_small_next_entry(small, pos, member) \
+    rb_entry_safe(rb_small_next(small, &(pos)->member), typeof(*(pos)), member)
+
+/**
+ * rb_small_prev_entry - get the previous element in a small set.
+ * @small: the small set @pos belongs to.
+ * @pos: the type * to cursor.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_small_prev_entry(small, pos, member) \
+    rb_entry_safe(rb_small_prev(small, &(pos)->member), typeof(*(pos)), member)
+
+/**
+ * rb_small_for_each - iterate over a small set.
+ * @pos: the &struct rb_node to use as a loop cursor.
+ * @small: the small set to iterate.
+ */
+#define rb_small_for_each(pos, small) \
+    for (pos = rb_small_first(small); pos; pos = rb_small_next(small, pos))
+
+/**
+ * rb_small_for_each_reverse - iterate over a small set backwards.
+ * @pos: the &struct rb_node to use as a loop cursor.
+ * @small: the small set to iterate.
+ */
+#define rb_small_for_each_reverse(pos, small) \
+    for (pos = rb_small_last(small); pos; pos = rb_small_prev(small, pos))
+
+/**
+ * rb_small_for_each_entry - iterate over small set of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @small: the small set to iterate.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_small_for_each_entry(pos, small, member) \
+    for (pos = rb_small_first_entry(small, typeof(*pos), member); \
+         pos; pos = rb_small_next_entry(small, pos, member))
+
+/**
+ * rb_small_for_each_entry_reverse - iterate backwards over small set of given type.
+ * @pos: the type * to use as a loop cursor.
+ * @small: the small set to iterate.
+ * @member: the name of the rb_node within the struct.
+ */
+#define rb_small_for_each_entry_reverse(pos, small, member) \
+    for (pos = rb_small_last_entry(small, typeof(*pos), member); \
+         pos; pos = rb_small_prev_entry(small, pos, member))
+
+#endif  /* _SMALL_H_ */
@@ -0,0 +1,159 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+static uint64_t trace_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * trace_flush - write out the buffered records.
+ * @trace: trace to flush.
+ *
+ * The first write error sticks and is returned by rb_trace_close().
+ */
+static void trace_flush(struct rb_trace *trace)
+{
+    if (!trace->error && fwrite(trace->buffer, sizeof(*trace->buffer),
+                                trace->count, trace->file) != trace->count)
+        trace->error = -EIO;
+
+    trace->count = 0;
+}
+
+/**
+ * rb_trace_open - start recording into a file.
+ * @trace: trace to set up.
+ * @path: file to create or truncate.
+ */
+int rb_trace_open(struct rb_trace *trace, const char *path)
+{
+    struct rb_trace_header header = {
+        .magic = RB_TRACE_MAGIC,
+        .version = RB_TRACE_VERSION,
+        .size = sizeof(struct rb_trace_record),
+    };
+
+    trace->file = fopen(path, "wb");
+    if (!trace->file)
+        return -errno;
+
+    if (fwrite(&header, sizeof(header), 1, trace->file) != 1) {
+        fclose(trace->file);
+        return -EIO;
+    }
+
+    trace->count = 0;
+    trace->error = 0;
+    trace->last = trace_now();
+
+    return 0;
+}
+
+/**
+ * rb_trace_close - flush and close a trace.
+ * @trace: trace to close.
+ *
+ * Returns 0, or -EIO when any record could not be written.
+ */
+int rb_trace_close(struct rb_trace *trace)
+{
+    trace_flush(trace);
+    if (fclose(trace->file) && !trace->error)
+        trace->error = -EIO;
+
+    return trace->error;
+}
+
+/**
+ * rb_trace_record - append one operation to a trace.
+ * @trace: trace to record into.
+ * @op: operation about to run.
+ * @key: key of the operation.
+ */
+void rb_trace_record(struct rb_trace *trace, enum rb_trace_op op, uint64_t key)
+{
+    struct rb_trace_record *record = &trace->buffer[trace->count];
+    uint64_t now = trace_now(), delta = now - trace->last;
+
+    record->key = key;
+    record->delta = delta > UINT32_MAX ? UINT32_MAX : delta;
+    record->op = op;
+    memset(record->pad, 0, sizeof(record->pad));
+    trace->last = now;
+
+    if (++trace->count == RB_TRACE_BUFFER)
+        trace_flush(trace);
+}
+
+/**
+ * rb_trace_load - read a whole trace file.
+ * @path: file written through rb_trace_open().
+ * @records: set to a malloc'ed array of the records.
+ * @count: set to the number of records.
+ *
+ * Returns 0, -EINVAL for a file that is not a trace of this version,
+ * or a negative errno.
+ */
+int rb_trace_load(const char *path, struct rb_trace_record **records, unsigned long *count)
+{
+    struct rb_trace_header header;
+    struct rb_trace_record *array;
+    unsigned long index;
+    long size;
+    FILE *file;
+    int retval = -EINVAL;
+
+    file = fopen(path, "rb");
+    if (!file)
+        return -errno;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, RB_TRACE_MAGIC, sizeof(RB_TRACE_MAGIC)) ||
+        header.version != RB_TRACE_VERSION || header.size != sizeof(*array))
+        goto close;
+
+    if (fseek(file, 0, SEEK_END) || (size = ftell(file)) < 0 ||
+        fseek(file, sizeof(header), SEEK_SET)) {
+        retval = -EIO;
+        goto close;
+    }
+
+    *count = (size - sizeof(header)) / sizeof(*array);
+    array = malloc(sizeof(*array) * (*count ? *count : 1));
+    if (!array) {
+        retval = -ENOMEM;
+        goto close;
+    }
+
+    if (fread(array, sizeof(*array), *count, file) != *count) {
+        free(array);
+        retval = -EIO;
+        goto close;
+    }
+
+    for (index = 0; index < *count; ++index) {
+        if (array[index].op >= RB_TRACE_NR_OPS) {
+            free(array);
+            goto close;
+        }
+    }
+
+    *records = array;
+    retval = 0;
+
+close:
+    fclose(file);
+    return retval;
+}
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright(c) 2022 John Sanpe <sanpeqf@gmail.com>
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "rbtree.h"
+#include <stdio.h>
+
+/*
+ * Workload trace recording.
+ *
+ * An application routes its tree operations through the
+ * rb_trace_* wrappers below, which log the operation, a 64-bit
+ * projection of its key and the time since the previous record
+ * before running it. Records are buffered and written as 16-byte
+ * entries after a small header, in host byte order; gaps longer
+ * than 4s are saturated. examples/benchmark replays such a file
+ * with -t.
+ *
+ * A trace is not locked, the caller serializes it like the tree.
+ */
+
+#define RB_TRACE_MAGIC      "RBTRACE"
+#define RB_TRACE_VERSION    1
+
+#ifndef RB_TRACE_BUFFER
+# define RB_TRACE_BUFFER 256
+#endif
+
+enum rb_trace_op {
+    RB_TRACE_INSERT = 0,
+    RB_TRACE_FIND,
+    RB_TRACE_DELETE,
+    RB_TRACE_NR_OPS,
+};
+
+struct rb_trace_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+};
+
+struct rb_trace_record {
+    uint64_t key;
+    uint32_t delta;
+    uint8_t op;
+    uint8_t pad[3];
+};
+
+struct rb_trace {
+    FILE *file;
+    uint64_t last;
+    unsigned int count;
+    int error;
+    struct rb_trace_record buffer[RB_TRACE_BUFFER];
+};
+
+extern int rb_trace_open(struct rb_trace *trace, const char *path);
+extern int rb_trace_close(struct rb_trace *trace);
+extern void rb_trace_record(struct rb_trace *trace, enum rb_trace_op op, uint64_t key);
+extern int rb_trace_load(const char *path, struct rb_trace_record **records, unsigned long *count);
+
+/**
+ * rb_trace_insert - record and insert a node.
+ * @trace: trace to record into.
+ * @root: rbtree root of node.
+ * @node: new node to insert.
+ * @cmp: operator defining the node order.
+ * @key: key of @node as recorded.
+ */
+static inline void rb_trace_insert(struct rb_trace *trace, struct rb_root *root,
+                                   struct rb_node *node, rb_cmp_t cmp, uint64_t key)
+{
+    rb_trace_record(trace, RB_TRACE_INSERT, key);
+    rb_insert(root, node, cmp);
+}
+
+/**
+ * rb_trace_find - record and run a lookup.
+ * @trace: trace to record into.
+ * @root: rbtree want to search.
+ * @key: key to match.
+ * @cmp: operator defining the node order.
+ * @record: key as recorded.
+ */
+static inline struct rb_node *rb_trace_find(struct rb_trace *trace, const struct rb_root *root,
+                                            const void *key, rb_find_t cmp, uint64_t record)
+{
+    rb_trace_record(trace, RB_TRACE_FIND, record);
+    return rb_find(root, key, cmp);
+}
+
+/**
+ * rb_trace_delete - record and delete a node.
+ * @trace: trace to record into.
+ * @root: rbtree root of node.
+ * @node: node to delete.
+ * @key: key of @node as recorded.
+ */
+static inline void rb_trace_delete(struct rb_trace *trace, struct rb_root *root,
+                                   struct rb_node *node, uint64_t key)
+{
+    rb_trace_record(trace, RB_TRACE_DELETE, key);
+    rb_delete(root, node);
+}
+
+/**
+ * rb_trace_cached_insert - record and insert a node into a cached tree.
+ * @trace: trace to record into.
+ * @cached: rbtree cached root of node.
+ * @node: new node to insert.
+ * @cmp: operator defining the node order.
+ * @key: key of @node as recorded.
+ */
+static inline void rb_trace_cached_insert(struct rb_trace *trace, struct rb_root_cached *cached,
+                                          struct rb_node *node, rb_cmp_t cmp, uint64_t key)
+{
+    rb_trace_record(trace, RB_TRACE_INSERT, key);
+    rb_cached_insert(cached, node, cmp);
+}
+
+/**
+ * rb_trace_cached_delete - record and delete a node from a cached tree.
+ * @trace: trace to record into.
+ * @cached: rbtree cached root of node.
+ * @node: node to delete.
+ * @key: key of @node as recorded.
+ */
+static inline void rb_trace_cached_delete(struct rb_trace *trace, struct rb_root_cached *cached,
+                                          struct rb_node *node, uint64_t key)
+{
+    rb_trace_record(trace, RB_TRACE_DELETE, key);
+    rb_cached_delete(cached, node);
+}
+
+#define rb_trace_cached_find(trace, cached, key, cmp, record) \
+    rb_trace_find(trace, &(cached)->root, key, cmp, record)
+
+#endif  /* _TRACE_H_ */